@@ -0,0 +1,312 @@
+#include <iostream>
+#include <fstream>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/datacenter-module.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DCBench");
+
+//
+// Scalability benchmark of the datacenter module. Builds a k-ary fat
+// tree: (k/2)^2 core switches, k pods of k/2 aggregation and k/2 edge
+// switches, k/2 hosts per edge switch and some vms per host. The vms
+// exchange RDMA messages in a permutation or an incast, or stay idle.
+//
+// One CSV line is printed per run:
+//
+//   setup_ms        wall clock time to build the topology and workload
+//   run_ms          wall clock time of Simulator::Run
+//   peak_rss_kb     peak resident memory of the process
+//   node_bytes      resident memory added by the topology, per node
+//   device_bytes    the same per net device
+//   vm_bytes        resident memory added by the vms, per vm
+//   events_per_s    simulator events executed per wall clock second
+//   sim_wall_ratio  simulated time over wall clock time of the run
+//   build           default, or fast and fast-assert when the module is
+//                   configured with --dc-fast (and --dc-fast-asserts)
+//
+// With --kmax every k from --k to --kmax, step 2, runs in a child
+// process, so every line has its own peak memory:
+//
+//   ./waf --run "dc-bench --k=4 --kmax=16 --time=0.01"
+//
+// The cost of the logging of the per packet paths shows in events_per_s
+// of a debug build configured with and without --dc-fast:
+//
+//   ./waf configure -d debug && ./waf --run "dc-bench --k=8"
+//   ./waf configure -d debug --dc-fast && ./waf --run "dc-bench --k=8"
+//
+// This comparison has not been run yet, there is no measured saving of
+// --dc-fast to quote.
+//
+
+namespace ns3 {
+
+/**
+ * Count the events of the simulation, the real work is done by a
+ * scheduler of the type given to SetType.
+ */
+class DCBenchScheduler : public Scheduler
+{
+public:
+    static TypeId GetTypeId (void)
+    {
+        static TypeId tid = TypeId ("ns3::DCBenchScheduler")
+            .SetParent<Scheduler> ()
+            .AddConstructor<DCBenchScheduler> ()
+        ;
+        return tid;
+    }
+
+    DCBenchScheduler ()
+    {
+        ObjectFactory factory;
+        factory.SetTypeId (s_type);
+        m_scheduler = factory.Create<Scheduler> ();
+    }
+
+    static void SetType (std::string type) { s_type = type; }
+    static uint64_t GetNEvents (void) { return s_events; }
+
+    virtual void Insert (const Event &ev) { m_scheduler->Insert (ev); }
+    virtual bool IsEmpty (void) const { return m_scheduler->IsEmpty (); }
+    virtual Event PeekNext (void) const { return m_scheduler->PeekNext (); }
+    virtual Event RemoveNext (void) { s_events++; return m_scheduler->RemoveNext (); }
+    virtual void Remove (const Event &ev) { m_scheduler->Remove (ev); }
+
+private:
+    Ptr<Scheduler> m_scheduler;
+    static std::string s_type;
+    static uint64_t s_events;
+};
+
+std::string DCBenchScheduler::s_type = "ns3::MapScheduler";
+uint64_t DCBenchScheduler::s_events = 0;
+
+NS_OBJECT_ENSURE_REGISTERED (DCBenchScheduler);
+
+} // namespace ns3
+
+struct BenchConfig
+{
+    uint32_t vmsPerHost;
+    std::string rate;
+    std::string delay;
+    std::string bridgeForward;
+    std::string pointForward;
+    std::string workload;
+    uint64_t msgSize;
+    double time;
+};
+
+// the flavour of the build, see --dc-fast in the wscript of the module
+static const char *
+GetBuild (void)
+{
+#if defined (DC_FAST) && defined (DC_FAST_ASSERT)
+    return "fast-assert";
+#elif defined (DC_FAST)
+    return "fast";
+#else
+    return "default";
+#endif
+}
+
+// resident memory of the process now, in bytes
+static uint64_t
+GetRss (void)
+{
+    std::ifstream statm ("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (!(statm >> size >> resident))
+        return 0;
+    return resident * sysconf (_SC_PAGESIZE);
+}
+
+static uint64_t
+GetPeakRssKb (void)
+{
+    struct rusage usage;
+    getrusage (RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static uint32_t
+CountDevices (void)
+{
+    uint32_t n = 0;
+    for (NodeList::Iterator i = NodeList::Begin ();i != NodeList::End ();++i)
+        n += (*i)->GetNDevices ();
+    return n;
+}
+
+static void
+ConnectQp (Ptr<DCVm> src, Ptr<DCVm> dst, uint32_t qpn, uint64_t size)
+{
+    Ptr<DCRdmaQp> rqp = CreateObject<DCRdmaQp> ();
+    rqp->SetAttribute ("Qpn", UintegerValue (qpn));
+    rqp->SetAttribute ("RemoteQpn", UintegerValue (qpn));
+    rqp->SetAttribute ("Remote", AddressValue (src->GetPointNetDeviceAddress ()));
+    dst->AddApplication (rqp);
+
+    Ptr<DCRdmaQp> sqp = CreateObject<DCRdmaQp> ();
+    sqp->SetAttribute ("Qpn", UintegerValue (qpn));
+    sqp->SetAttribute ("RemoteQpn", UintegerValue (qpn));
+    sqp->SetAttribute ("Remote", AddressValue (dst->GetPointNetDeviceAddress ()));
+    sqp->SetAttribute ("MessageSize", UintegerValue (size));
+    sqp->SetStartTime (MicroSeconds (10));
+    src->AddApplication (sqp);
+}
+
+static void
+RunOne (uint32_t k, const BenchConfig &c)
+{
+    SystemWallClockMs setupClock;
+    setupClock.Start ();
+    uint64_t rss0 = GetRss ();
+
+    DCHelper helper;
+    if (!c.bridgeForward.empty ())
+        helper.SetBridgeForward (c.bridgeForward);
+    if (!c.pointForward.empty ())
+        helper.SetPointForward (c.pointForward);
+    helper.SetLinkAttribute ("DataRate", DataRateValue (DataRate (c.rate)));
+    helper.SetLinkAttribute ("Delay", TimeValue (Time (c.delay)));
+    helper.SetHostBw (DataRate (c.rate));
+
+    uint32_t half = k / 2;
+    DCNodeContainer<DCSwitch> cores = helper.CreateSwitchs (half * half);
+    DCNodeContainer<DCHost> hosts;
+    uint32_t nSwitchs = cores.GetN ();
+    for (uint32_t pod = 0;pod < k;pod++)
+    {
+        DCNodeContainer<DCSwitch> aggs = helper.CreateSwitchs (half);
+        DCNodeContainer<DCSwitch> edges = helper.CreateSwitchs (half);
+        for (uint32_t j = 0;j < half;j++)
+        {
+            DCNodeContainer<DCSwitch> agg (aggs.Get (j));
+            for (uint32_t i = 0;i < half;i++)
+                helper.Install (cores.Get (j * half + i), agg);
+        }
+        helper.Install (aggs, edges);
+        hosts.Add (helper.CreateAndInstallHosts (edges, half));
+        nSwitchs += aggs.GetN () + edges.GetN ();
+    }
+    uint64_t rss1 = GetRss ();
+    uint32_t nNodes = NodeList::GetNNodes ();
+    uint32_t nDevices = CountDevices ();
+
+    DCNodeContainer<DCVm> vms;
+    for (DCNodeContainer<DCHost>::Iterator i = hosts.Begin ();i != hosts.End ();i++)
+    {
+        helper.AllocateVm (*i, DataRate (c.rate), DataRate (c.rate),
+                           std::map<std::string,uint64_t> (), c.vmsPerHost, vms);
+    }
+    uint64_t rss2 = GetRss ();
+
+    uint32_t n = vms.GetN ();
+    if (c.workload == "permutation")
+    {
+        for (uint32_t i = 0;i < n;i++)
+            ConnectQp (vms.Get (i), vms.Get ((i + n / 2) % n), i + 1, c.msgSize);
+    }
+    else if (c.workload == "incast")
+    {
+        for (uint32_t i = 1;i < n;i++)
+            ConnectQp (vms.Get (i), vms.Get (0), i, c.msgSize);
+    }
+    else
+    {
+        NS_ABORT_MSG_UNLESS (c.workload == "none", "dc-bench: unknown workload " << c.workload);
+    }
+    int64_t setupMs = setupClock.End ();
+
+    SystemWallClockMs runClock;
+    runClock.Start ();
+    Simulator::Stop (Seconds (c.time));
+    Simulator::Run ();
+    int64_t runMs = runClock.End ();
+    double simSeconds = Simulator::Now ().GetSeconds ();
+    uint64_t events = DCBenchScheduler::GetNEvents ();
+    Simulator::Destroy ();
+
+    double runSeconds = runMs > 0 ? runMs / 1000.0 : 0.001;
+    std::cout << k << "," << nSwitchs << "," << hosts.GetN () << "," << n
+              << "," << nDevices << "," << setupMs << "," << runMs
+              << "," << GetPeakRssKb ()
+              << "," << (rss1 - rss0) / (nNodes ? nNodes : 1)
+              << "," << (rss1 - rss0) / (nDevices ? nDevices : 1)
+              << "," << (rss2 - rss1) / (n ? n : 1)
+              << "," << events << "," << (uint64_t)(events / runSeconds)
+              << "," << simSeconds / runSeconds << "," << GetBuild () << std::endl;
+}
+
+int
+main (int argc, char *argv[])
+{
+    uint32_t k = 4;
+    uint32_t kmax = 0;
+    std::string scheduler = "ns3::MapScheduler";
+    BenchConfig c;
+    c.vmsPerHost = 1;
+    c.rate = "10Gbps";
+    c.delay = "1us";
+    c.bridgeForward = "ns3::DCBridgeStaticForward";
+    c.workload = "permutation";
+    c.msgSize = 100000;
+    c.time = 0.01;
+
+    CommandLine cmd;
+    cmd.AddValue ("k", "Ports of the fat tree switchs, even", k);
+    cmd.AddValue ("kmax", "Run every k up to kmax, each in a child process", kmax);
+    cmd.AddValue ("vms", "Vms per host", c.vmsPerHost);
+    cmd.AddValue ("rate", "Data rate of all links", c.rate);
+    cmd.AddValue ("delay", "Delay of all links", c.delay);
+    cmd.AddValue ("bridgeForward", "Forward module of the switchs", c.bridgeForward);
+    cmd.AddValue ("pointForward", "Forward module of the point devices, default if empty", c.pointForward);
+    cmd.AddValue ("workload", "permutation, incast or none", c.workload);
+    cmd.AddValue ("size", "Bytes of each RDMA message", c.msgSize);
+    cmd.AddValue ("time", "Simulated seconds", c.time);
+    cmd.AddValue ("scheduler", "Type of the event scheduler", scheduler);
+    cmd.Parse (argc, argv);
+
+    NS_ABORT_MSG_IF (k < 2 || k % 2, "dc-bench: k must be even");
+    DCBenchScheduler::SetType (scheduler);
+    ObjectFactory factory;
+    factory.SetTypeId ("ns3::DCBenchScheduler");
+    Simulator::SetScheduler (factory);
+
+    std::cout << "k,switchs,hosts,vms,devices,setup_ms,run_ms,peak_rss_kb,"
+              << "node_bytes,device_bytes,vm_bytes,events,events_per_s,sim_wall_ratio,build"
+              << std::endl;
+
+    if (kmax <= k)
+    {
+        RunOne (k, c);
+        return 0;
+    }
+
+    for (;k <= kmax;k += 2)
+    {
+        pid_t pid = fork ();
+        NS_ABORT_MSG_IF (pid < 0, "dc-bench: fork failed");
+        if (pid == 0)
+        {
+            RunOne (k, c);
+            std::cout.flush ();
+            _exit (0);
+        }
+        int status;
+        waitpid (pid, &status, 0);
+        if (!WIFEXITED (status) || WEXITSTATUS (status) != 0)
+            std::cerr << "dc-bench: k=" << k << " failed" << std::endl;
+    }
+    return 0;
+}
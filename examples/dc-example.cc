@@ -11,11 +11,27 @@ NS_LOG_COMPONENT_DEFINE ("DCExample");
 int
 main(int argc, char *argv[])
 {
+    //
+    // With --gso the vms send TCP super-segments of that size, carried as
+    // one frame (--gsoMode=Offload) or cut in MTU sized frames by the vm
+    // device (--gsoMode=Software). The bytes received by the sinks of the
+    // two modes validate the offload against the per-MTU simulation.
+    //
+    uint16_t gso = 0;
+    std::string gsoMode = "Offload";
     CommandLine cmd;
+    cmd.AddValue ("gso", "Largest TCP segment of the vms, 0 for MTU sized segments", gso);
+    cmd.AddValue ("gsoMode", "Offload or Software", gsoMode);
     cmd.Parse (argc, argv);
     
     NS_LOG_INFO ("Create level 1 switchs.");
     DCHelper helper;
+    if (gso > 0)
+    {
+        Config::SetDefault ("ns3::TcpSocket::SegmentSize", UintegerValue (gso - 40));
+        helper.SetVmDeviceAttribute ("GsoSize", UintegerValue (gso));
+        helper.SetVmDeviceAttribute ("GsoMode", StringValue (gsoMode));
+    }
     DCNodeContainer<DCSwitch> levelOneSwitchs;
     levelOneSwitchs = helper.CreateSwitchs(1);
 
@@ -85,10 +101,10 @@ main(int argc, char *argv[])
     apps.Stop(Seconds(10.0));
     PacketSinkHelper sinkHelper("ns3::TcpSocketFactory",
             Address(InetSocketAddress (Ipv4Address::GetAny(), 8888)));
-    apps = helper.InstallApps<PacketSinkHelper>(sinkHelper,userOneTenant->GetVm(1));
-    helper.InstallApps<PacketSinkHelper>(sinkHelper,userTwoTenant->GetVm(1),apps);
-    apps.Start(Seconds (0.0));
-    apps.Stop(Seconds(15.0));
+    ApplicationContainer sinks = helper.InstallApps<PacketSinkHelper>(sinkHelper,userOneTenant->GetVm(1));
+    helper.InstallApps<PacketSinkHelper>(sinkHelper,userTwoTenant->GetVm(1),sinks);
+    sinks.Start(Seconds (0.0));
+    sinks.Stop(Seconds(15.0));
 
     NS_LOG_INFO ("Enable log.");
     //LogComponentEnable ("BulkSendApplication", LOG_LEVEL_ALL);
@@ -102,6 +118,11 @@ main(int argc, char *argv[])
     NS_LOG_INFO ("Start simulation.");
     Simulator::Stop (Seconds(20));
     Simulator::Run();
+    for (uint32_t i = 0;i < sinks.GetN ();i++)
+    {
+        std::cout << "sink " << i << " received "
+                  << DynamicCast<PacketSink> (sinks.Get (i))->GetTotalRx () << " bytes" << std::endl;
+    }
     Simulator::Destroy();
     NS_LOG_INFO("Done.");
 
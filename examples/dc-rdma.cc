@@ -0,0 +1,92 @@
+#include <iostream>
+#include "ns3/core-module.h"
+#include "ns3/network-module.h"
+#include "ns3/applications-module.h"
+#include "ns3/datacenter-module.h"
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("DCRdmaExample");
+
+//
+// Incast of RDMA queue pairs: every vm except the first one sends a
+// message to the first vm, switch ports mark ecn and the senders run
+// DCQCN. No ip stack is installed on the vms.
+//
+
+static void
+MessageComplete (std::string qp, uint64_t size, Time fct)
+{
+    std::cout << qp << " " << size << " bytes in " << fct.GetMicroSeconds () << "us" << std::endl;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint32_t senders = 4;
+    uint64_t msgSize = 1000000;
+    bool dcqcn = true;
+
+    CommandLine cmd;
+    cmd.AddValue ("senders", "Number of sending vms", senders);
+    cmd.AddValue ("size", "Bytes of each message", msgSize);
+    cmd.AddValue ("dcqcn", "Mark ecn in switch queues", dcqcn);
+    cmd.Parse (argc, argv);
+
+    DCHelper helper;
+    helper.SetBridgeForward ("ns3::DCBridgeStaticForward");
+    if (dcqcn)
+    {
+        helper.SetQueueFactory ("switchQue", "ns3::DCEcnQueue");
+        helper.SetQueueFactory ("hostQue", "ns3::DCEcnQueue");
+    }
+
+    NS_LOG_INFO ("Create switchs and hosts.");
+    DCNodeContainer<DCSwitch> core = helper.CreateSwitchs (1);
+    helper.SetLinkAttribute ("DataRate", DataRateValue (DataRate ("40Gbps")));
+    helper.SetLinkAttribute ("Delay", TimeValue (MicroSeconds (1)));
+    DCNodeContainer<DCSwitch> tors = helper.CreateAndInstallSwitchs (core, 2);
+    helper.SetLinkAttribute ("DataRate", DataRateValue (DataRate ("10Gbps")));
+    DCNodeContainer<DCHost> hosts = helper.CreateAndInstallHosts (tors, (senders + 2) / 2);
+
+    NS_LOG_INFO ("Create one vm per host.");
+    DCNodeContainer<DCVm> vms;
+    for (DCNodeContainer<DCHost>::Iterator i = hosts.Begin ();i != hosts.End ();i++)
+    {
+        helper.AllocateVm (*i, DataRate ("10Gbps"), DataRate ("10Gbps"),
+                           std::map<std::string,uint64_t> (), 1, vms);
+    }
+    NS_ASSERT (vms.GetN () > senders);
+
+    NS_LOG_INFO ("Connect queue pairs.");
+    Ptr<DCVm> sink = vms.Get (0);
+    for (uint32_t i = 1;i <= senders;i++)
+    {
+        Ptr<DCVm> src = vms.Get (i);
+
+        Ptr<DCRdmaQp> rqp = CreateObject<DCRdmaQp> ();
+        rqp->SetAttribute ("Qpn", UintegerValue (i));
+        rqp->SetAttribute ("RemoteQpn", UintegerValue (i));
+        rqp->SetAttribute ("Remote", AddressValue (src->GetPointNetDeviceAddress ()));
+        sink->AddApplication (rqp);
+
+        Ptr<DCRdmaQp> sqp = CreateObject<DCRdmaQp> ();
+        sqp->SetAttribute ("Qpn", UintegerValue (i));
+        sqp->SetAttribute ("RemoteQpn", UintegerValue (i));
+        sqp->SetAttribute ("Remote", AddressValue (sink->GetPointNetDeviceAddress ()));
+        sqp->SetAttribute ("MessageSize", UintegerValue (msgSize));
+        sqp->SetStartTime (MicroSeconds (10));
+        std::stringstream ss;
+        ss << "qp" << i;
+        sqp->TraceConnect ("Complete", ss.str (), MakeCallback (&MessageComplete));
+        src->AddApplication (sqp);
+    }
+
+    NS_LOG_INFO ("Start simulation.");
+    Simulator::Stop (Seconds (1));
+    Simulator::Run ();
+    Simulator::Destroy ();
+    NS_LOG_INFO ("Done.");
+
+    return 0;
+}
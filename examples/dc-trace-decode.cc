@@ -0,0 +1,151 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+//
+// Convert a binary trace of DCHelper::EnableBinaryTrace to text.
+//
+//   dc-trace-decode [--csv] [--node=N] [--flow=HASH] trace.bin [out.txt]
+//
+// The default output is one line per event in the layout of the ascii
+// traces: event, time in seconds, node, device, uid, size and flow hash.
+// With --csv the time is in time steps and the fields are comma separated.
+// The program uses no ns-3 library, it can be built alone with
+//   g++ -O2 -I<build> dc-trace-decode.cc
+//
+
+#define DC_BINARY_TRACE_NO_NS3
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include "ns3/dc-binary-trace.h"
+
+using namespace ns3;
+
+static uint16_t
+Swap16 (uint16_t v)
+{
+    return (v >> 8) | (v << 8);
+}
+
+static uint32_t
+Swap32 (uint32_t v)
+{
+    return __builtin_bswap32 (v);
+}
+
+static uint64_t
+Swap64 (uint64_t v)
+{
+    return __builtin_bswap64 (v);
+}
+
+static void
+Usage (void)
+{
+    std::fprintf (stderr, "usage: dc-trace-decode [--csv] [--node=N] [--flow=HASH] trace.bin [out.txt]\n");
+    std::exit (1);
+}
+
+int
+main (int argc, char *argv[])
+{
+    bool csv = false;
+    int64_t node = -1;
+    int64_t flow = -1;
+    const char *in = 0;
+    const char *out = 0;
+
+    for (int i = 1;i < argc;i++)
+    {
+        if (std::strcmp (argv[i], "--csv") == 0)
+            csv = true;
+        else if (std::strncmp (argv[i], "--node=", 7) == 0)
+            node = std::strtoll (argv[i] + 7, 0, 0);
+        else if (std::strncmp (argv[i], "--flow=", 7) == 0)
+            flow = std::strtoll (argv[i] + 7, 0, 0);
+        else if (argv[i][0] == '-')
+            Usage ();
+        else if (!in)
+            in = argv[i];
+        else if (!out)
+            out = argv[i];
+        else
+            Usage ();
+    }
+    if (!in) Usage ();
+
+    std::FILE *fin = std::fopen (in, "rb");
+    if (!fin)
+    {
+        std::perror (in);
+        return 1;
+    }
+    std::FILE *fout = out ? std::fopen (out, "w") : stdout;
+    if (!fout)
+    {
+        std::perror (out);
+        return 1;
+    }
+
+    DCTraceFileHeader h;
+    if (std::fread (&h, sizeof (h), 1, fin) != 1)
+    {
+        std::fprintf (stderr, "%s: no trace header\n", in);
+        return 1;
+    }
+    bool swap = false;
+    if (h.magic == Swap32 (DCTraceFileHeader::MAGIC))
+    {
+        swap = true;
+        h.version = Swap16 (h.version);
+        h.recordSize = Swap16 (h.recordSize);
+        h.stepsPerSecond = Swap64 (h.stepsPerSecond);
+    }
+    else if (h.magic != DCTraceFileHeader::MAGIC)
+    {
+        std::fprintf (stderr, "%s: not a binary trace\n", in);
+        return 1;
+    }
+    if (h.version != DCTraceFileHeader::VERSION || h.recordSize != sizeof (DCTraceRecord))
+    {
+        std::fprintf (stderr, "%s: unsupported version %u, record size %u\n",
+                      in, h.version, h.recordSize);
+        return 1;
+    }
+
+    if (csv)
+        std::fprintf (fout, "event,time,node,device,uid,size,flow\n");
+
+    std::vector<DCTraceRecord> records (65536);
+    size_t n;
+    while ((n = std::fread (&records[0], sizeof (DCTraceRecord), records.size (), fin)) > 0)
+    {
+        for (size_t i = 0;i < n;i++)
+        {
+            DCTraceRecord &r = records[i];
+            if (swap)
+            {
+                r.time = Swap64 (r.time);
+                r.uid = Swap64 (r.uid);
+                r.node = Swap32 (r.node);
+                r.size = Swap32 (r.size);
+                r.flowHash = Swap32 (r.flowHash);
+                r.device = Swap16 (r.device);
+            }
+            if (node >= 0 && r.node != node) continue;
+            if (flow >= 0 && r.flowHash != flow) continue;
+
+            if (csv)
+                std::fprintf (fout, "%c,%lld,%u,%u,%llu,%u,%u\n",
+                              r.event, (long long)r.time, r.node, r.device,
+                              (unsigned long long)r.uid, r.size, r.flowHash);
+            else
+                std::fprintf (fout, "%c %.9f /NodeList/%u/DeviceList/%u uid=%llu size=%u flow=0x%08x\n",
+                              r.event, (double)r.time / h.stepsPerSecond, r.node, r.device,
+                              (unsigned long long)r.uid, r.size, r.flowHash);
+        }
+    }
+
+    std::fclose (fin);
+    if (out) std::fclose (fout);
+    return 0;
+}
@@ -5,13 +5,19 @@
 #include "ns3/pointer.h"
 #include "ns3/dc-bridge-net-device.h"
 #include "ns3/dc-point-net-device.h"
+#include "ns3/dc-point-channel.h"
 #include "ns3/dc-point-callback.h"
 #include "ns3/dc-bridge-callback.h"
+#include "ns3/dc-packet-classifier.h"
 #include "ns3/ptr.h"
 #include "ns3/assert.h"
 #include "ns3/object.h"
 #include "ns3/log.h"
 #include "ns3/config.h"
+#include "ns3/node-list.h"
+#include "ns3/boolean.h"
+#include "ns3/dc-async-writer.h"
+#include "ns3/dc-capture-filter.h"
 #include "dc-helper.h"
 
 #define DEFAULT_BANDWIDTH DataRate(-1)
@@ -22,18 +28,22 @@ namespace ns3 {
 
 DCHelper::DCHelper (void)
 {
-    m_linkFactory.SetTypeId ("ns3::DCCsmaChannel");
-    m_bridgeFactory.SetTypeId ("ns3::DCCsmaBridgeNetDevice");
+    m_linkFactory.SetTypeId ("ns3::DCCsmaP2PChannel");
     m_bwSupplyFactory.SetTypeId ("ns3::BwSupplyer");
     m_switchQueFactory.SetTypeId ("ns3::DropTailQueue");
     m_hostQueFactory.SetTypeId ("ns3::DropTailQueue");
     m_vmQueFactory.SetTypeId ("ns3::DropTailQueue");
     m_bridgeForwardFactory.SetTypeId ("ns3::DCBridgeLearnForward");
+    m_bridgeFactory.SetTypeId (GetBridgeTypeId ("ns3::DCBridgeLearnForward"));
     m_pointForwardFactory.SetTypeId ("ns3::DCPointNullForward");
     m_pointFactory.SetTypeId ("ns3::DCCsmaNetDevice");
+    m_vmPointFactory.SetTypeId ("ns3::DCCsmaNetDevice");
     SetHostBw(DEFAULT_BANDWIDTH);
     m_customBridgeCallback = false;
     m_customPortCallback = false;
+    m_customClassifier = false;
+    m_customSwitchBuf = false;
+    m_asyncTrace = false;
     m_addressAllocater = CreateObject<DCMac48AddressAllocater>();
 
     DCNodeContainer<DCHost>::SetAttribute("SwitchPortQueueFactory",ObjectFactoryValue(m_hostQueFactory));
@@ -41,6 +51,7 @@ DCHelper::DCHelper (void)
     DCNodeContainer<DCSwitch>::SetAttribute("PortDeviceQueueFactory",ObjectFactoryValue(m_switchQueFactory));
     DCNodeContainer<DCHost>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
     DCNodeContainer<DCSwitch>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
+    DCNodeContainer<DCHost>::SetAttribute("VmDeviceFactory",ObjectFactoryValue(m_vmPointFactory));
 }
 
 void 
@@ -53,8 +64,25 @@ void
 DCHelper::SetPointDeviceAttribute (std::string nl,const AttributeValue &vl)
 {
     m_pointFactory.Set(nl,vl);
+    m_vmPointFactory.Set(nl,vl);
     DCNodeContainer<DCHost>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
     DCNodeContainer<DCSwitch>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
+    DCNodeContainer<DCHost>::SetAttribute("VmDeviceFactory",ObjectFactoryValue(m_vmPointFactory));
+}
+
+void 
+DCHelper::SetPortDeviceAttribute (std::string nl,const AttributeValue &vl)
+{
+    m_pointFactory.Set(nl,vl);
+    DCNodeContainer<DCHost>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
+    DCNodeContainer<DCSwitch>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
+}
+
+void 
+DCHelper::SetVmDeviceAttribute (std::string nl,const AttributeValue &vl)
+{
+    m_vmPointFactory.Set(nl,vl);
+    DCNodeContainer<DCHost>::SetAttribute("VmDeviceFactory",ObjectFactoryValue(m_vmPointFactory));
 }
 
 void 
@@ -83,8 +111,10 @@ void
 DCHelper::SetPointDeviceFactory (std::string typeId)
 {
     m_pointFactory.SetTypeId(typeId);
+    m_vmPointFactory.SetTypeId(typeId);
     DCNodeContainer<DCHost>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
     DCNodeContainer<DCSwitch>::SetAttribute("PortDeviceFactory",ObjectFactoryValue(m_pointFactory));
+    DCNodeContainer<DCHost>::SetAttribute("VmDeviceFactory",ObjectFactoryValue(m_vmPointFactory));
 }
 
 void 
@@ -137,6 +167,22 @@ DCHelper::SetBridgeForward (std::string name)
     // check if the class is derived class of DCBridgeForward
     Ptr<DCBridgeForward> o = m_bridgeForwardFactory.Create<DCBridgeForward>();
     NS_ASSERT_MSG (o, "DCHelper::SetBridgeForward(): Invalid bridge forward factory!");
+
+    // keep a bridge set by the user, else take the one compiled for the forward
+    std::string bridge = m_bridgeFactory.GetTypeId ().GetName ();
+    if (bridge == "ns3::DCCsmaBridgeNetDevice" || bridge == "ns3::DCStaticBridgeNetDevice"
+        || bridge == "ns3::DCLearnBridgeNetDevice")
+        m_bridgeFactory.SetTypeId (GetBridgeTypeId (name));
+}
+
+std::string
+DCHelper::GetBridgeTypeId (std::string forward)
+{
+    if (forward == "ns3::DCBridgeStaticForward")
+        return "ns3::DCStaticBridgeNetDevice";
+    if (forward == "ns3::DCBridgeLearnForward")
+        return "ns3::DCLearnBridgeNetDevice";
+    return "ns3::DCCsmaBridgeNetDevice";
 }
 
 void
@@ -171,6 +217,28 @@ DCHelper::SetPortPktProcess (std::string name)
     NS_ASSERT_MSG (o, "DCHelper::SetPortPktProcess(): Invalid port device packet process callback!");
 }
 
+void
+DCHelper::SetClassifier (std::string name)
+{
+    m_customClassifier = true;
+    m_classifierFactory.SetTypeId(name);
+
+    // check if the class is derived class of DCPacketClassifier
+    Ptr<DCPacketClassifier> o = m_classifierFactory.Create<DCPacketClassifier>();
+    NS_ASSERT_MSG (o, "DCHelper::SetClassifier(): Invalid packet classifier!");
+}
+
+void
+DCHelper::SetSwitchBuffer (std::string name)
+{
+    m_customSwitchBuf = true;
+    m_switchBufFactory.SetTypeId(name);
+
+    // check if the class is derived class of DCSwitchBuffer
+    Ptr<DCSwitchBuffer> o = m_switchBufFactory.Create<DCSwitchBuffer>();
+    NS_ASSERT_MSG (o, "DCHelper::SetSwitchBuffer(): Invalid switch buffer!");
+}
+
 void
 DCHelper::SetFactory (std::string key, std::string typeId)
 {
@@ -178,6 +246,9 @@ DCHelper::SetFactory (std::string key, std::string typeId)
     if(key == #FAC) \
     { \
         if (key == "point") SetPointDeviceFactory(typeId); \
+        else if (key == "classifier") SetClassifier(typeId); \
+        else if (key == "switchBuf") SetSwitchBuffer(typeId); \
+        else if (key == "bridgeForward") SetBridgeForward(typeId); \
         else if (key == "switchQue" || key == "hostQue" || key == "vmQue") \
             SetQueueFactory(key,typeId); \
         else m_##FAC##Factory.SetTypeId(typeId); \
@@ -195,6 +266,8 @@ DCHelper::SetFactory (std::string key, std::string typeId)
     CHECK_AND_SET_FACTORY_ID(switchQue);
     CHECK_AND_SET_FACTORY_ID(hostQue);
     CHECK_AND_SET_FACTORY_ID(vmQue);
+    CHECK_AND_SET_FACTORY_ID(classifier);
+    CHECK_AND_SET_FACTORY_ID(switchBuf);
 }
 
 void
@@ -204,6 +277,7 @@ DCHelper::SetFactoryAttribute (std::string factory, std::string key, const Attri
     if( factory == #FAC ) \
     { \
         if (factory == "point") SetPointDeviceAttribute(key,v); \
+        else if (factory == "vmPoint") SetVmDeviceAttribute(key,v); \
         else if (factory == "switchQue" || factory == "hostQue" || factory == "vmQue") \
             SetQueueAttribute(factory,key,v); \
         else m_##FAC##Factory.Set(key,v); \
@@ -217,10 +291,13 @@ DCHelper::SetFactoryAttribute (std::string factory, std::string key, const Attri
     CHECK_AND_SET_FACTORY_ATTR(link);
     CHECK_AND_SET_FACTORY_ATTR(bridge);
     CHECK_AND_SET_FACTORY_ATTR(point);
+    CHECK_AND_SET_FACTORY_ATTR(vmPoint);
     CHECK_AND_SET_FACTORY_ATTR(bwSupply);
     CHECK_AND_SET_FACTORY_ATTR(switchQue);
     CHECK_AND_SET_FACTORY_ATTR(hostQue);
     CHECK_AND_SET_FACTORY_ATTR(vmQue);
+    CHECK_AND_SET_FACTORY_ATTR(classifier);
+    CHECK_AND_SET_FACTORY_ATTR(switchBuf);
 }
 
 DCNodeContainer<DCSwitch> 
@@ -330,7 +407,7 @@ DCHelper::CreateLink (Ptr<DCNode> upNode,Ptr<DCNode> downNode)
 {
     // create a link between up level switch
     // and down level switch
-    Ptr<DCPointChannelBase> chnl = m_linkFactory.Create<DCPointChannelBase>();
+    Ptr<DCPointChannelBase> chnl = DCCsmaP2PChannel::CreateLink(m_linkFactory);
     int32_t sDevIndex = -1;
     int32_t dDevIndex = -1;
     if (upNode->AddDownNode(downNode,chnl)) sDevIndex = upNode->GetLastAddDeviceIndex();
@@ -341,10 +418,14 @@ DCHelper::CreateLink (Ptr<DCNode> upNode,Ptr<DCNode> downNode)
     NS_ASSERT_MSG (p,"DCHelper::CreateLink(): The type of port net device must be DCCsmaNetDevice!");
     if(m_customPortCallback)
         m_portCbFactory.Create<DCPointCallback>()->Register(p);
+    if(m_customClassifier)
+        p->SetClassifier(m_classifierFactory.Create<DCPacketClassifier>());
     p = dynamic_cast<DCCsmaNetDevice*>(PeekPointer(downNode->GetDevice(dDevIndex)));
     NS_ASSERT_MSG (p,"DCHelper::CreateLink(): The type of port net device must be DCCsmaNetDevice!");
     if(m_customPortCallback)
         m_portCbFactory.Create<DCPointCallback>()->Register(p);
+    if(m_customClassifier)
+        p->SetClassifier(m_classifierFactory.Create<DCPacketClassifier>());
 }
 
 void 
@@ -396,6 +477,8 @@ DCHelper::ConfigSwitch (Ptr<DCSwitch> s)
     s->SetBridgeDevice(b);
     s->SetBridgeAddress(m_addressAllocater->Allocate());
     s->SetPortAddressAllocater(m_addressAllocater);
+    if (m_customSwitchBuf)
+        s->SetSharedBuffer(m_switchBufFactory.Create<DCSwitchBuffer>());
 }
 
 DCNodeContainer<DCVm>
@@ -474,10 +557,14 @@ DCHelper::AllocateVm (
             NS_ASSERT_MSG (p,"DCHelper::AllocateVm(): The type of port net device must be DCCsmaNetDevice!");
             if(m_customPortCallback)
                 m_portCbFactory.Create<DCPointCallback>()->Register(p);
+            if(m_customClassifier)
+                p->SetClassifier(m_classifierFactory.Create<DCPacketClassifier>());
             p = dynamic_cast<DCCsmaNetDevice*>(PeekPointer(v->GetDevice(vDevIndex)));
             NS_ASSERT_MSG (p,"DCHelper::AllocateVm(): The type of port net device must be DCCsmaNetDevice!");
             if(m_customPortCallback)
                 m_portCbFactory.Create<DCPointCallback>()->Register(p);
+            if(m_customClassifier)
+                p->SetClassifier(m_classifierFactory.Create<DCPacketClassifier>());
             p->SetForward(m_pointForwardFactory.Create<DCPointForward>());
             outVms.Add(v);
             t++;
@@ -509,6 +596,86 @@ DCHelper::AddVmToTenant (Ptr<DCTenant> t,Ptr<DCVm> v)
     t->AddVm(v);
 }
 
+Ptr<DCFlowMonitor>
+DCHelper::InstallFlowMonitor (const DCNodeContainer<DCVm>& vms)
+{
+    Ptr<DCFlowMonitor> m = CreateObject<DCFlowMonitor>();
+    DCNodeContainer<DCVm>::Iterator i;
+    for(i = vms.Begin();i != vms.End();i++)
+        m->Install(*i);
+    return m;
+}
+
+Ptr<DCPcapngWriter>
+DCHelper::EnablePcapngAll (std::string prefix, bool promiscuous)
+{
+    Ptr<DCPcapngWriter> w = CreateObject<DCPcapngWriter>();
+    w->SetAttribute("Async", BooleanValue(m_asyncTrace));
+    w->SetFilter(m_captureFilter);
+    w->Open(prefix);
+    for (NodeList::Iterator i = NodeList::Begin();i != NodeList::End();++i)
+        for (uint32_t j = 0;j < (*i)->GetNDevices();j++)
+            w->AddDevice((*i)->GetDevice(j), promiscuous);
+    return w;
+}
+
+Ptr<DCQueueSampler>
+DCHelper::EnableQueueSamplerAll (void)
+{
+    Ptr<DCQueueSampler> s = CreateObject<DCQueueSampler>();
+    for (NodeList::Iterator i = NodeList::Begin();i != NodeList::End();++i)
+        for (uint32_t j = 0;j < (*i)->GetNDevices();j++)
+            s->AddDevice((*i)->GetDevice(j));
+    return s;
+}
+
+Ptr<DCLinkMonitor>
+DCHelper::EnableLinkMonitorAll (void)
+{
+    Ptr<DCLinkMonitor> m = CreateObject<DCLinkMonitor>();
+    for (NodeList::Iterator i = NodeList::Begin();i != NodeList::End();++i)
+        for (uint32_t j = 0;j < (*i)->GetNDevices();j++)
+            m->AddDevice((*i)->GetDevice(j));
+    return m;
+}
+
+void
+DCHelper::SetAsyncTrace (bool async)
+{
+    m_asyncTrace = async;
+}
+
+void
+DCHelper::SetCaptureFilter (Ptr<DCCaptureFilter> filter)
+{
+    m_captureFilter = filter;
+}
+
+Ptr<DCBinaryTraceWriter>
+DCHelper::EnableBinaryTrace (std::string filename)
+{
+    Ptr<DCBinaryTraceWriter> w = CreateObject<DCBinaryTraceWriter>();
+    w->SetAttribute("Async", BooleanValue(m_asyncTrace));
+    w->SetFilter(m_captureFilter);
+    w->Open(filename);
+    for (NodeList::Iterator i = NodeList::Begin();i != NodeList::End();++i)
+        for (uint32_t j = 0;j < (*i)->GetNDevices();j++)
+            w->Hook((*i)->GetDevice(j));
+    return w;
+}
+
+Ptr<DCBinaryTraceWriter>
+DCHelper::EnableBinaryTrace (std::string filename, NetDeviceContainer devices)
+{
+    Ptr<DCBinaryTraceWriter> w = CreateObject<DCBinaryTraceWriter>();
+    w->SetAttribute("Async", BooleanValue(m_asyncTrace));
+    w->SetFilter(m_captureFilter);
+    w->Open(filename);
+    for (NetDeviceContainer::Iterator i = devices.Begin();i != devices.End();++i)
+        w->Hook(*i);
+    return w;
+}
+
 void 
 DCHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promiscuous, bool explicitFilename)
 {
@@ -523,6 +690,8 @@ DCHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promis
         NS_LOG_INFO ("DCHelper::EnablePcapInternal(): Device " << device << " not of type ns3::DCCsmaNetDevice");
         return;
     }
+    // the capture holds real frames, even of a header free device
+    device->EnableCapture (m_captureFilter);
 
     PcapHelper pcapHelper;
 
@@ -536,8 +705,27 @@ DCHelper::EnablePcapInternal (std::string prefix, Ptr<NetDevice> nd, bool promis
         filename = pcapHelper.GetFilenameFromDevice (prefix, device);
     }
 
+    if (m_asyncTrace)
+    {
+        Ptr<DCAsyncWriter> writer = CreateObject<DCAsyncWriter> ();
+        writer->Open (filename);
+        Ptr<DCAsyncTraceSink> sink = CreateObject<DCAsyncTraceSink> (writer);
+        sink->SetFilter (m_captureFilter);
+        sink->WritePcapHeader (65535);
+        device->TraceConnectWithoutContext (promiscuous ? "PromiscSniffer" : "Sniffer",
+                                            MakeCallback (&DCAsyncTraceSink::Pcap, sink));
+        return;
+    }
+
     Ptr<PcapFileWrapper> file = pcapHelper.CreateFile (filename, std::ios::out, 
                                                      PcapHelper::DLT_EN10MB);
+    if (m_captureFilter)
+    {
+        Ptr<DCFilteredTraceSink> sink = CreateObject<DCFilteredTraceSink> (m_captureFilter, file);
+        device->TraceConnectWithoutContext (promiscuous ? "PromiscSniffer" : "Sniffer",
+                                            MakeCallback (&DCFilteredTraceSink::Pcap, sink));
+        return;
+    }
     if (promiscuous)
     {
         pcapHelper.HookDefaultSink<DCCsmaNetDevice> (device, "PromiscSniffer", file);
@@ -566,6 +754,15 @@ DCHelper::EnableAsciiInternal (
         NS_LOG_INFO ("DCHelper::EnableAsciiInternal(): Device " << device << " not of type ns3::CsmaNetDevice");
         return;
     }
+    //
+    // The ascii sinks print the packets of the queue traces, which have no
+    // L2 headers in HeaderFreeL2 mode: the traced device sends real frames.
+    //
+    if (device->GetHeaderFreeL2 ())
+    {
+        NS_LOG_WARN ("DCHelper::EnableAsciiInternal(): turning HeaderFreeL2 off on traced device " << device);
+        device->SetHeaderFreeL2 (false);
+    }
 
     //
     // Our default trace sinks are going to use packet printing, so we have to 
@@ -598,8 +795,33 @@ DCHelper::EnableAsciiInternal (
             filename = asciiTraceHelper.GetFilenameFromDevice (prefix, device);
         }
 
+        if (m_asyncTrace)
+        {
+            Ptr<DCAsyncWriter> writer = CreateObject<DCAsyncWriter> ();
+            writer->Open (filename);
+            Ptr<DCAsyncTraceSink> sink = CreateObject<DCAsyncTraceSink> (writer);
+            sink->SetFilter (m_captureFilter);
+            device->TraceConnectWithoutContext ("MacRx", MakeCallback (&DCAsyncTraceSink::AsciiReceive, sink));
+            Ptr<Queue> queue = device->GetQueue ();
+            queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&DCAsyncTraceSink::AsciiEnqueue, sink));
+            queue->TraceConnectWithoutContext ("Drop", MakeCallback (&DCAsyncTraceSink::AsciiDrop, sink));
+            queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DCAsyncTraceSink::AsciiDequeue, sink));
+            return;
+        }
+
         Ptr<OutputStreamWrapper> theStream = asciiTraceHelper.CreateFileStream (filename);
 
+        if (m_captureFilter)
+        {
+            Ptr<DCFilteredTraceSink> sink = CreateObject<DCFilteredTraceSink> (m_captureFilter, theStream);
+            device->TraceConnectWithoutContext ("MacRx", MakeCallback (&DCFilteredTraceSink::AsciiReceive, sink));
+            Ptr<Queue> queue = device->GetQueue ();
+            queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&DCFilteredTraceSink::AsciiEnqueue, sink));
+            queue->TraceConnectWithoutContext ("Drop", MakeCallback (&DCFilteredTraceSink::AsciiDrop, sink));
+            queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DCFilteredTraceSink::AsciiDequeue, sink));
+            return;
+        }
+
         //
         // The MacRx trace source provides our "r" event.
         //
@@ -9,6 +9,13 @@
 #include "ns3/dc-switch.h"
 #include "ns3/dc-vm.h"
 #include "ns3/dc-tenant.h"
+#include "ns3/dc-flow-monitor.h"
+#include "ns3/dc-binary-trace.h"
+#include "ns3/dc-pcapng-writer.h"
+#include "ns3/dc-capture-filter.h"
+#include "ns3/dc-queue-sampler.h"
+#include "ns3/dc-link-monitor.h"
+#include "ns3/net-device-container.h"
 #include "ns3/internet-stack-helper.h"
 #include "ns3/object-factory.h"
 #include "ns3/trace-helper.h"
@@ -27,14 +34,20 @@ public:
     void SetPointDeviceFactory (std::string typeId);
     void SetQueueFactory (std::string who, std::string typeId);
     // These attribute will be used to set the port devices of host/switch
+    // and the devices of the vms
     void SetPointDeviceAttribute (std::string nl,const AttributeValue &vl);
+    // This one only to the port devices of host/switch, e.g. "HeaderFreeL2"
+    void SetPortDeviceAttribute (std::string nl,const AttributeValue &vl);
+    // This one only to the devices of the vms, e.g. "GsoSize"
+    void SetVmDeviceAttribute (std::string nl,const AttributeValue &vl);
     void SetQueueAttribute (std::string who, std::string nl,const AttributeValue &vl);
     // Set host bandwidth
     void SetHostBw (DataRate bw);
     // Set resource amount
     void SetHostResource (std::string n,uint64_t res);
     void SetHostResource (const std::map<std::string,uint64_t>& res);
-    // Set host/switch routing forward module
+    // Set host/switch routing forward module, and the bridge device
+    // compiled for it unless a custom bridge factory is set
     void SetBridgeForward (std::string name);
     // Set point device routing forward module
     void SetPointForward (std::string name);
@@ -42,6 +55,11 @@ public:
     void SetBridgePktPreProcess (std::string name);
     // Set host/switch packet process callbacks
     void SetPortPktProcess (std::string name);
+    // Set the traffic classifier of all port devices
+    void SetClassifier (std::string name);
+    // Set the shared packet memory of switchs, the switch queues
+    // must be DCMultiClassQueue
+    void SetSwitchBuffer (std::string name);
 
     void SetFactory (std::string factory, std::string typeId);
     void SetFactoryAttribute (std::string factory, std::string key, const AttributeValue& v);
@@ -99,6 +117,53 @@ public:
     void AddVmToTenant (Ptr<DCTenant> t,DCNodeContainer<DCVm>& vms);
     void AddVmToTenant (Ptr<DCTenant> t,Ptr<DCVm> v);
 
+    Ptr<DCFlowMonitor> InstallFlowMonitor (const DCNodeContainer<DCVm>& vms);
+
+    /**
+     * \brief Trace the queue and receive events of devices in one binary file.
+     *
+     * The binary replacement of EnableAscii, see DCBinaryTraceWriter. The
+     * first version traces every DCCsmaNetDevice of the simulation.
+     */
+    Ptr<DCBinaryTraceWriter> EnableBinaryTrace (std::string filename);
+    Ptr<DCBinaryTraceWriter> EnableBinaryTrace (std::string filename, NetDeviceContainer devices);
+
+    /**
+     * \brief Capture every DCCsmaNetDevice into one pcapng file.
+     *
+     * Use Config::SetDefault on ns3::DCPcapngWriter::Shards to spread the
+     * devices over a few files, see DCPcapngWriter.
+     */
+    Ptr<DCPcapngWriter> EnablePcapngAll (std::string prefix, bool promiscuous = false);
+
+    /**
+     * \brief Sample the queue depth of all the DCCsmaNetDevices, see
+     * DCQueueSampler.
+     */
+    Ptr<DCQueueSampler> EnableQueueSamplerAll (void);
+
+    /**
+     * \brief Count the bytes sent on every link in time bins, see
+     * DCLinkMonitor. Call it once the topology is built.
+     */
+    Ptr<DCLinkMonitor> EnableLinkMonitorAll (void);
+
+    /**
+     * \brief Write the pcap, ascii and binary traces enabled later from a
+     * background thread, see DCAsyncWriter.
+     *
+     * The ascii traces sharing one OutputStreamWrapper stay synchronous.
+     */
+    void SetAsyncTrace (bool async);
+
+    /**
+     * \brief Capture only the frames passing the filter in the traces
+     * enabled later, see DCCaptureFilter.
+     *
+     * The ascii traces sharing one OutputStreamWrapper are not filtered.
+     */
+    void SetCaptureFilter (Ptr<DCCaptureFilter> filter);
+
     template<typename APP_HELPER>
     ApplicationContainer InstallApps (APP_HELPER& h,
             const DCNodeContainer<DCVm>& vms);
@@ -118,6 +183,8 @@ private:
     void ConfigHost (Ptr<DCHost> h);
     void ConfigSwitchs (DCNodeContainer<DCSwitch> switchs);
     void ConfigSwitch (Ptr<DCSwitch> s);
+    // the bridge device specialized for a bridge forward type
+    static std::string GetBridgeTypeId (std::string forward);
 
     /**
      * \brief Enable pcap output on the indicated net device.
@@ -140,6 +207,9 @@ private:
      * NetDevice-specific implementation mechanism for hooking the trace and
      * writing to the trace file.
      *
+     * The ascii sinks print the packets of the queue traces, so the mode
+     * HeaderFreeL2 is turned off, with a warning, on the traced device.
+     *
      * \param stream The output stream object to use when logging ascii traces.
      * \param prefix Filename prefix to use for ascii trace files.
      * \param nd Net device for which you want to enable tracing.
@@ -162,9 +232,19 @@ private:
     bool m_customPortCallback;
     ObjectFactory m_portCbFactory;
 
+    bool m_customClassifier;
+    ObjectFactory m_classifierFactory;
+
+    bool m_asyncTrace;
+    Ptr<DCCaptureFilter> m_captureFilter;
+
+    bool m_customSwitchBuf;
+    ObjectFactory m_switchBufFactory;
+
     ObjectFactory m_linkFactory;
     ObjectFactory m_bridgeFactory;
     ObjectFactory m_pointFactory;
+    ObjectFactory m_vmPointFactory;
     ObjectFactory m_bwSupplyFactory;
     ObjectFactory m_switchQueFactory;
     ObjectFactory m_hostQueFactory;
@@ -0,0 +1,395 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+#ifdef DC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#include "ns3/log.h"
+#include "ns3/enum.h"
+#include "ns3/boolean.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "dc-capture-filter.h"
+#include "dc-async-writer.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCAsyncWriter");
+
+namespace ns3 {
+
+// a sleeping side looks at the ring again after this long even if no
+// signal came
+static const uint64_t DC_ASYNC_WAIT_NS = 10000000;
+
+NS_OBJECT_ENSURE_REGISTERED (DCAsyncWriter);
+
+TypeId
+DCAsyncWriter::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCAsyncWriter")
+        .SetParent<Object> ()
+        .AddConstructor<DCAsyncWriter> ()
+        .AddAttribute ("RingSize",
+                       "The bytes of the ring between the simulator and the writer thread, "
+                       "rounded up to a power of two.",
+                       UintegerValue (16 * 1024 * 1024),
+                       MakeUintegerAccessor (&DCAsyncWriter::SetRingSize),
+                       MakeUintegerChecker<uint32_t> (4096, 1u << 31))
+        .AddAttribute ("Backpressure",
+                       "What a write does when the ring is full.",
+                       EnumValue (BLOCK),
+                       MakeEnumAccessor (&DCAsyncWriter::m_backpressure),
+                       MakeEnumChecker (BLOCK, "BLOCK",
+                                        DROP, "DROP"))
+        .AddAttribute ("Compress",
+                       "Write the file in gzip format, needs zlib.",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&DCAsyncWriter::m_compress),
+                       MakeBooleanChecker ())
+    ;
+    return tid;
+}
+
+DCAsyncWriter::DCAsyncWriter ()
+    : m_ring (0),
+      m_ringSize (0),
+      m_mask (0),
+      m_head (0),
+      m_tail (0),
+      m_running (false),
+      m_drainWaiting (false),
+      m_writerWaiting (false),
+      m_backpressure (BLOCK),
+      m_compress (false),
+      m_file (0),
+      m_gzip (false),
+      m_dropped (0),
+      m_bytesDropped (0),
+      m_blocked (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCAsyncWriter::~DCAsyncWriter ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Close ();
+}
+
+void
+DCAsyncWriter::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Close ();
+    Object::DoDispose ();
+}
+
+void
+DCAsyncWriter::SetRingSize (uint32_t size)
+{
+    NS_LOG_FUNCTION (size);
+    NS_ASSERT_MSG (!m_ring, "DCAsyncWriter::SetRingSize(): the writer is open!");
+    m_ringSize = 1;
+    while (m_ringSize < size) m_ringSize <<= 1;
+    m_mask = m_ringSize - 1;
+}
+
+void
+DCAsyncWriter::Open (std::string filename)
+{
+    NS_LOG_FUNCTION (this << filename);
+    NS_ASSERT_MSG (!m_ring, "DCAsyncWriter::Open(): already open!");
+
+    m_filename = filename;
+    m_gzip = false;
+    if (m_compress)
+    {
+#ifdef DC_HAVE_ZLIB
+        m_file = gzopen (filename.c_str (), "wb1");
+        m_gzip = true;
+#else
+        NS_LOG_WARN ("DCAsyncWriter::Open(): built without zlib, " << filename << " is not compressed");
+        m_file = std::fopen (filename.c_str (), "wb");
+#endif
+    }
+    else
+    {
+        m_file = std::fopen (filename.c_str (), "wb");
+    }
+    NS_ABORT_MSG_UNLESS (m_file, "DCAsyncWriter::Open(): can't open " << filename);
+
+    m_ring = new uint8_t[m_ringSize];
+    m_head = m_tail = 0;
+    m_running = true;
+    m_thread = Create<SystemThread> (MakeCallback (&DCAsyncWriter::Drain, this));
+    m_thread->Start ();
+
+    Simulator::ScheduleDestroy (&DCAsyncWriter::Close, Ptr<DCAsyncWriter> (this));
+}
+
+bool
+DCAsyncWriter::IsOpen (void) const
+{
+    return m_ring != 0;
+}
+
+void
+DCAsyncWriter::Close (void)
+{
+    NS_LOG_FUNCTION (this);
+    if (!m_ring) return;
+
+    __sync_synchronize ();
+    m_running = false;
+    __sync_synchronize ();
+    Wake (m_dataReady);
+    m_thread->Join ();
+    m_thread = 0;
+
+#ifdef DC_HAVE_ZLIB
+    if (m_gzip)
+        gzclose ((gzFile)m_file);
+    else
+#endif
+        std::fclose ((std::FILE *)m_file);
+    m_file = 0;
+
+    delete [] m_ring;
+    m_ring = 0;
+
+    if (m_dropped > 0)
+    {
+        NS_LOG_WARN ("DCAsyncWriter::Close(): " << m_dropped << " records, "
+                     << m_bytesDropped << " bytes dropped from " << m_filename);
+    }
+}
+
+bool
+DCAsyncWriter::Write (const void *data, uint32_t size)
+{
+    if (!m_ring) return false;
+    NS_ASSERT_MSG (size <= m_ringSize, "DCAsyncWriter::Write(): record larger than the ring!");
+
+    uint32_t head = m_head;
+    // written this way, the sum could wrap with a ring of 2^31
+    if (m_ringSize - (head - m_tail) < size)
+    {
+        if (m_backpressure == DROP)
+        {
+            m_dropped++;
+            m_bytesDropped += size;
+            return false;
+        }
+        m_blocked++;
+        while (m_ringSize - (head - m_tail) < size)
+        {
+            m_writerWaiting = true;
+            m_spaceFreed.SetCondition (false);
+            __sync_synchronize ();
+            // the writer thread signals only after it sees m_writerWaiting
+            if (m_ringSize - (head - m_tail) < size)
+                m_spaceFreed.TimedWait (DC_ASYNC_WAIT_NS);
+            m_writerWaiting = false;
+        }
+    }
+    // the consumer is done with the bytes before m_tail
+    __sync_synchronize ();
+
+    uint32_t off = head & m_mask;
+    uint32_t first = size < m_ringSize - off ? size : m_ringSize - off;
+    std::memcpy (m_ring + off, data, first);
+    if (size > first)
+        std::memcpy (m_ring, (const uint8_t *)data + first, size - first);
+
+    // publish the bytes before the head
+    __sync_synchronize ();
+    m_head = head + size;
+    __sync_synchronize ();
+    if (m_drainWaiting)
+        Wake (m_dataReady);
+    return true;
+}
+
+void
+DCAsyncWriter::Wake (SystemCondition &condition)
+{
+    condition.SetCondition (true);
+    condition.Signal ();
+}
+
+void
+DCAsyncWriter::Output (const uint8_t *data, uint32_t size)
+{
+#ifdef DC_HAVE_ZLIB
+    if (m_gzip)
+    {
+        gzwrite ((gzFile)m_file, data, size);
+        return;
+    }
+#endif
+    std::fwrite (data, 1, size, (std::FILE *)m_file);
+}
+
+void
+DCAsyncWriter::Drain (void)
+{
+    while (true)
+    {
+        bool running = m_running;
+        __sync_synchronize ();
+        uint32_t head = m_head;
+        uint32_t tail = m_tail;
+        if (head == tail)
+        {
+            if (!running) break;
+            m_drainWaiting = true;
+            m_dataReady.SetCondition (false);
+            __sync_synchronize ();
+            // Write and Close signal only after they see m_drainWaiting
+            if (m_head == tail && m_running)
+                m_dataReady.TimedWait (DC_ASYNC_WAIT_NS);
+            m_drainWaiting = false;
+            continue;
+        }
+        // read the bytes only after seeing the head
+        __sync_synchronize ();
+
+        uint32_t off = tail & m_mask;
+        uint32_t n = head - tail;
+        uint32_t first = n < m_ringSize - off ? n : m_ringSize - off;
+        Output (m_ring + off, first);
+        if (n > first)
+            Output (m_ring, n - first);
+
+        __sync_synchronize ();
+        m_tail = head;
+        __sync_synchronize ();
+        if (m_writerWaiting)
+            Wake (m_spaceFreed);
+    }
+}
+
+uint64_t
+DCAsyncWriter::GetNDropped (void) const
+{
+    return m_dropped;
+}
+
+uint64_t
+DCAsyncWriter::GetNBytesDropped (void) const
+{
+    return m_bytesDropped;
+}
+
+uint64_t
+DCAsyncWriter::GetNBlocked (void) const
+{
+    return m_blocked;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCAsyncTraceSink);
+
+TypeId
+DCAsyncTraceSink::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCAsyncTraceSink")
+        .SetParent<Object> ()
+        .AddConstructor<DCAsyncTraceSink> ()
+    ;
+    return tid;
+}
+
+DCAsyncTraceSink::DCAsyncTraceSink ()
+    : m_snapLen (65535)
+{
+}
+
+DCAsyncTraceSink::DCAsyncTraceSink (Ptr<DCAsyncWriter> writer)
+    : m_writer (writer),
+      m_snapLen (65535)
+{
+}
+
+void
+DCAsyncTraceSink::DoDispose (void)
+{
+    m_writer = 0;
+    m_filter = 0;
+    Object::DoDispose ();
+}
+
+void
+DCAsyncTraceSink::WritePcapHeader (uint32_t snapLen)
+{
+    m_snapLen = snapLen;
+    uint32_t h[6];
+    h[0] = 0xa1b2c3d4;          // magic
+    h[1] = 2 | (4 << 16);       // version 2.4
+    h[2] = 0;                   // time zone
+    h[3] = 0;                   // sigfigs
+    h[4] = snapLen;
+    h[5] = 1;                   // DLT_EN10MB
+    m_writer->Write (h, sizeof (h));
+}
+
+void
+DCAsyncTraceSink::SetFilter (Ptr<DCCaptureFilter> filter)
+{
+    m_filter = filter;
+}
+
+void
+DCAsyncTraceSink::Pcap (Ptr<const Packet> p)
+{
+    if (m_filter && !m_filter->Match (p)) return;
+    uint32_t size = p->GetSize ();
+    uint32_t incl = size < m_snapLen ? size : m_snapLen;
+    if (m_scratch.size () < 16 + incl)
+        m_scratch.resize (16 + incl);
+
+    uint64_t us = Simulator::Now ().GetMicroSeconds ();
+    uint32_t h[4];
+    h[0] = us / 1000000;
+    h[1] = us % 1000000;
+    h[2] = incl;
+    h[3] = size;
+    std::memcpy (&m_scratch[0], h, 16);
+    p->CopyData (&m_scratch[16], incl);
+    m_writer->Write (&m_scratch[0], 16 + incl);
+}
+
+void
+DCAsyncTraceSink::Ascii (char event, Ptr<const Packet> p)
+{
+    if (m_filter && !m_filter->Match (p)) return;
+    std::ostringstream oss;
+    oss << event << " " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+    std::string s = oss.str ();
+    m_writer->Write (s.data (), s.size ());
+}
+
+void
+DCAsyncTraceSink::AsciiEnqueue (Ptr<const Packet> p)
+{
+    Ascii ('+', p);
+}
+
+void
+DCAsyncTraceSink::AsciiDequeue (Ptr<const Packet> p)
+{
+    Ascii ('-', p);
+}
+
+void
+DCAsyncTraceSink::AsciiDrop (Ptr<const Packet> p)
+{
+    Ascii ('d', p);
+}
+
+void
+DCAsyncTraceSink::AsciiReceive (Ptr<const Packet> p)
+{
+    Ascii ('r', p);
+}
+
+} // namespace ns3
@@ -0,0 +1,153 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_ASYNC_WRITER_H__
+#define __DC_ASYNC_WRITER_H__
+
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/ptr.h"
+#include "ns3/packet.h"
+#include "ns3/system-thread.h"
+#include "ns3/system-condition.h"
+
+namespace ns3 {
+
+class DCCaptureFilter;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Write a file from a background thread.
+ *
+ * The simulator thread puts the bytes in a single producer, single
+ * consumer ring, the writer thread takes them out and does the
+ * compression and the file io. The ring is lock free: the producer only
+ * moves the head, the consumer only moves the tail, both after a memory
+ * barrier. The indices are 32 bits, so they are loaded and stored whole on
+ * every target, and wrap around safely as the ring is at most 2^31 bytes.
+ *
+ * A side that finds nothing to do sleeps on a SystemCondition, the writer
+ * thread when the ring is empty and the producer when it waits for room,
+ * and the other side signals it only when it is asleep.
+ *
+ * Every Write is all or nothing, so a record is never cut. When the ring
+ * is full the producer either waits for the writer thread (Backpressure
+ * BLOCK) or drops the record and counts it (DROP).
+ *
+ * With Compress the file is written in gzip format, when the module was
+ * configured with zlib.
+ */
+class DCAsyncWriter : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    enum Backpressure
+    {
+        BLOCK,
+        DROP
+    };
+
+    DCAsyncWriter ();
+    virtual ~DCAsyncWriter ();
+
+    /**
+     * \brief Create the file and start the writer thread.
+     */
+    void Open (std::string filename);
+    /**
+     * \brief Write the bytes left in the ring, stop the thread and close
+     * the file. Called at Simulator::Destroy.
+     */
+    void Close (void);
+    bool IsOpen (void) const;
+
+    /**
+     * \param size no more than RingSize
+     * \return false if the data was dropped
+     */
+    bool Write (const void *data, uint32_t size);
+
+    uint64_t GetNDropped (void) const;
+    uint64_t GetNBytesDropped (void) const;
+    uint64_t GetNBlocked (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    void SetRingSize (uint32_t size);
+    void Drain (void);
+    void Output (const uint8_t *data, uint32_t size);
+    static void Wake (SystemCondition &condition);
+
+    uint8_t *m_ring;
+    uint32_t m_ringSize;
+    uint32_t m_mask;
+    // only the producer writes m_head, only the consumer writes m_tail
+    volatile uint32_t m_head;
+    volatile uint32_t m_tail;
+    volatile bool m_running;
+    // set by a side before it sleeps, the other side signals only then
+    volatile bool m_drainWaiting;
+    volatile bool m_writerWaiting;
+    SystemCondition m_dataReady;
+    SystemCondition m_spaceFreed;
+
+    Backpressure m_backpressure;
+    bool m_compress;
+    std::string m_filename;
+    void *m_file;       // FILE or gzFile
+    bool m_gzip;
+    Ptr<SystemThread> m_thread;
+
+    uint64_t m_dropped;
+    uint64_t m_bytesDropped;
+    uint64_t m_blocked;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The pcap and ascii trace sinks of DCHelper writing through a
+ * DCAsyncWriter.
+ *
+ * The records are built in the format of PcapFileWrapper and of the
+ * default sinks of AsciiTraceHelper, so the files are the same as the
+ * synchronous ones.
+ */
+class DCAsyncTraceSink : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCAsyncTraceSink ();
+    DCAsyncTraceSink (Ptr<DCAsyncWriter> writer);
+
+    /**
+     * \brief Write the pcap file header, ethernet link type.
+     */
+    void WritePcapHeader (uint32_t snapLen);
+    void SetFilter (Ptr<DCCaptureFilter> filter);
+
+    void Pcap (Ptr<const Packet> p);
+    void AsciiEnqueue (Ptr<const Packet> p);
+    void AsciiDequeue (Ptr<const Packet> p);
+    void AsciiDrop (Ptr<const Packet> p);
+    void AsciiReceive (Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    void Ascii (char event, Ptr<const Packet> p);
+
+    Ptr<DCAsyncWriter> m_writer;
+    Ptr<DCCaptureFilter> m_filter;
+    uint32_t m_snapLen;
+    std::vector<uint8_t> m_scratch;
+};
+
+} // namespace ns3
+
+#endif /* __DC_ASYNC_WRITER_H__ */
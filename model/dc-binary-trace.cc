@@ -0,0 +1,287 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstring>
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/queue.h"
+#include "dc-point-net-device.h"
+#include "dc-meta-tag.h"
+#include "dc-flow-monitor.h"
+#include "dc-capture-filter.h"
+#include "dc-binary-trace.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCBinaryTrace");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCBinaryTraceWriter);
+
+TypeId
+DCBinaryTraceWriter::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCBinaryTraceWriter")
+        .SetParent<Object> ()
+        .AddConstructor<DCBinaryTraceWriter> ()
+        .AddAttribute ("BufferSize",
+                       "The bytes of records kept in memory before writing them to the file.",
+                       UintegerValue (8 * 1024 * 1024),
+                       MakeUintegerAccessor (&DCBinaryTraceWriter::m_bufferSize),
+                       MakeUintegerChecker<uint32_t> (sizeof (DCTraceRecord)))
+        .AddAttribute ("Async",
+                       "Write the records through a DCAsyncWriter.",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&DCBinaryTraceWriter::m_isAsync),
+                       MakeBooleanChecker ())
+    ;
+    return tid;
+}
+
+DCBinaryTraceWriter::DCBinaryTraceWriter ()
+    : m_isAsync (false),
+      m_bufferSize (0),
+      m_buffer (0),
+      m_used (0),
+      m_file (0),
+      m_records (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCBinaryTraceWriter::~DCBinaryTraceWriter ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Close ();
+}
+
+void
+DCBinaryTraceWriter::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Close ();
+    m_filter = 0;
+    Object::DoDispose ();
+}
+
+void
+DCBinaryTraceWriter::Open (std::string filename)
+{
+    NS_LOG_FUNCTION (this << filename);
+    NS_ASSERT_MSG (!m_file && !m_async, "DCBinaryTraceWriter::Open(): already open!");
+
+    DCTraceFileHeader h;
+    std::memset (&h, 0, sizeof (h));
+    h.magic = DCTraceFileHeader::MAGIC;
+    h.version = DCTraceFileHeader::VERSION;
+    h.recordSize = sizeof (DCTraceRecord);
+    h.stepsPerSecond = Seconds (1).GetTimeStep ();
+
+    if (m_isAsync)
+    {
+        m_async = CreateObject<DCAsyncWriter> ();
+        m_async->Open (filename);
+        m_async->Write (&h, sizeof (h));
+    }
+    else
+    {
+        m_file = std::fopen (filename.c_str (), "wb");
+        NS_ABORT_MSG_UNLESS (m_file, "DCBinaryTraceWriter::Open(): can't open " << filename);
+        // the file is written in big blocks, the stdio buffer would be one more copy
+        std::setvbuf (m_file, 0, _IONBF, 0);
+
+        m_buffer = new uint8_t[m_bufferSize];
+        m_used = 0;
+        std::fwrite (&h, sizeof (h), 1, m_file);
+    }
+
+    // the records still in the buffer or the ring must reach the file at the end
+    Simulator::ScheduleDestroy (&DCBinaryTraceWriter::Close, Ptr<DCBinaryTraceWriter> (this));
+}
+
+void
+DCBinaryTraceWriter::Flush (void)
+{
+    NS_LOG_FUNCTION (this);
+    if (!m_file || m_used == 0) return;
+    if (std::fwrite (m_buffer, 1, m_used, m_file) != m_used)
+    {
+        NS_LOG_WARN ("DCBinaryTraceWriter::Flush(): short write, records lost");
+    }
+    m_used = 0;
+}
+
+void
+DCBinaryTraceWriter::Close (void)
+{
+    NS_LOG_FUNCTION (this);
+    if (m_async)
+    {
+        m_async->Close ();
+        m_async = 0;
+    }
+    if (!m_file) return;
+    Flush ();
+    std::fclose (m_file);
+    m_file = 0;
+    delete [] m_buffer;
+    m_buffer = 0;
+}
+
+void
+DCBinaryTraceWriter::Write (const DCTraceRecord &record)
+{
+    if (m_async)
+    {
+        if (m_async->Write (&record, sizeof (record)))
+            m_records++;
+        return;
+    }
+    if (!m_file) return;
+    if (m_used + sizeof (record) > m_bufferSize)
+        Flush ();
+    std::memcpy (m_buffer + m_used, &record, sizeof (record));
+    m_used += sizeof (record);
+    m_records++;
+}
+
+uint64_t
+DCBinaryTraceWriter::GetNRecords (void) const
+{
+    return m_records;
+}
+
+void
+DCBinaryTraceWriter::SetFilter (Ptr<DCCaptureFilter> filter)
+{
+    m_filter = filter;
+}
+
+Ptr<DCCaptureFilter>
+DCBinaryTraceWriter::GetFilter (void) const
+{
+    return m_filter;
+}
+
+void
+DCBinaryTraceWriter::Hook (Ptr<NetDevice> nd)
+{
+    NS_LOG_FUNCTION (this << nd);
+    Ptr<DCCsmaNetDevice> device = nd->GetObject<DCCsmaNetDevice> ();
+    if (device == 0)
+    {
+        NS_LOG_INFO ("DCBinaryTraceWriter::Hook(): Device " << nd << " not of type ns3::DCCsmaNetDevice");
+        return;
+    }
+    // MacRx fires with real frames, even on a header free device
+    device->EnableCapture (m_filter);
+
+    Ptr<DCBinaryTraceProbe> probe = CreateObject<DCBinaryTraceProbe> (
+            this, nd->GetNode ()->GetId (), nd->GetIfIndex ());
+    device->TraceConnectWithoutContext ("MacRx", MakeCallback (&DCBinaryTraceProbe::Receive, probe));
+    Ptr<Queue> queue = device->GetQueue ();
+    queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&DCBinaryTraceProbe::Enqueue, probe));
+    queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DCBinaryTraceProbe::Dequeue, probe));
+    queue->TraceConnectWithoutContext ("Drop", MakeCallback (&DCBinaryTraceProbe::Drop, probe));
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCBinaryTraceProbe);
+
+TypeId
+DCBinaryTraceProbe::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCBinaryTraceProbe")
+        .SetParent<Object> ()
+        .AddConstructor<DCBinaryTraceProbe> ()
+    ;
+    return tid;
+}
+
+DCBinaryTraceProbe::DCBinaryTraceProbe ()
+    : m_node (0),
+      m_device (0)
+{
+}
+
+DCBinaryTraceProbe::DCBinaryTraceProbe (Ptr<DCBinaryTraceWriter> writer, uint32_t node, uint16_t device)
+    : m_writer (writer),
+      m_node (node),
+      m_device (device)
+{
+}
+
+void
+DCBinaryTraceProbe::DoDispose (void)
+{
+    m_writer = 0;
+    Object::DoDispose ();
+}
+
+void
+DCBinaryTraceProbe::Record (uint8_t event, Ptr<const Packet> p)
+{
+    if (!m_writer) return;
+    Ptr<DCCaptureFilter> filter = m_writer->GetFilter ();
+    uint32_t hash = 0;
+    DCMetaTag meta;
+    if (filter)
+    {
+        DCFlowMonitor::FlowKey key;
+        if (!DCFlowMonitor::ParseKey (p, key)) return;
+        hash = DCFlowMonitor::KeyHash (key);
+        if (!filter->Match (key)) return;
+    }
+    else if (p->PeekPacketTag (meta))
+    {
+        // the hash of the flow key, stamped by the sending vm
+        hash = meta.GetFlowId ();
+    }
+    else
+    {
+        DCFlowMonitor::FlowKey key;
+        if (DCFlowMonitor::ParseKey (p, key))
+            hash = DCFlowMonitor::KeyHash (key);
+    }
+
+    DCTraceRecord r;
+    r.time = Simulator::Now ().GetTimeStep ();
+    r.uid = p->GetUid ();
+    r.node = m_node;
+    r.size = p->GetSize ();
+    DCL2MetaTag l2;
+    if (p->PeekPacketTag (l2))
+    {
+        // a header free frame in a queue, count the headers it leaves out
+        r.size += l2.GetOverhead ();
+    }
+    r.flowHash = hash;
+    r.device = m_device;
+    r.event = event;
+    r.reserved = 0;
+    m_writer->Write (r);
+}
+
+void
+DCBinaryTraceProbe::Enqueue (Ptr<const Packet> p)
+{
+    Record (DCTraceRecord::ENQUEUE, p);
+}
+
+void
+DCBinaryTraceProbe::Dequeue (Ptr<const Packet> p)
+{
+    Record (DCTraceRecord::DEQUEUE, p);
+}
+
+void
+DCBinaryTraceProbe::Drop (Ptr<const Packet> p)
+{
+    Record (DCTraceRecord::DROP, p);
+}
+
+void
+DCBinaryTraceProbe::Receive (Ptr<const Packet> p)
+{
+    Record (DCTraceRecord::RECEIVE, p);
+}
+
+} // namespace ns3
@@ -0,0 +1,161 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_BINARY_TRACE_H__
+#define __DC_BINARY_TRACE_H__
+
+#include <stdint.h>
+#include <cstdio>
+#include <string>
+
+#ifndef DC_BINARY_TRACE_NO_NS3
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/net-device.h"
+#include "dc-async-writer.h"
+#endif
+
+namespace ns3 {
+
+class DCCaptureFilter;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The header of a binary trace file, 24 bytes.
+ */
+struct DCTraceFileHeader
+{
+    static const uint32_t MAGIC = 0x52544344;   // "DCTR" in little endian
+    static const uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint64_t stepsPerSecond;    // resolution of the time of the records
+    uint64_t reserved;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief One event of a binary trace, 32 bytes.
+ *
+ * The fields are in the byte order of the machine writing the trace, the
+ * magic of the file header tells the reader if it has to swap them.
+ */
+struct DCTraceRecord
+{
+    enum Event
+    {
+        ENQUEUE = '+',
+        DEQUEUE = '-',
+        DROP = 'd',
+        RECEIVE = 'r'
+    };
+
+    int64_t time;       // in time steps
+    uint64_t uid;
+    uint32_t node;
+    uint32_t size;
+    uint32_t flowHash;  // DCFlowMonitor::KeyHash of the frame
+    uint16_t device;
+    uint8_t event;
+    uint8_t reserved;
+};
+
+#ifndef DC_BINARY_TRACE_NO_NS3
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Write DCTraceRecords to a file through a large buffer.
+ *
+ * It is the binary replacement of the ascii traces of DCHelper, see
+ * DCHelper::EnableBinaryTrace. A record is 32 bytes against a few hundred
+ * bytes of an ascii line, and appending it is a copy into the buffer
+ * instead of printing the packet. The buffer goes to the file when it is
+ * full, when Flush is called and at Simulator::Destroy.
+ *
+ * With Async the records go through a DCAsyncWriter, its thread does
+ * the file io.
+ *
+ * Use the dc-trace-decode program to convert a trace to text.
+ */
+class DCBinaryTraceWriter : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCBinaryTraceWriter ();
+    virtual ~DCBinaryTraceWriter ();
+
+    /**
+     * \brief Create the file and write its header.
+     */
+    void Open (std::string filename);
+    void Close (void);
+    void Flush (void);
+
+    void Write (const DCTraceRecord &record);
+
+    /**
+     * \brief Connect the queue and MacRx traces of a DCCsmaNetDevice.
+     */
+    void Hook (Ptr<NetDevice> nd);
+
+    uint64_t GetNRecords (void) const;
+
+    /**
+     * \brief Write only the frames passing the filter. Set it before
+     * Hook, see DCCsmaNetDevice::EnableCapture.
+     */
+    void SetFilter (Ptr<DCCaptureFilter> filter);
+    Ptr<DCCaptureFilter> GetFilter (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    bool m_isAsync;
+    Ptr<DCAsyncWriter> m_async;
+    Ptr<DCCaptureFilter> m_filter;
+    uint32_t m_bufferSize;
+    uint8_t *m_buffer;
+    uint32_t m_used;
+    std::FILE *m_file;
+    uint64_t m_records;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The trace sinks of one net device of a DCBinaryTraceWriter.
+ */
+class DCBinaryTraceProbe : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCBinaryTraceProbe ();
+    DCBinaryTraceProbe (Ptr<DCBinaryTraceWriter> writer, uint32_t node, uint16_t device);
+
+    void Enqueue (Ptr<const Packet> p);
+    void Dequeue (Ptr<const Packet> p);
+    void Drop (Ptr<const Packet> p);
+    void Receive (Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    void Record (uint8_t event, Ptr<const Packet> p);
+
+    Ptr<DCBinaryTraceWriter> m_writer;
+    uint32_t m_node;
+    uint16_t m_device;
+};
+
+#endif /* DC_BINARY_TRACE_NO_NS3 */
+
+} // namespace ns3
+
+#endif /* __DC_BINARY_TRACE_H__ */
@@ -2,10 +2,13 @@
 #include <algorithm>
 #include "ns3/log.h"
 #include "ns3/simulator.h"
+#include "ns3/boolean.h"
+#include "dc-log.h"
 #include "dc-bridge-forward.h"
 #include "dc-node-list.h"
 #include "dc-vm.h"
 #include "dc-bridge-net-device-base.h"
+#include "dc-meta-tag.h"
 
 #include <cstdio>
 
@@ -43,21 +46,21 @@ DCBridgeLearnForward::GetTypeId(void)
 
 DCBridgeLearnForward::DCBridgeLearnForward (const Time& expirationTime)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-	NS_LOG_DEBUG ("Using DCBridgeLearnForward");
-    NS_LOG_DEBUG ("LearningBridgeForward (expirationTime=" << expirationTime
+    DC_LOG_FUNCTION_NOARGS ();
+	DC_LOG_DEBUG ("Using DCBridgeLearnForward");
+    DC_LOG_DEBUG ("LearningBridgeForward (expirationTime=" << expirationTime
                                                            << ")");
     m_expirationTime = expirationTime;
 }
 
 DCBridgeLearnForward::DCBridgeLearnForward ()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 }
 
 DCBridgeLearnForward::~DCBridgeLearnForward ()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 }
 
 Ptr<NetDevice> 
@@ -68,7 +71,7 @@ DCBridgeLearnForward::GetOutPort (
     Ptr<const Packet> packet 
     ) 
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 
     Time now = Simulator::Now ();
     std::map<Mac48Address, LearnedState>::iterator iter =
@@ -97,7 +100,7 @@ DCBridgeLearnForward::Learn (
     Ptr<const Packet> packet
     ) 
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     
     LearnedState &state = m_learnState[src];
     state.associatedPort = const_cast<NetDevice*>(PeekPointer(incomingPort));
@@ -107,8 +110,8 @@ DCBridgeLearnForward::Learn (
 void
 DCBridgeLearnForward::SetExpirationTime (const Time& expirationTime)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-    NS_LOG_DEBUG ("LearningBridgeForward (expirationTime=" << expirationTime
+    DC_LOG_FUNCTION_NOARGS ();
+    DC_LOG_DEBUG ("LearningBridgeForward (expirationTime=" << expirationTime
                                                            << ")");
     m_expirationTime = expirationTime;  
 }
@@ -174,7 +177,7 @@ DCTopologyTree::FindOutNodes2Dst (
 	std::vector<Ptr<Node> > ret;
 	std::map<Ptr<Node>,TreeNode>::iterator iter;
 	iter = m_treeMap.find(const_cast<Node*>(PeekPointer(src)));
-	NS_ASSERT(iter != m_treeMap.end());
+	DC_ASSERT(iter != m_treeMap.end());
 	std::vector<Ptr<Node> >::iterator i;
 	for (i = iter->second.childs.begin();i != iter->second.childs.end();i++)
 	{
@@ -222,25 +225,30 @@ DCBridgeStaticForward::GetTypeId(void)
             RandomVariableValue(SequentialVariable(0,9999,1,1)),
             MakeRandomVariableAccessor (&DCBridgeStaticForward::m_random),
             MakeRandomVariableChecker ())
+        .AddAttribute ("FlowHash", "Choose among equal ports by the flow of the DCMetaTag, not at random",
+            BooleanValue (false),
+            MakeBooleanAccessor (&DCBridgeStaticForward::m_flowHash),
+            MakeBooleanChecker ())
     ;
     return tid;
 }
 
 DCBridgeStaticForward::DCBridgeStaticForward (void)
+    : m_flowHash (false)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-	NS_LOG_DEBUG ("Using DCBridgeStaticForward");
+    DC_LOG_FUNCTION_NOARGS ();
+	DC_LOG_DEBUG ("Using DCBridgeStaticForward");
 }
 
 DCBridgeStaticForward::~DCBridgeStaticForward (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 }
 
 void
 DCBridgeStaticForward::SetRoutingTree(Ptr<DCTopologyTree> tree)
 {
-	NS_LOG_FUNCTION_NOARGS ();
+	DC_LOG_FUNCTION_NOARGS ();
 	m_topo = tree;
 }
 
@@ -258,7 +266,7 @@ DCBridgeStaticForward::GetOutPort (
     Ptr<const Packet> packet 
     )
 {
-    NS_LOG_FUNCTION_NOARGS ();  
+    DC_LOG_FUNCTION_NOARGS ();  
 
     if (!m_topo) BuildTopoTree();
 	if (m_binding.find(dst) == m_binding.end())
@@ -289,16 +297,43 @@ DCBridgeStaticForward::GetOutPort (
 		m_binding[dst] = retDevices;
 	}
 
-	if (m_binding[dst].empty()) return NULL;
-	return m_binding[dst][m_random.GetInteger()%m_binding[dst].size()];
+	std::vector<Ptr<NetDevice> > &ports = m_binding[dst];
+	if (ports.empty()) return NULL;
+
+	// ECMP: every frame of a flow takes the same port. The flow hash is
+	// salted with the node and mixed again, or the next tier would pick
+	// the same index and leave some of its ports unused.
+	DCMetaTag meta;
+	if (m_flowHash && packet->PeekPacketTag(meta))
+	{
+		uint32_t h = meta.GetFlowId() ^ (bridge->GetNode()->GetId() * 0x9e3779b9u);
+		h ^= h >> 16;
+		h *= 0x85ebca6bu;
+		h ^= h >> 13;
+		h *= 0xc2b2ae35u;
+		h ^= h >> 16;
+		return ports[h%ports.size()];
+	}
+	return ports[m_random.GetInteger()%ports.size()];
 }
 
 void 
 DCBridgeStaticForward::BuildTopoTree()
 {
-    if(!m_topo) m_topo = CreateObject<DCTopologyTree>();
+    if(!m_topo)
+    {
+        m_topo = CreateObject<DCTopologyTree>();
+        // the tree belongs to one simulation
+        Simulator::ScheduleDestroy(&DCBridgeStaticForward::ClearTopoTree);
+    }
     m_topo->Build();
 }
 
+void
+DCBridgeStaticForward::ClearTopoTree()
+{
+    m_topo = NULL;
+}
+
 }
 
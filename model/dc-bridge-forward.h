@@ -37,6 +37,11 @@ public:
             ) = 0;   
 
 	virtual bool Flooding (void) = 0;
+
+    /**
+     * \return the entries of the forwarding table
+     */
+    virtual uint32_t GetNEntries (void) const {return 0;}
 };
 
 class DCBridgeLearnForward : public DCBridgeForward
@@ -66,6 +71,8 @@ public:
 
 	bool Flooding (void) {return true;}
 
+    uint32_t GetNEntries (void) const {return m_learnState.size();}
+
 private:
     Time m_expirationTime; // time it takes for learned MAC state to expire
     struct LearnedState
@@ -131,15 +138,20 @@ public:
 
 	bool Flooding (void) {return false;}
 
+    uint32_t GetNEntries (void) const {return m_binding.size();}
+
 private:
     std::map<Mac48Address, std::vector<Ptr<NetDevice> > > m_binding;
 
     static void BuildTopoTree();
+    static void ClearTopoTree();
 
     static Ptr<DCTopologyTree> m_topo;
 
 	// Random variable used to choose port
 	RandomVariable m_random;
+	// or the flow of the DCMetaTag, for ECMP
+	bool m_flowHash;
 };
 
 
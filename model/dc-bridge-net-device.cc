@@ -5,16 +5,23 @@
 #include "ns3/uinteger.h"
 #include "ns3/packet.h"
 #include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/trace-source-accessor.h"
+#include "dc-log.h"
 #include "dc-bridge-forward.h"
 #include "dc-bridge-channel.h"
 #include "dc-bridge-net-device-base.h"
 #include "dc-bridge-net-device.h"
+#include "dc-point-net-device.h"
+#include "dc-int.h"
 
 NS_LOG_COMPONENT_DEFINE ("DCCsmaBridgeNetDevice");
 
 namespace ns3 {
 
 NS_OBJECT_ENSURE_REGISTERED (DCCsmaBridgeNetDevice);
+NS_OBJECT_ENSURE_REGISTERED (DCStaticBridgeNetDevice);
+NS_OBJECT_ENSURE_REGISTERED (DCLearnBridgeNetDevice);
 
 TypeId
 DCCsmaBridgeNetDevice::GetTypeId (void)
@@ -35,32 +42,72 @@ DCCsmaBridgeNetDevice::GetTypeId (void)
                        BooleanValue(true),
                        MakeBooleanAccessor (&DCCsmaBridgeNetDevice::m_enableArp),
                        MakeBooleanChecker ())
+        .AddAttribute ("CutThrough", "Forward frames in cut-through mode, "
+                       "applied to the ports added afterwards",
+                       BooleanValue(false),
+                       MakeBooleanAccessor (&DCCsmaBridgeNetDevice::m_cutThrough),
+                       MakeBooleanChecker ())
+        .AddAttribute ("CutThroughBytes", "Bytes of a frame received before it is forwarded in cut-through mode",
+                       UintegerValue (64),
+                       MakeUintegerAccessor (&DCCsmaBridgeNetDevice::m_cutThroughBytes),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("Pipelines", "The number of forwarding pipelines",
+                       UintegerValue (1),
+                       MakeUintegerAccessor (&DCCsmaBridgeNetDevice::m_nPipelines),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("LookupLatency", "The time a pipeline takes to forward a frame",
+                       TimeValue (Seconds (0)),
+                       MakeTimeAccessor (&DCCsmaBridgeNetDevice::m_lookupLatency),
+                       MakeTimeChecker ())
+        .AddAttribute ("PipelineRate", "Frames per second a pipeline can start, 0 means unlimited",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCCsmaBridgeNetDevice::m_pipelineRate),
+                       MakeUintegerChecker<uint64_t> ())
+        .AddAttribute ("PipelineQueueSize", "Frames held by a pipeline before new ones are dropped",
+                       UintegerValue (1024),
+                       MakeUintegerAccessor (&DCCsmaBridgeNetDevice::m_pipelineQueueSize),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddTraceSource ("PipelineEnqueue",
+                         "A frame entered a pipeline: frame, pipeline, frames in the pipeline",
+                         MakeTraceSourceAccessor (&DCCsmaBridgeNetDevice::m_pipelineEnqueueTrace))
+        .AddTraceSource ("PipelineDequeue",
+                         "A frame left a pipeline: frame, pipeline, time spent in the pipeline",
+                         MakeTraceSourceAccessor (&DCCsmaBridgeNetDevice::m_pipelineDequeueTrace))
+        .AddTraceSource ("PipelineDrop",
+                         "A frame was dropped by a full pipeline: frame, pipeline",
+                         MakeTraceSourceAccessor (&DCCsmaBridgeNetDevice::m_pipelineDropTrace))
     ;
     return tid;
 }
 
 
 DCCsmaBridgeNetDevice::DCCsmaBridgeNetDevice ()
-  : m_node (0), m_ifIndex (0)
+  : m_node (0), m_ifIndex (0), m_cutThrough (false), m_cutThroughBytes (64),
+    m_nPipelines (1), m_pipelineRate (0), m_pipelineQueueSize (1024)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_channel = CreateObject<DCCsmaBridgeChannel> ();
 }
 
 DCCsmaBridgeNetDevice::~DCCsmaBridgeNetDevice()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 }
 
 void
 DCCsmaBridgeNetDevice::DoDispose ()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     for (std::vector< Ptr<NetDevice> >::iterator iter = m_ports.begin (); iter != m_ports.end (); iter++)
     {
+        Ptr<DCCsmaNetDevice> port = DynamicCast<DCCsmaNetDevice> (*iter);
+        if (port) port->SetBridge (0);
         *iter = 0;
     }
     m_ports.clear ();
+    m_csmaPorts.clear ();
+    m_portPipeline.clear ();
+    m_pipelines.clear ();
     m_channel = 0;
     m_node = 0;
     NetDevice::DoDispose ();
@@ -70,11 +117,77 @@ void
 DCCsmaBridgeNetDevice::ReceiveFromDevice (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t protocol,
                                     Address const &src, Address const &dst, PacketType packetType)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-    NS_LOG_DEBUG ("UID is " << packet->GetUid ());
+    DC_LOG_FUNCTION_NOARGS ();
+    ReceiveFromPort (incomingPort, packet, protocol,
+                     Mac48Address::ConvertFrom (src), Mac48Address::ConvertFrom (dst), packetType);
+}
+
+void
+DCCsmaBridgeNetDevice::ReceiveFromPort (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t protocol,
+                                  Mac48Address src, Mac48Address dst, PacketType packetType)
+{
+    DC_LOG_FUNCTION_NOARGS ();
+
+    if (m_lookupLatency.IsZero () && m_pipelineRate == 0)
+    {
+        ProcessFromDevice (incomingPort, packet, protocol, src, dst, packetType);
+        return;
+    }
+
+    if (m_pipelines.size () != m_nPipelines)
+        m_pipelines.resize (m_nPipelines);
+    uint32_t ifIndex = incomingPort->GetIfIndex ();
+    uint32_t id = ifIndex < m_portPipeline.size () ? m_portPipeline[ifIndex] % m_nPipelines : 0;
+    Pipeline &pipeline = m_pipelines[id];
+
+    if (pipeline.items.size () >= m_pipelineQueueSize)
+    {
+        DC_LOG_LOGIC ("Pipeline " << id << " full, drop " << packet);
+        m_pipelineDropTrace (packet, id);
+        return;
+    }
+
+    //
+    // The pipeline starts a frame every 1/PipelineRate second and the
+    // frame comes out LookupLatency later, so frames leave in order.
+    //
+    Time now = Simulator::Now ();
+    Time start = pipeline.nextFree > now ? pipeline.nextFree : now;
+    if (m_pipelineRate > 0)
+        pipeline.nextFree = start + Seconds (1.0 / m_pipelineRate);
+
+    PipelineItem item;
+    item.port = incomingPort;
+    item.packet = packet;
+    item.protocol = protocol;
+    item.src = src;
+    item.dst = dst;
+    item.packetType = packetType;
+    item.arrival = now;
+    pipeline.items.push_back (item);
+    m_pipelineEnqueueTrace (packet, id, pipeline.items.size ());
+
+    Simulator::Schedule (start - now + m_lookupLatency, &DCCsmaBridgeNetDevice::PipelineComplete, this, id);
+}
+
+void
+DCCsmaBridgeNetDevice::PipelineComplete (uint32_t id)
+{
+    DC_LOG_FUNCTION (this << id);
+    DC_ASSERT (id < m_pipelines.size () && !m_pipelines[id].items.empty ());
+
+    PipelineItem item = m_pipelines[id].items.front ();
+    m_pipelines[id].items.pop_front ();
+    m_pipelineDequeueTrace (item.packet, id, Simulator::Now () - item.arrival);
+    ProcessFromDevice (item.port, item.packet, item.protocol, item.src, item.dst, item.packetType);
+}
 
-    Mac48Address src48 = Mac48Address::ConvertFrom (src);
-    Mac48Address dst48 = Mac48Address::ConvertFrom (dst);
+void
+DCCsmaBridgeNetDevice::ProcessFromDevice (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet, uint16_t protocol,
+                                    Mac48Address src, Mac48Address dst, PacketType packetType)
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    DC_LOG_DEBUG ("UID is " << packet->GetUid ());
 
     if (!m_promiscRxCallback.IsNull ())
     {
@@ -90,7 +203,7 @@ DCCsmaBridgeNetDevice::ReceiveFromDevice (Ptr<NetDevice> incomingPort, Ptr<const
     switch (packetType)
     {
     case PACKET_HOST:
-        if (dst48 == m_address)
+        if (dst == m_address)
         {
             m_rxCallback (this, packet, protocol, src);
         }
@@ -99,17 +212,17 @@ DCCsmaBridgeNetDevice::ReceiveFromDevice (Ptr<NetDevice> incomingPort, Ptr<const
     case PACKET_BROADCAST:
     case PACKET_MULTICAST:
         m_rxCallback (this, packet, protocol, src);
-        ForwardBroadcast (incomingPort, packet, protocol, src48, dst48);
+        ForwardBroadcast (incomingPort, packet, protocol, src, dst);
         break;
 
     case PACKET_OTHERHOST:
-        if (dst48 == m_address)
+        if (dst == m_address)
         {
             m_rxCallback (this, packet, protocol, src);
         }
         else
         {
-            ForwardUnicast (incomingPort, packet, protocol, src48, dst48);
+            ForwardUnicast (incomingPort, packet, protocol, src, dst);
         }
         break;
     }
@@ -119,41 +232,31 @@ void
 DCCsmaBridgeNetDevice::ForwardUnicast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
                                  uint16_t protocol, Mac48Address src, Mac48Address dst)
 {
-	NS_LOG_FUNCTION_NOARGS ();
-	NS_LOG_DEBUG ("BridgeForward (incomingPort=" << incomingPort->GetInstanceTypeId ().GetName ()
+	DC_LOG_FUNCTION_NOARGS ();
+	DC_LOG_DEBUG ("BridgeForward (incomingPort=" << incomingPort->GetInstanceTypeId ().GetName ()
 												 << ", packet=" << packet << ", protocol="<<protocol
 												 << ", src=" << src << ", dst=" << dst << ")");
 	
-    NS_ASSERT_MSG (m_forward, "DCCsmaBridgeNetDevice::ForwardUnicast(): forward decision module can't be NULL!");
+    DC_ASSERT_MSG (m_forward, "DCCsmaBridgeNetDevice::ForwardUnicast(): forward decision module can't be NULL!");
 	m_forward->Learn (this,incomingPort,src,dst,packet);
 	Ptr<NetDevice> outPort = m_forward->GetOutPort(this,src,dst,packet);
 	if (outPort != NULL && outPort != incomingPort)
 	{
-		NS_LOG_LOGIC ("BridgeForward state says to use port `" << outPort->GetInstanceTypeId ().GetName () << "'");
-		outPort->SendFrom (packet->Copy (), src, dst, protocol);
+		DC_LOG_LOGIC ("BridgeForward state says to use port `" << outPort->GetInstanceTypeId ().GetName () << "'");
+		Ptr<Packet> copy = packet->Copy ();
+		AppendInt (copy, outPort);
+		outPort->SendFrom (copy, src, dst, protocol);
 	}
 	else
 	{
 		if (m_forward->Flooding())
 		{
-			NS_LOG_LOGIC ("No forward state: send through all ports");
-			for (std::vector< Ptr<NetDevice> >::iterator iter = m_ports.begin ();
-			   iter != m_ports.end (); iter++)
-			{
-			    Ptr<NetDevice> port = *iter;
-			    if (port != incomingPort)
-			    {
-				    NS_LOG_LOGIC ("BridgeForward (" << src << " => " << dst << "): " 
-														<< incomingPort->GetInstanceTypeId ().GetName ()
-														<< " --> " << port->GetInstanceTypeId ().GetName ()
-														<< " (UID " << packet->GetUid () << ").");
-				    port->SendFrom (packet->Copy (), src, dst, protocol);
-			    }
-		    }
+			DC_LOG_LOGIC ("No forward state: send through all ports");
+			Flood (incomingPort, packet, protocol, src, dst);
         }
         else
 		{
-			NS_LOG_LOGIC ("No forward state and flooding is forbidden");
+			DC_LOG_LOGIC ("No forward state and flooding is forbidden");
 		}
     }
 }
@@ -162,35 +265,84 @@ void
 DCCsmaBridgeNetDevice::ForwardBroadcast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
                                    uint16_t protocol, Mac48Address src, Mac48Address dst)
 {
-	NS_LOG_FUNCTION_NOARGS ();
-	NS_LOG_DEBUG ("BridgeForward (incomingPort=" << incomingPort->GetInstanceTypeId ().GetName ()
+	DC_LOG_FUNCTION_NOARGS ();
+	DC_LOG_DEBUG ("BridgeForward (incomingPort=" << incomingPort->GetInstanceTypeId ().GetName ()
 														 << ", packet=" << packet << ", protocol="<<protocol
 														 << ", src=" << src << ", dst=" << dst << ")");
 	
-    NS_ASSERT_MSG (m_forward, "DCCsmaBridgeNetDevice::ForwardBroadcast(): forward decision module can't be NULL!");
+    DC_ASSERT_MSG (m_forward, "DCCsmaBridgeNetDevice::ForwardBroadcast(): forward decision module can't be NULL!");
     m_forward->Learn (this,incomingPort,src,dst,packet);
 	
 	if (m_forward->Flooding())
-    for (std::vector< Ptr<NetDevice> >::iterator iter = m_ports.begin ();
-       iter != m_ports.end (); iter++)
+        Flood (incomingPort, packet, protocol, src, dst);
+}
+
+void
+DCCsmaBridgeNetDevice::Flood (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
+                        uint16_t protocol, Mac48Address src, Mac48Address dst)
+{
+    //
+    // The DCCsmaNetDevice ports share one frame, built by the first of
+    // them, or again by a port with another framing. Every port gets a
+    // copy of the frame, which shares its bytes and has its own tags.
+    //
+    Ptr<Packet> frame;
+    DCCsmaNetDevice *framer = 0;
+    for (uint32_t i = 0;i < m_ports.size ();i++)
     {
-        Ptr<NetDevice> port = *iter;
+        Ptr<NetDevice> port = m_ports[i];
         if (port != incomingPort)
         {
-            NS_LOG_LOGIC ("BridgeForward (" << src << " => " << dst << "): " 
+            DC_LOG_LOGIC ("BridgeForward (" << src << " => " << dst << "): " 
                                                   << incomingPort->GetInstanceTypeId ().GetName ()
                                                   << " --> " << port->GetInstanceTypeId ().GetName ()
                                                   << " (UID " << packet->GetUid () << ").");
-            port->SendFrom (packet->Copy (), src, dst, protocol);
+            DCCsmaNetDevice *csmaPort = m_csmaPorts[i];
+            if (csmaPort == 0)
+            {
+                Ptr<Packet> copy = packet->Copy ();
+                AppendInt (copy, port);
+                port->SendFrom (copy, src, dst, protocol);
+                continue;
+            }
+            if (frame == 0 || !csmaPort->HasSameFraming (framer))
+            {
+                frame = packet->Copy ();
+                csmaPort->Frame (frame, src, dst, protocol);
+                framer = csmaPort;
+            }
+            Ptr<Packet> copy = frame->Copy ();
+            AppendInt (copy, port);
+            csmaPort->SendFramed (copy, packet, src, dst, protocol);
         }
     }
 }
 
+void
+DCCsmaBridgeNetDevice::AppendInt (Ptr<Packet> packet, Ptr<NetDevice> outPort)
+{
+    DCIntTag tag;
+    if (!packet->RemovePacketTag (tag)) return;
+    DCIntRecord record;
+    record.SetSwitchId (m_node->GetId ());
+    record.SetEgressPort (outPort->GetIfIndex ());
+    record.SetTimestamp (Simulator::Now ());
+    Ptr<DCCsmaNetDevice> port = DynamicCast<DCCsmaNetDevice> (outPort);
+    if (port)
+    {
+        record.SetQueueDepth (port->GetQueue ()->GetNBytes ());
+        record.SetUtilization (port->GetTxUtilization ());
+    }
+    // past MaxHops only the overflow flag is set
+    tag.AddHop (record);
+    packet->AddPacketTag (tag);
+}
+
 void 
 DCCsmaBridgeNetDevice::AddBridgePort (Ptr<NetDevice> bridgePort)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-    NS_ASSERT (bridgePort != this);
+    DC_LOG_FUNCTION_NOARGS ();
+    DC_ASSERT (bridgePort != this);
     if (!Mac48Address::IsMatchingType (bridgePort->GetAddress ()))
     {
         NS_FATAL_ERROR ("Device does not support eui 48 addresses: cannot be added to bridge.");
@@ -206,18 +358,43 @@ DCCsmaBridgeNetDevice::AddBridgePort (Ptr<NetDevice> bridgePort)
         m_address = Mac48Address::ConvertFrom (bridgePort->GetAddress ());
     }
 
-    NS_LOG_DEBUG ("RegisterProtocolHandler for " << bridgePort->GetInstanceTypeId ().GetName ());
-    m_node->RegisterProtocolHandler (
-            MakeCallback (&DCCsmaBridgeNetDevice::ReceiveFromDevice, this),
-            0, bridgePort, true);
+    //
+    // A DCCsmaNetDevice hands its frames to the bridge directly, the
+    // others through a promiscuous protocol handler of the node.
+    //
+    Ptr<DCCsmaNetDevice> csmaPort = DynamicCast<DCCsmaNetDevice> (bridgePort);
+    m_csmaPorts.push_back (PeekPointer (csmaPort));
+    if (csmaPort)
+    {
+        csmaPort->SetBridge (this);
+    }
+    else
+    {
+        DC_LOG_DEBUG ("RegisterProtocolHandler for " << bridgePort->GetInstanceTypeId ().GetName ());
+        m_node->RegisterProtocolHandler (
+                MakeCallback (&DCCsmaBridgeNetDevice::ReceiveFromDevice, this),
+                0, bridgePort, true);
+    }
+    uint32_t ifIndex = bridgePort->GetIfIndex ();
+    if (ifIndex >= m_portPipeline.size ())
+        m_portPipeline.resize (ifIndex + 1, 0);
+    m_portPipeline[ifIndex] = m_ports.size ();
     m_ports.push_back (bridgePort);
     m_channel->AddChannel (bridgePort->GetChannel ());
+
+    if (m_cutThrough)
+    {
+        Ptr<DCCsmaNetDevice> port = DynamicCast<DCCsmaNetDevice> (bridgePort);
+        if (port) port->SetCutThroughBytes (m_cutThroughBytes);
+        else NS_LOG_WARN ("DCCsmaBridgeNetDevice::AddBridgePort(): Cut-through needs a DCCsmaNetDevice port, "
+                "port " << bridgePort->GetInstanceTypeId ().GetName () << " stays store-and-forward.");
+    }
 }
 
 uint32_t
 DCCsmaBridgeNetDevice::GetNBridgePorts (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_ports.size ();
 }
 
@@ -225,49 +402,49 @@ DCCsmaBridgeNetDevice::GetNBridgePorts (void) const
 Ptr<NetDevice>
 DCCsmaBridgeNetDevice::GetBridgePort (uint32_t n) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_ports[n];
 }
 
 void 
 DCCsmaBridgeNetDevice::SetIfIndex (const uint32_t index)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_ifIndex = index;
 }
 
 uint32_t 
 DCCsmaBridgeNetDevice::GetIfIndex (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_ifIndex;
 }
 
 Ptr<Channel> 
 DCCsmaBridgeNetDevice::GetChannel (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_channel;
 }
 
 void
 DCCsmaBridgeNetDevice::SetAddress (Address address)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_address = Mac48Address::ConvertFrom (address);
 }
 
 Address 
 DCCsmaBridgeNetDevice::GetAddress (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_address;
 }
 
 bool 
 DCCsmaBridgeNetDevice::SetMtu (const uint16_t mtu)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_mtu = mtu;
     return true;
 }
@@ -275,14 +452,14 @@ DCCsmaBridgeNetDevice::SetMtu (const uint16_t mtu)
 uint16_t 
 DCCsmaBridgeNetDevice::GetMtu (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_mtu;
 }
 
 bool 
 DCCsmaBridgeNetDevice::IsLinkUp (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
@@ -295,7 +472,7 @@ DCCsmaBridgeNetDevice::AddLinkChangeCallback (Callback<void> callback)
 bool 
 DCCsmaBridgeNetDevice::IsBroadcast (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
@@ -303,21 +480,21 @@ DCCsmaBridgeNetDevice::IsBroadcast (void) const
 Address
 DCCsmaBridgeNetDevice::GetBroadcast (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return Mac48Address ("ff:ff:ff:ff:ff:ff");
 }
 
 bool
 DCCsmaBridgeNetDevice::IsMulticast (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
 Address
 DCCsmaBridgeNetDevice::GetMulticast (Ipv4Address multicastGroup) const
 {
-    NS_LOG_FUNCTION (this << multicastGroup);
+    DC_LOG_FUNCTION (this << multicastGroup);
     Mac48Address multicast = Mac48Address::GetMulticast (multicastGroup);
     return multicast;
 }
@@ -326,32 +503,32 @@ DCCsmaBridgeNetDevice::GetMulticast (Ipv4Address multicastGroup) const
 bool 
 DCCsmaBridgeNetDevice::IsPointToPoint (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return false;
 }
 
 bool 
 DCCsmaBridgeNetDevice::IsBridge (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
 bool 
 DCCsmaBridgeNetDevice::Send (Ptr<Packet> packet, const Address& dest, uint16_t protocolNumber)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return SendFrom (packet, m_address, dest, protocolNumber);
 }
 
 bool 
 DCCsmaBridgeNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     Mac48Address srcMac = Mac48Address::ConvertFrom (src);
     Mac48Address dstMac = Mac48Address::ConvertFrom (dest); 
 
-    NS_ASSERT_MSG (m_forward, "DCCsmaBridgeNetDevice::SendFrom(): forward decision module can't be NULL!");
+    DC_ASSERT_MSG (m_forward, "DCCsmaBridgeNetDevice::SendFrom(): forward decision module can't be NULL!");
     // try to use the learned state if data is unicast
     if (!dstMac.IsGroup ())
     {
@@ -379,7 +556,7 @@ DCCsmaBridgeNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const A
 Ptr<Node> 
 DCCsmaBridgeNetDevice::GetNode (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_node;
 }
 
@@ -387,7 +564,7 @@ DCCsmaBridgeNetDevice::GetNode (void) const
 void 
 DCCsmaBridgeNetDevice::SetNode (Ptr<Node> node)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_node = node;
 }
 
@@ -395,49 +572,64 @@ DCCsmaBridgeNetDevice::SetNode (Ptr<Node> node)
 bool 
 DCCsmaBridgeNetDevice::NeedsArp (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_enableArp;
 }
 
 void 
 DCCsmaBridgeNetDevice::SetPacketPreProcCallback (PktPreProcCallback cb)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_pktPreProcHook = cb;
 }
 
+void
+DCCsmaBridgeNetDevice::SetPortPipeline (uint32_t port, uint32_t pipeline)
+{
+    DC_LOG_FUNCTION (this << port << pipeline);
+    DC_ASSERT_MSG (port < m_ports.size (), "DCCsmaBridgeNetDevice::SetPortPipeline(): no such port!");
+    DC_ASSERT_MSG (pipeline < m_nPipelines, "DCCsmaBridgeNetDevice::SetPortPipeline(): no such pipeline!");
+    m_portPipeline[m_ports[port]->GetIfIndex ()] = pipeline;
+}
+
 void 
 DCCsmaBridgeNetDevice::SetForward (Ptr<DCBridgeForward> forward)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-    NS_ASSERT_MSG (forward, "DCCsmaBridgeNetDevice::SetForward(): forward == NULL!");
+    DC_LOG_FUNCTION_NOARGS ();
+    DC_ASSERT_MSG (forward, "DCCsmaBridgeNetDevice::SetForward(): forward == NULL!");
     m_forward = forward;
 }
 
+Ptr<DCBridgeForward>
+DCCsmaBridgeNetDevice::GetForward (void) const
+{
+    return m_forward;
+}
+
 void 
 DCCsmaBridgeNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_rxCallback = cb;
 }
 
 void 
 DCCsmaBridgeNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_promiscRxCallback = cb;
 }
 
 bool
 DCCsmaBridgeNetDevice::SupportsSendFrom () const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
 Address DCCsmaBridgeNetDevice::GetMulticast (Ipv6Address addr) const
 {
-    NS_LOG_FUNCTION (this << addr);
+    DC_LOG_FUNCTION (this << addr);
     return Mac48Address::GetMulticast (addr);
 }
 
@@ -1,15 +1,20 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 #ifndef __DC_BRIDGE_NET_DEVICE_H__
-#define __DC_DRIDGE_NET_DEVICE_H__
+#define __DC_BRIDGE_NET_DEVICE_H__
 
+#include <deque>
 #include "ns3/mac48-address.h"
 #include "ns3/node.h"
+#include "ns3/nstime.h"
+#include "ns3/traced-callback.h"
+#include "dc-log.h"
 #include "dc-bridge-net-device-base.h"
+#include "dc-bridge-forward.h"
 
 namespace ns3 {
 
-class DCBridgeForward; 
 class DCCsmaBridgeChannel;
+class DCCsmaNetDevice;
 
 /* 
  * Switchs and hosts work like bridge device,
@@ -62,6 +67,32 @@ public:
      * Set packet forward module.
      */
     virtual void SetForward (Ptr<DCBridgeForward> forward);
+    virtual Ptr<DCBridgeForward> GetForward (void) const;
+
+    /**
+     * \brief Map a bridge port to a forwarding pipeline.
+     *
+     * Frames received by a port are looked up by its pipeline. Every
+     * pipeline takes LookupLatency per frame and starts at most
+     * PipelineRate frames per second; frames waiting for their pipeline
+     * are queued up to PipelineQueueSize. By default port i uses
+     * pipeline i % Pipelines. With zero LookupLatency and PipelineRate
+     * frames are forwarded at once.
+     *
+     * \param port the index of the port, see GetBridgePort
+     * \param pipeline the pipeline index, less than Pipelines
+     */
+    void SetPortPipeline (uint32_t port, uint32_t pipeline);
+
+    /**
+     * \brief Take a frame received by a port.
+     *
+     * A DCCsmaNetDevice port calls it directly, see
+     * DCCsmaNetDevice::SetBridge; other ports go through the protocol
+     * handler of the node.
+     */
+    void ReceiveFromPort (Ptr<NetDevice> port, Ptr<const Packet> packet, uint16_t protocol,
+                          Mac48Address src, Mac48Address dst, PacketType packetType);
 
     // inherited from NetDevice base class.
     virtual void SetIfIndex (const uint32_t index);
@@ -94,10 +125,29 @@ protected:
 
     void ReceiveFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
                           Address const &source, Address const &destination, PacketType packetType);
-    void ForwardUnicast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
+    void ProcessFromDevice (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                          Mac48Address src, Mac48Address dst, PacketType packetType);
+    void PipelineComplete (uint32_t pipeline);
+    /**
+     * \brief Add the in-band telemetry record of this hop to a frame
+     * carrying a DCIntTag.
+     */
+    void AppendInt (Ptr<Packet> packet, Ptr<NetDevice> outPort);
+    /**
+     * \brief Forward a frame with the forward module, through virtual
+     * calls to any DCBridgeForward. See DCBridgeNetDeviceT.
+     */
+    virtual void ForwardUnicast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
                        uint16_t protocol, Mac48Address src, Mac48Address dst);
-    void ForwardBroadcast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
+    virtual void ForwardBroadcast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
                          uint16_t protocol, Mac48Address src, Mac48Address dst);
+    /**
+     * \brief Send a copy of a frame through every port but the incoming one.
+     * The DCCsmaNetDevice ports share the bytes of one frame, see
+     * DCCsmaNetDevice::Frame.
+     */
+    void Flood (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
+                uint16_t protocol, Mac48Address src, Mac48Address dst);
     void Learn (Mac48Address source, Ptr<NetDevice> port);
     Ptr<NetDevice> GetLearnedState (Mac48Address source);
 
@@ -109,19 +159,201 @@ protected:
     Ptr<Node> m_node;
     Ptr<DCCsmaBridgeChannel> m_channel;
     std::vector<Ptr<NetDevice> > m_ports;
+    // m_ports cast to DCCsmaNetDevice, 0 for the other ports
+    std::vector<DCCsmaNetDevice *> m_csmaPorts;
     uint32_t m_ifIndex;
     uint16_t m_mtu;
 
 	Ptr<DCBridgeForward> m_forward;
 	PktPreProcCallback m_pktPreProcHook;
     bool m_enableArp;
+    bool m_cutThrough;
+    uint32_t m_cutThroughBytes;
+
+    // switch pipeline model
+    struct PipelineItem
+    {
+        Ptr<NetDevice> port;
+        Ptr<const Packet> packet;
+        uint16_t protocol;
+        Mac48Address src;
+        Mac48Address dst;
+        PacketType packetType;
+        Time arrival;
+    };
+    struct Pipeline
+    {
+        std::deque<PipelineItem> items;
+        Time nextFree;
+    };
+    std::vector<Pipeline> m_pipelines;
+    // the pipeline of each port, by ifIndex, modulo m_nPipelines: the
+    // rank of the port in m_ports unless SetPortPipeline changed it
+    std::vector<uint32_t> m_portPipeline;
+    uint32_t m_nPipelines;
+    Time m_lookupLatency;
+    uint64_t m_pipelineRate;
+    uint32_t m_pipelineQueueSize;
+    TracedCallback<Ptr<const Packet>, uint32_t, uint32_t> m_pipelineEnqueueTrace;
+    TracedCallback<Ptr<const Packet>, uint32_t, Time> m_pipelineDequeueTrace;
+    TracedCallback<Ptr<const Packet>, uint32_t> m_pipelineDropTrace;
 
 private:
     DCCsmaBridgeNetDevice (const DCCsmaBridgeNetDevice &);
     DCCsmaBridgeNetDevice &operator = (const DCCsmaBridgeNetDevice &);
 };
 
+/**
+ * \ingroup datacenter
+ *
+ * \brief A DCCsmaBridgeNetDevice whose forward module type is known at
+ * compile time.
+ *
+ * The ForwardPolicy gives the type of the forward module and how to call
+ * it:
+ *
+ * \code
+ * struct Policy
+ * {
+ *     typedef DCBridgeXForward Forward;
+ *     static const char *GetBridgeName (void);   // the TypeId name
+ *     static void Learn (Forward *f, ...);
+ *     static Ptr<NetDevice> GetOutPort (Forward *f, ...);
+ *     static bool Flooding (Forward *f);
+ * };
+ * \endcode
+ *
+ * The calls are not virtual, so an empty Learn and a constant Flooding
+ * are compiled out of ForwardUnicast and ForwardBroadcast. A forward
+ * module of another type, a derived class too, goes through the virtual
+ * path of DCCsmaBridgeNetDevice, which stays the generic bridge.
+ *
+ * DCHelper picks the bridge of the forward type set by SetBridgeForward.
+ */
+template <class ForwardPolicy>
+class DCBridgeNetDeviceT : public DCCsmaBridgeNetDevice
+{
+public:
+    typedef typename ForwardPolicy::Forward Forward;
+
+    static TypeId GetTypeId (void)
+    {
+        static TypeId tid = TypeId (ForwardPolicy::GetBridgeName ())
+            .SetParent<DCCsmaBridgeNetDevice> ()
+            .AddConstructor<DCBridgeNetDeviceT<ForwardPolicy> > ()
+        ;
+        return tid;
+    }
+
+    DCBridgeNetDeviceT () : m_typed (0) {}
+
+protected:
+    virtual void DoDispose (void)
+    {
+        m_cached = 0;
+        m_typed = 0;
+        DCCsmaBridgeNetDevice::DoDispose ();
+    }
+
+    virtual void ForwardUnicast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
+                                 uint16_t protocol, Mac48Address src, Mac48Address dst)
+    {
+        Forward *forward = GetTypedForward ();
+        if (forward == 0)
+        {
+            DCCsmaBridgeNetDevice::ForwardUnicast (incomingPort, packet, protocol, src, dst);
+            return;
+        }
+        ForwardPolicy::Learn (forward, this, incomingPort, src, dst, packet);
+        Ptr<NetDevice> outPort = ForwardPolicy::GetOutPort (forward, this, src, dst, packet);
+        if (outPort != 0 && outPort != incomingPort)
+        {
+            Ptr<Packet> copy = packet->Copy ();
+            AppendInt (copy, outPort);
+            outPort->SendFrom (copy, src, dst, protocol);
+        }
+        else if (ForwardPolicy::Flooding (forward))
+        {
+            Flood (incomingPort, packet, protocol, src, dst);
+        }
+    }
+
+    virtual void ForwardBroadcast (Ptr<NetDevice> incomingPort, Ptr<const Packet> packet,
+                                   uint16_t protocol, Mac48Address src, Mac48Address dst)
+    {
+        Forward *forward = GetTypedForward ();
+        if (forward == 0)
+        {
+            DCCsmaBridgeNetDevice::ForwardBroadcast (incomingPort, packet, protocol, src, dst);
+            return;
+        }
+        ForwardPolicy::Learn (forward, this, incomingPort, src, dst, packet);
+        if (ForwardPolicy::Flooding (forward))
+            Flood (incomingPort, packet, protocol, src, dst);
+    }
+
+private:
+    // the forward module as a Forward, 0 if it is of another type; the
+    // forward may be changed through SetForward or the Forward attribute
+    Forward *GetTypedForward (void)
+    {
+        if (m_cached != m_forward)
+        {
+            DC_ASSERT_MSG (m_forward, "DCBridgeNetDeviceT::GetTypedForward(): forward decision module can't be NULL!");
+            m_cached = m_forward;
+            m_typed = m_forward->GetInstanceTypeId () == Forward::GetTypeId ()
+                ? static_cast<Forward *> (PeekPointer (m_forward)) : 0;
+        }
+        return m_typed;
+    }
+
+    Ptr<DCBridgeForward> m_cached;
+    Forward *m_typed;
+};
+
+/**
+ * \brief The policy of DCBridgeStaticForward: no learning, no flooding.
+ */
+struct DCStaticForwardPolicy
+{
+    typedef DCBridgeStaticForward Forward;
+
+    static const char *GetBridgeName (void) { return "ns3::DCStaticBridgeNetDevice"; }
+    static void Learn (Forward *f, Ptr<const DCBridgeNetDeviceBase> bridge, Ptr<const NetDevice> port,
+                       const Mac48Address &src, const Mac48Address &dst, Ptr<const Packet> packet) {}
+    static Ptr<NetDevice> GetOutPort (Forward *f, Ptr<const DCBridgeNetDeviceBase> bridge,
+                                      const Mac48Address &src, const Mac48Address &dst, Ptr<const Packet> packet)
+    {
+        return f->DCBridgeStaticForward::GetOutPort (bridge, src, dst, packet);
+    }
+    static bool Flooding (Forward *f) { return false; }
+};
+
+/**
+ * \brief The policy of DCBridgeLearnForward: learning and flooding.
+ */
+struct DCLearnForwardPolicy
+{
+    typedef DCBridgeLearnForward Forward;
+
+    static const char *GetBridgeName (void) { return "ns3::DCLearnBridgeNetDevice"; }
+    static void Learn (Forward *f, Ptr<const DCBridgeNetDeviceBase> bridge, Ptr<const NetDevice> port,
+                       const Mac48Address &src, const Mac48Address &dst, Ptr<const Packet> packet)
+    {
+        f->DCBridgeLearnForward::Learn (bridge, port, src, dst, packet);
+    }
+    static Ptr<NetDevice> GetOutPort (Forward *f, Ptr<const DCBridgeNetDeviceBase> bridge,
+                                      const Mac48Address &src, const Mac48Address &dst, Ptr<const Packet> packet)
+    {
+        return f->DCBridgeLearnForward::GetOutPort (bridge, src, dst, packet);
+    }
+    static bool Flooding (Forward *f) { return true; }
+};
+
+typedef DCBridgeNetDeviceT<DCStaticForwardPolicy> DCStaticBridgeNetDevice;
+typedef DCBridgeNetDeviceT<DCLearnForwardPolicy> DCLearnBridgeNetDevice;
+
 } // namespace ns3
 
-#endif /* __DC_NET_DEVICE_H__ */
+#endif /* __DC_BRIDGE_NET_DEVICE_H__ */
 
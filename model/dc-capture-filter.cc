@@ -0,0 +1,465 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <algorithm>
+#include <cstdlib>
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/simulator.h"
+#include "ns3/ipv4-address.h"
+#include "ns3/mac48-address.h"
+#include "dc-vm.h"
+#include "dc-tenant.h"
+#include "dc-tenant-list.h"
+#include "dc-capture-filter.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCCaptureFilter");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCCaptureFilter);
+
+TypeId
+DCCaptureFilter::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCCaptureFilter")
+        .SetParent<Object> ()
+        .AddConstructor<DCCaptureFilter> ()
+        .AddAttribute ("SampleRate",
+                       "Capture 1 in SampleRate flows, chosen by the flow hash.",
+                       UintegerValue (1),
+                       MakeUintegerAccessor (&DCCaptureFilter::m_sampleRate),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("Tenant",
+                       "Capture only the frames from or to the vms of the tenant with this name, "
+                       "empty for all tenants.",
+                       StringValue (""),
+                       MakeStringAccessor (&DCCaptureFilter::SetTenantName),
+                       MakeStringChecker ())
+        .AddAttribute ("Expression",
+                       "A predicate on the addresses and ports of the frames, empty for all frames.",
+                       StringValue (""),
+                       MakeStringAccessor (&DCCaptureFilter::SetExpression),
+                       MakeStringChecker ())
+    ;
+    return tid;
+}
+
+DCCaptureFilter::DCCaptureFilter ()
+    : m_sampleRate (1),
+      m_depth (0),
+      m_tenantsSeen (0),
+      m_tenantSize (0),
+      m_pos (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCCaptureFilter::~DCCaptureFilter ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCCaptureFilter::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_tenant = 0;
+    Object::DoDispose ();
+}
+
+void
+DCCaptureFilter::SetTenantName (std::string name)
+{
+    NS_LOG_FUNCTION (name);
+    m_tenantName = name;
+    m_tenant = 0;
+    m_tenantsSeen = 0;
+    m_tenantSize = 0;
+    m_tenantMacs.clear ();
+}
+
+void
+DCCaptureFilter::SetTenant (Ptr<DCTenant> tenant)
+{
+    NS_LOG_FUNCTION (tenant);
+    m_tenantName = tenant ? tenant->GetName () : "";
+    m_tenant = tenant;
+    m_tenantSize = 0;
+    m_tenantMacs.clear ();
+}
+
+bool
+DCCaptureFilter::TenantMatch (const DCFlowMonitor::FlowKey &key) const
+{
+    if (!m_tenant)
+    {
+        // tenants may be created after the filter, look for the name
+        // among the tenants added since the last look
+        uint32_t n = DCTenantList::GetNDCTenants ();
+        for (;m_tenantsSeen < n && !m_tenant;m_tenantsSeen++)
+        {
+            Ptr<DCTenant> t = DCTenantList::GetDCTenant (m_tenantsSeen);
+            if (t->GetName () == m_tenantName)
+                m_tenant = t;
+        }
+        if (!m_tenant) return false;
+    }
+    Ptr<DCTenant> t = m_tenant;
+
+    // rebuild the address set when vms joined the tenant
+    if (m_tenantSize != t->GetN ())
+    {
+        m_tenantMacs.clear ();
+        for (uint32_t i = 0;i < t->GetN ();i++)
+        {
+            uint8_t mac[6];
+            Mac48Address::ConvertFrom (t->GetVm (i)->GetPointNetDeviceAddress ()).CopyTo (mac);
+            uint64_t v = 0;
+            for (uint32_t j = 0;j < 6;j++)
+                v = (v << 8) | mac[j];
+            m_tenantMacs.push_back (v);
+        }
+        std::sort (m_tenantMacs.begin (), m_tenantMacs.end ());
+        m_tenantSize = t->GetN ();
+    }
+
+    return std::binary_search (m_tenantMacs.begin (), m_tenantMacs.end (), key.srcMac)
+        || std::binary_search (m_tenantMacs.begin (), m_tenantMacs.end (), key.dstMac);
+}
+
+void
+DCCaptureFilter::SetExpression (std::string expr)
+{
+    NS_LOG_FUNCTION (expr);
+    m_expression = expr;
+    m_code.clear ();
+    m_depth = 0;
+
+    m_tokens.clear ();
+    std::string token;
+    for (uint32_t i = 0;i <= expr.size ();i++)
+    {
+        char c = i < expr.size () ? expr[i] : ' ';
+        if (c == ' ' || c == '\t' || c == '(' || c == ')')
+        {
+            if (!token.empty ()) m_tokens.push_back (token);
+            token.clear ();
+            if (c == '(' || c == ')') m_tokens.push_back (std::string (1, c));
+        }
+        else
+            token += c;
+    }
+    if (m_tokens.empty ()) return;
+
+    m_pos = 0;
+    ParseOr ();
+    if (m_pos != m_tokens.size ())
+    {
+        NS_FATAL_ERROR ("DCCaptureFilter::SetExpression(): unexpected \"" << Peek () << "\" in " << expr);
+    }
+
+    // the stack depth of the postfix code
+    uint32_t depth = 0;
+    for (uint32_t i = 0;i < m_code.size ();i++)
+    {
+        if (m_code[i].op == OP_CMP) depth++;
+        else if (m_code[i].op != OP_NOT) depth--;
+        if (depth > m_depth) m_depth = depth;
+    }
+    NS_ABORT_MSG_IF (m_depth > MAX_DEPTH, "DCCaptureFilter::SetExpression(): too deep " << expr);
+    m_tokens.clear ();
+}
+
+const std::string&
+DCCaptureFilter::Peek (void) const
+{
+    static const std::string end = "";
+    return m_pos < m_tokens.size () ? m_tokens[m_pos] : end;
+}
+
+std::string
+DCCaptureFilter::Next (void)
+{
+    if (m_pos >= m_tokens.size ())
+    {
+        NS_FATAL_ERROR ("DCCaptureFilter::SetExpression(): unexpected end of " << m_expression);
+    }
+    return m_tokens[m_pos++];
+}
+
+void
+DCCaptureFilter::Emit (uint8_t op, uint8_t field, uint64_t mask, uint64_t value)
+{
+    Insn i;
+    i.op = op;
+    i.field = field;
+    i.mask = mask;
+    i.value = value;
+    m_code.push_back (i);
+}
+
+void
+DCCaptureFilter::ParseOr (void)
+{
+    ParseAnd ();
+    while (Peek () == "or" || Peek () == "||")
+    {
+        m_pos++;
+        ParseAnd ();
+        Emit (OP_OR);
+    }
+}
+
+void
+DCCaptureFilter::ParseAnd (void)
+{
+    ParseNot ();
+    while (Peek () == "and" || Peek () == "&&")
+    {
+        m_pos++;
+        ParseNot ();
+        Emit (OP_AND);
+    }
+}
+
+void
+DCCaptureFilter::ParseNot (void)
+{
+    if (Peek () == "not" || Peek () == "!")
+    {
+        m_pos++;
+        ParseNot ();
+        Emit (OP_NOT);
+    }
+    else if (Peek () == "(")
+    {
+        m_pos++;
+        ParseOr ();
+        if (Next () != ")")
+        {
+            NS_FATAL_ERROR ("DCCaptureFilter::SetExpression(): missing ) in " << m_expression);
+        }
+    }
+    else
+        ParsePrimitive ();
+}
+
+void
+DCCaptureFilter::ParsePrimitive (void)
+{
+    std::string t = Next ();
+
+    if (t == "tcp") { Emit (OP_CMP, IP_PROTO, 0xff, 6); return; }
+    if (t == "udp") { Emit (OP_CMP, IP_PROTO, 0xff, 17); return; }
+    if (t == "icmp") { Emit (OP_CMP, IP_PROTO, 0xff, 1); return; }
+    if (t == "ip") { Emit (OP_CMP, ETHER_TYPE, 0xffff, 0x0800); return; }
+    if (t == "arp") { Emit (OP_CMP, ETHER_TYPE, 0xffff, 0x0806); return; }
+    if (t == "proto")
+    {
+        Emit (OP_CMP, IP_PROTO, 0xff, std::strtoul (Next ().c_str (), 0, 0));
+        return;
+    }
+
+    if (t == "ether")
+    {
+        std::string dir = Next ();
+        uint8_t field = dir == "src" ? SRC_MAC : dir == "dst" ? DST_MAC : ANY_MAC;
+        if (dir != "src" && dir != "dst" && dir != "host")
+        {
+            NS_FATAL_ERROR ("DCCaptureFilter::SetExpression(): bad ether direction " << dir);
+        }
+        uint8_t mac[6];
+        Mac48Address (Next ().c_str ()).CopyTo (mac);
+        uint64_t v = 0;
+        for (uint32_t j = 0;j < 6;j++)
+            v = (v << 8) | mac[j];
+        Emit (OP_CMP, field, 0xffffffffffffULL, v);
+        return;
+    }
+
+    // [src|dst] host|net|port
+    int dir = 0;
+    if (t == "src" || t == "dst")
+    {
+        dir = t == "src" ? 1 : 2;
+        t = Next ();
+    }
+    if (t == "host" || t == "net")
+    {
+        std::string a = Next ();
+        uint32_t mask = 0xffffffff;
+        if (t == "net")
+        {
+            std::string::size_type slash = a.find ('/');
+            if (slash != std::string::npos)
+            {
+                uint32_t len = std::atoi (a.substr (slash + 1).c_str ());
+                mask = len == 0 ? 0 : len >= 32 ? 0xffffffff : ~((1u << (32 - len)) - 1);
+                a = a.substr (0, slash);
+            }
+        }
+        uint32_t v = Ipv4Address (a.c_str ()).Get ();
+        Emit (OP_CMP, dir == 1 ? SRC_IP : dir == 2 ? DST_IP : ANY_IP, mask, v & mask);
+        return;
+    }
+    if (t == "port")
+    {
+        Emit (OP_CMP, dir == 1 ? SRC_PORT : dir == 2 ? DST_PORT : ANY_PORT,
+              0xffff, std::strtoul (Next ().c_str (), 0, 0));
+        return;
+    }
+
+    NS_FATAL_ERROR ("DCCaptureFilter::SetExpression(): unknown primitive \"" << t << "\" in " << m_expression);
+}
+
+bool
+DCCaptureFilter::Compare (const Insn &insn, const DCFlowMonitor::FlowKey &key)
+{
+    switch (insn.field)
+    {
+    case SRC_IP: return (key.srcIp & insn.mask) == insn.value;
+    case DST_IP: return (key.dstIp & insn.mask) == insn.value;
+    case ANY_IP: return (key.srcIp & insn.mask) == insn.value || (key.dstIp & insn.mask) == insn.value;
+    case SRC_PORT: return key.srcPort == insn.value;
+    case DST_PORT: return key.dstPort == insn.value;
+    case ANY_PORT: return key.srcPort == insn.value || key.dstPort == insn.value;
+    case IP_PROTO: return key.protocol == 0x0800 && key.ipProtocol == insn.value;
+    case ETHER_TYPE: return key.protocol == insn.value;
+    case SRC_MAC: return key.srcMac == insn.value;
+    case DST_MAC: return key.dstMac == insn.value;
+    case ANY_MAC: return key.srcMac == insn.value || key.dstMac == insn.value;
+    }
+    return false;
+}
+
+uint32_t
+DCCaptureFilter::SampleHash (const DCFlowMonitor::FlowKey &key)
+{
+    DCFlowMonitor::FlowKey k = key;
+    if (k.srcMac > k.dstMac)
+        std::swap (k.srcMac, k.dstMac);
+    if (k.srcIp > k.dstIp || (k.srcIp == k.dstIp && k.srcPort > k.dstPort))
+    {
+        std::swap (k.srcIp, k.dstIp);
+        std::swap (k.srcPort, k.dstPort);
+    }
+    return DCFlowMonitor::KeyHash (k);
+}
+
+bool
+DCCaptureFilter::Match (const DCFlowMonitor::FlowKey &key) const
+{
+    if (m_sampleRate > 1 && SampleHash (key) % m_sampleRate != 0)
+        return false;
+    if (!m_tenantName.empty () && !TenantMatch (key))
+        return false;
+    if (m_code.empty ())
+        return true;
+
+    bool stack[MAX_DEPTH];
+    uint32_t sp = 0;
+    for (uint32_t i = 0;i < m_code.size ();i++)
+    {
+        const Insn &insn = m_code[i];
+        switch (insn.op)
+        {
+        case OP_CMP:
+            stack[sp++] = Compare (insn, key);
+            break;
+        case OP_NOT:
+            stack[sp - 1] = !stack[sp - 1];
+            break;
+        case OP_AND:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] && stack[sp];
+            break;
+        case OP_OR:
+            sp--;
+            stack[sp - 1] = stack[sp - 1] || stack[sp];
+            break;
+        }
+    }
+    return stack[0];
+}
+
+bool
+DCCaptureFilter::Match (Ptr<const Packet> frame) const
+{
+    DCFlowMonitor::FlowKey key;
+    if (!DCFlowMonitor::ParseKey (frame, key)) return false;
+    return Match (key);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCFilteredTraceSink);
+
+TypeId
+DCFilteredTraceSink::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCFilteredTraceSink")
+        .SetParent<Object> ()
+        .AddConstructor<DCFilteredTraceSink> ()
+    ;
+    return tid;
+}
+
+DCFilteredTraceSink::DCFilteredTraceSink ()
+{
+}
+
+DCFilteredTraceSink::DCFilteredTraceSink (Ptr<DCCaptureFilter> filter, Ptr<PcapFileWrapper> file)
+    : m_filter (filter),
+      m_file (file)
+{
+}
+
+DCFilteredTraceSink::DCFilteredTraceSink (Ptr<DCCaptureFilter> filter, Ptr<OutputStreamWrapper> stream)
+    : m_filter (filter),
+      m_stream (stream)
+{
+}
+
+void
+DCFilteredTraceSink::DoDispose (void)
+{
+    m_filter = 0;
+    m_file = 0;
+    m_stream = 0;
+    Object::DoDispose ();
+}
+
+void
+DCFilteredTraceSink::Pcap (Ptr<const Packet> p)
+{
+    if (m_filter->Match (p))
+        m_file->Write (Simulator::Now (), p);
+}
+
+void
+DCFilteredTraceSink::AsciiEnqueue (Ptr<const Packet> p)
+{
+    if (m_filter->Match (p))
+        *m_stream->GetStream () << "+ " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+}
+
+void
+DCFilteredTraceSink::AsciiDequeue (Ptr<const Packet> p)
+{
+    if (m_filter->Match (p))
+        *m_stream->GetStream () << "- " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+}
+
+void
+DCFilteredTraceSink::AsciiDrop (Ptr<const Packet> p)
+{
+    if (m_filter->Match (p))
+        *m_stream->GetStream () << "d " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+}
+
+void
+DCFilteredTraceSink::AsciiReceive (Ptr<const Packet> p)
+{
+    if (m_filter->Match (p))
+        *m_stream->GetStream () << "r " << Simulator::Now ().GetSeconds () << " " << *p << std::endl;
+}
+
+} // namespace ns3
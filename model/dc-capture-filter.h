@@ -0,0 +1,159 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_CAPTURE_FILTER_H__
+#define __DC_CAPTURE_FILTER_H__
+
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/output-stream-wrapper.h"
+#include "ns3/pcap-file-wrapper.h"
+#include "dc-flow-monitor.h"
+
+namespace ns3 {
+
+class DCTenant;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Decide which frames the DC trace sinks write.
+ *
+ * A frame passes when it passes all of:
+ *  - SampleRate N: 1 in N flows, by a hash of the flow key with its ends
+ *    in order, so a flow is captured whole, both directions, or not at
+ *    all, and the choice is the same in every run and at every hop.
+ *  - Tenant: the source or destination MAC is a vm of the tenant.
+ *  - Expression: a pcap like predicate, e.g.
+ *    "tcp and (dst port 80 or src net 10.1.0.0/16) and not host 10.1.0.2".
+ *    Primitives are [src|dst] host A.B.C.D, [src|dst] net A.B.C.D/len,
+ *    [src|dst] port N, proto N, tcp, udp, icmp, ip, arp and
+ *    ether [src|dst|host] MAC, combined by and, or, not and parentheses.
+ *    It is compiled to a postfix bytecode once, a match is one pass over
+ *    the bytecode with a small stack of booleans.
+ *
+ * The headers of a frame are parsed once, by DCFlowMonitor::ParseKey, and
+ * the filter runs before the sinks serialize anything. A header free
+ * device given the filter by EnableCapture only rebuilds the headers of
+ * the frames that pass.
+ */
+class DCCaptureFilter : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCCaptureFilter ();
+    virtual ~DCCaptureFilter ();
+
+    /**
+     * \brief Compile a filter expression, an empty one matches everything.
+     */
+    void SetExpression (std::string expr);
+    void SetTenant (Ptr<DCTenant> tenant);
+
+    bool Match (Ptr<const Packet> frame) const;
+    bool Match (const DCFlowMonitor::FlowKey &key) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    static const uint32_t MAX_DEPTH = 32;
+
+    enum Op
+    {
+        OP_CMP,
+        OP_AND,
+        OP_OR,
+        OP_NOT
+    };
+
+    enum Field
+    {
+        SRC_IP,
+        DST_IP,
+        ANY_IP,
+        SRC_PORT,
+        DST_PORT,
+        ANY_PORT,
+        IP_PROTO,
+        ETHER_TYPE,
+        SRC_MAC,
+        DST_MAC,
+        ANY_MAC
+    };
+
+    struct Insn
+    {
+        uint8_t op;
+        uint8_t field;
+        uint64_t mask;
+        uint64_t value;
+    };
+
+    // recursive descent parser, emits postfix code
+    void ParseOr (void);
+    void ParseAnd (void);
+    void ParseNot (void);
+    void ParsePrimitive (void);
+    std::string Next (void);
+    const std::string& Peek (void) const;
+    void Emit (uint8_t op, uint8_t field = 0, uint64_t mask = 0, uint64_t value = 0);
+
+    static bool Compare (const Insn &insn, const DCFlowMonitor::FlowKey &key);
+    /**
+     * \return the hash of the key with its ends in order, the same for
+     *         both directions of a flow
+     */
+    static uint32_t SampleHash (const DCFlowMonitor::FlowKey &key);
+    void SetTenantName (std::string name);
+    bool TenantMatch (const DCFlowMonitor::FlowKey &key) const;
+
+    uint32_t m_sampleRate;
+    std::string m_expression;
+    std::vector<Insn> m_code;
+    uint32_t m_depth;           // the stack size the code needs
+
+    std::string m_tenantName;
+    mutable Ptr<DCTenant> m_tenant;
+    mutable uint32_t m_tenantsSeen;     // the tenants looked up by name
+    mutable uint32_t m_tenantSize;
+    mutable std::vector<uint64_t> m_tenantMacs;    // sorted
+
+    // parser state
+    std::vector<std::string> m_tokens;
+    uint32_t m_pos;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The pcap and ascii sinks of DCHelper behind a DCCaptureFilter.
+ */
+class DCFilteredTraceSink : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCFilteredTraceSink ();
+    DCFilteredTraceSink (Ptr<DCCaptureFilter> filter, Ptr<PcapFileWrapper> file);
+    DCFilteredTraceSink (Ptr<DCCaptureFilter> filter, Ptr<OutputStreamWrapper> stream);
+
+    void Pcap (Ptr<const Packet> p);
+    void AsciiEnqueue (Ptr<const Packet> p);
+    void AsciiDequeue (Ptr<const Packet> p);
+    void AsciiDrop (Ptr<const Packet> p);
+    void AsciiReceive (Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    Ptr<DCCaptureFilter> m_filter;
+    Ptr<PcapFileWrapper> m_file;
+    Ptr<OutputStreamWrapper> m_stream;
+};
+
+} // namespace ns3
+
+#endif /* __DC_CAPTURE_FILTER_H__ */
@@ -0,0 +1,217 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/node.h"
+#include "ns3/ethernet-header.h"
+#include "ns3/ethernet-trailer.h"
+#include "ns3/trace-source-accessor.h"
+#include "dc-rdma-header.h"
+#include "dc-point-net-device.h"
+#include "dc-ecn-queue.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCEcnQueue");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCEcnQueue);
+
+TypeId
+DCEcnQueue::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCEcnQueue")
+        .SetParent<Queue> ()
+        .AddConstructor<DCEcnQueue> ()
+        .AddAttribute ("Mode",
+                       "Whether to use bytes (see MaxBytes) or packets (see MaxPackets) as the maximum queue size metric.",
+                       EnumValue (QUEUE_MODE_BYTES),
+                       MakeEnumAccessor (&DCEcnQueue::SetMode),
+                       MakeEnumChecker (QUEUE_MODE_BYTES, "QUEUE_MODE_BYTES",
+                                        QUEUE_MODE_PACKETS, "QUEUE_MODE_PACKETS"))
+        .AddAttribute ("MaxPackets",
+                       "The maximum number of packets accepted by this DCEcnQueue, as counted by DCGsoTag::CountSegments.",
+                       UintegerValue (100),
+                       MakeUintegerAccessor (&DCEcnQueue::m_maxPackets),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("MaxBytes",
+                       "The maximum number of bytes accepted by this DCEcnQueue.",
+                       UintegerValue (1000 * 1024),
+                       MakeUintegerAccessor (&DCEcnQueue::m_maxBytes),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("MinTh",
+                       "Queue length in bytes below which no packet is marked (Kmin).",
+                       UintegerValue (5 * 1024),
+                       MakeUintegerAccessor (&DCEcnQueue::m_minTh),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("MaxTh",
+                       "Queue length in bytes above which every packet is marked (Kmax), at least MinTh.",
+                       UintegerValue (200 * 1024),
+                       MakeUintegerAccessor (&DCEcnQueue::m_maxTh),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("MaxP",
+                       "Marking probability when the queue length reaches MaxTh (Pmax).",
+                       DoubleValue (0.01),
+                       MakeDoubleAccessor (&DCEcnQueue::m_maxP),
+                       MakeDoubleChecker<double> (0.0, 1.0))
+        .AddTraceSource ("Mark",
+                         "A packet has been marked with congestion experienced",
+                         MakeTraceSourceAccessor (&DCEcnQueue::m_markTrace))
+    ;
+    return tid;
+}
+
+DCEcnQueue::DCEcnQueue ()
+    : m_packets (),
+      m_bytesInQueue (0),
+      m_segmentsInQueue (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCEcnQueue::~DCEcnQueue ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCEcnQueue::SetMode (Queue::QueueMode mode)
+{
+    NS_LOG_FUNCTION (mode);
+    m_mode = mode;
+}
+
+Queue::QueueMode
+DCEcnQueue::GetMode (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    return m_mode;
+}
+
+bool
+DCEcnQueue::DoEnqueue (Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION (this << p);
+    // checked here, the attributes may be set in any order
+    NS_ABORT_MSG_IF (m_maxTh < m_minTh, "DCEcnQueue::DoEnqueue(): MaxTh " << m_maxTh
+                     << " is below MinTh " << m_minTh);
+
+    uint32_t segments = DCGsoTag::CountSegments (p);
+    if (m_mode == QUEUE_MODE_PACKETS && (m_segmentsInQueue + segments > m_maxPackets))
+    {
+        NS_LOG_LOGIC ("Queue full (at max packets) -- droppping pkt");
+        Drop (p);
+        return false;
+    }
+
+    if (m_mode == QUEUE_MODE_BYTES && (m_bytesInQueue + p->GetSize () >= m_maxBytes))
+    {
+        NS_LOG_LOGIC ("Queue full (packet would exceed max bytes) -- droppping pkt");
+        Drop (p);
+        return false;
+    }
+
+    if (ShouldMark () && MarkPacket (p))
+    {
+        NS_LOG_LOGIC ("Marked ce at queue length " << m_bytesInQueue);
+        m_markTrace (p);
+    }
+
+    m_bytesInQueue += p->GetSize ();
+    m_segmentsInQueue += segments;
+    m_packets.push_back (p);
+
+    NS_LOG_LOGIC ("Number packets " << m_packets.size ());
+    NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+
+    return true;
+}
+
+Ptr<Packet>
+DCEcnQueue::DoDequeue (void)
+{
+    NS_LOG_FUNCTION (this);
+
+    if (m_packets.empty ())
+    {
+        NS_LOG_LOGIC ("Queue empty");
+        return 0;
+    }
+
+    Ptr<Packet> p = m_packets.front ();
+    m_packets.pop_front ();
+    m_bytesInQueue -= p->GetSize ();
+    m_segmentsInQueue -= DCGsoTag::CountSegments (p);
+
+    NS_LOG_LOGIC ("Popped " << p);
+    NS_LOG_LOGIC ("Number packets " << m_packets.size ());
+    NS_LOG_LOGIC ("Number bytes " << m_bytesInQueue);
+
+    return p;
+}
+
+Ptr<const Packet>
+DCEcnQueue::DoPeek (void) const
+{
+    NS_LOG_FUNCTION (this);
+
+    if (m_packets.empty ())
+    {
+        NS_LOG_LOGIC ("Queue empty");
+        return 0;
+    }
+
+    return m_packets.front ();
+}
+
+bool
+DCEcnQueue::ShouldMark (void)
+{
+    if (m_bytesInQueue <= m_minTh) return false;
+    if (m_bytesInQueue >= m_maxTh) return true;
+    double p = m_maxP * (m_bytesInQueue - m_minTh) / (m_maxTh - m_minTh);
+    return m_uv.GetValue () < p;
+}
+
+bool
+DCEcnQueue::MarkPacket (Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION (this << p);
+
+    DCL2MetaTag meta;
+    if (p->PeekPacketTag (meta))
+    {
+        // a header free frame, the RDMA header comes first
+        if (meta.GetProtocol () != DCRdmaHeader::PROT_NUMBER) return false;
+        DCRdmaHeader rdma;
+        p->RemoveHeader (rdma);
+        bool marked = rdma.MarkCe ();
+        p->AddHeader (rdma);
+        return marked;
+    }
+
+    EthernetHeader header (false);
+    p->PeekHeader (header);
+    if (header.GetLengthType () != DCRdmaHeader::PROT_NUMBER) return false;
+
+    EthernetTrailer trailer;
+    DCRdmaHeader rdma;
+    p->RemoveTrailer (trailer);
+    p->RemoveHeader (header);
+    p->RemoveHeader (rdma);
+    bool marked = rdma.MarkCe ();
+    p->AddHeader (rdma);
+    p->AddHeader (header);
+
+    // the frame has been changed, so recompute the fcs
+    if (Node::ChecksumEnabled ())
+    {
+        trailer.EnableFcs (true);
+    }
+    trailer.CalcFcs (p);
+    p->AddTrailer (trailer);
+    return marked;
+}
+
+} // namespace ns3
@@ -0,0 +1,71 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_ECN_QUEUE_H__
+#define __DC_ECN_QUEUE_H__
+
+#include <deque>
+#include "ns3/packet.h"
+#include "ns3/queue.h"
+#include "ns3/random-variable.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A drop tail queue which marks ecn on rdma frames.
+ *
+ * The marking follows the RED like profile used by DCQCN switches: no
+ * packet is marked below MinTh bytes, every packet is marked above MaxTh
+ * bytes, and in between the probability grows linearly up to MaxP. The
+ * instantaneous queue length is used, not an averaged one.
+ *
+ * The queue holds complete ethernet frames (the net device adds the
+ * headers before enqueue), so only frames carrying a DCRdmaHeader with
+ * the ect bit can be marked; other frames are just queued.
+ */
+class DCEcnQueue : public Queue
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCEcnQueue ();
+    virtual ~DCEcnQueue ();
+
+    void SetMode (Queue::QueueMode mode);
+    Queue::QueueMode GetMode (void);
+
+private:
+    virtual bool DoEnqueue (Ptr<Packet> p);
+    virtual Ptr<Packet> DoDequeue (void);
+    virtual Ptr<const Packet> DoPeek (void) const;
+
+    /**
+     * \brief Whether the arriving packet should be marked.
+     */
+    bool ShouldMark (void);
+
+    /**
+     * \brief Set the ce bit in the rdma header of a frame.
+     * \return false if the frame is not an ect rdma frame
+     */
+    bool MarkPacket (Ptr<Packet> p);
+
+    std::deque<Ptr<Packet> > m_packets;
+    uint32_t m_maxPackets;
+    uint32_t m_maxBytes;
+    uint32_t m_bytesInQueue;
+    uint32_t m_segmentsInQueue;     // wire segments, see DCGsoTag
+    QueueMode m_mode;
+
+    uint32_t m_minTh;
+    uint32_t m_maxTh;
+    double m_maxP;
+    UniformVariable m_uv;
+
+    TracedCallback<Ptr<const Packet> > m_markTrace;
+};
+
+} // namespace ns3
+
+#endif /* __DC_ECN_QUEUE_H__ */
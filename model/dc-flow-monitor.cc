@@ -0,0 +1,562 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <algorithm>
+#include "ns3/log.h"
+#include "ns3/simulator.h"
+#include "ns3/channel.h"
+#include "dc-vm.h"
+#include "dc-tenant.h"
+#include "dc-tenant-list.h"
+#include "dc-point-net-device.h"
+#include "dc-point-channel-base.h"
+#include "dc-meta-tag.h"
+#include "dc-flow-monitor.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCFlowMonitor");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCFlowTag);
+
+TypeId
+DCFlowTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCFlowTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCFlowTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCFlowTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCFlowTag::DCFlowTag ()
+    : m_flow (0),
+      m_txTime (0)
+{
+}
+
+DCFlowTag::DCFlowTag (uint32_t flow, Time txTime)
+    : m_flow (flow),
+      m_txTime (txTime.GetTimeStep ())
+{
+}
+
+uint32_t
+DCFlowTag::GetFlow (void) const
+{
+    return m_flow;
+}
+
+Time
+DCFlowTag::GetTxTime (void) const
+{
+    return TimeStep (m_txTime);
+}
+
+uint32_t
+DCFlowTag::GetSerializedSize (void) const
+{
+    return 12;
+}
+
+void
+DCFlowTag::Serialize (TagBuffer i) const
+{
+    i.WriteU32 (m_flow);
+    i.WriteU64 (m_txTime);
+}
+
+void
+DCFlowTag::Deserialize (TagBuffer i)
+{
+    m_flow = i.ReadU32 ();
+    m_txTime = i.ReadU64 ();
+}
+
+void
+DCFlowTag::Print (std::ostream &os) const
+{
+    os << "flow=" << m_flow << " tx=" << m_txTime;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCFlowProbe);
+
+TypeId
+DCFlowProbe::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCFlowProbe")
+        .SetParent<DCPointCallback> ()
+        .AddConstructor<DCFlowProbe> ()
+    ;
+    return tid;
+}
+
+DCFlowProbe::DCFlowProbe (void)
+    : m_monitor (0),
+      m_device (0)
+{
+}
+
+DCFlowProbe::DCFlowProbe (DCFlowMonitor *monitor, Ptr<DCVm> vm)
+    : m_monitor (monitor),
+      m_vm (vm),
+      m_device (0)
+{
+}
+
+DCFlowProbe::~DCFlowProbe (void)
+{
+}
+
+void
+DCFlowProbe::DoDispose (void)
+{
+    m_monitor = 0;
+    m_vm = 0;
+    m_device = 0;
+    DCPointCallback::DoDispose ();
+}
+
+Ptr<DCVm>
+DCFlowProbe::GetVm (void) const
+{
+    return m_vm;
+}
+
+void
+DCFlowProbe::Register (Ptr<DCCsmaNetDevice> device)
+{
+    m_device = PeekPointer (device);
+    DCPointCallback::Register (device);
+}
+
+void
+DCFlowProbe::TxPostEnqueue (Ptr<const Packet> packet)
+{
+    if (m_monitor) m_monitor->NotifyTx (m_vm, packet);
+}
+
+void
+DCFlowProbe::RxSucess (Ptr<const Packet> packet)
+{
+    // the frames of a train are handed up after they arrived
+    if (m_monitor) m_monitor->NotifyRx (m_vm, packet, m_device->GetRxTime ());
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCFlowMonitor);
+
+TypeId
+DCFlowMonitor::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCFlowMonitor")
+        .SetParent<Object> ()
+        .AddConstructor<DCFlowMonitor> ()
+    ;
+    return tid;
+}
+
+DCFlowMonitor::DCFlowMonitor ()
+    : m_slots (1024, 0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCFlowMonitor::~DCFlowMonitor ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCFlowMonitor::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    for (uint32_t i = 0;i < m_probes.size ();i++)
+        m_probes[i]->Dispose ();
+    m_probes.clear ();
+    m_flows.clear ();
+    Object::DoDispose ();
+}
+
+void
+DCFlowMonitor::Install (Ptr<DCVm> vm)
+{
+    NS_LOG_FUNCTION (this << vm);
+    Ptr<DCCsmaNetDevice> dev = DynamicCast<DCCsmaNetDevice> (vm->GetPointNetDevice ());
+    NS_ASSERT_MSG (dev, "DCFlowMonitor::Install(): The type of vm net device must be DCCsmaNetDevice!");
+    Ptr<DCFlowProbe> probe = CreateObject<DCFlowProbe> (this, vm);
+    probe->Register (dev);
+    m_probes.push_back (probe);
+}
+
+bool
+DCFlowMonitor::ParseKey (Ptr<const Packet> packet, FlowKey &key)
+{
+    // a header free frame, the L2 part is in the tag
+    DCL2MetaTag l2;
+    if (packet->PeekPacketTag (l2))
+    {
+        ParsePayloadKey (packet, l2.GetSource (), l2.GetDestination (), l2.GetProtocol (), key);
+        return true;
+    }
+
+    // enough for LLC/SNAP, the longest IPv4 header and the ports
+    uint8_t buf[96];
+    uint32_t n = packet->CopyData (buf, sizeof (buf));
+    if (n < 14) return false;
+
+    key.dstMac = 0;
+    key.srcMac = 0;
+    for (uint32_t i = 0;i < 6;i++)
+    {
+        key.dstMac = (key.dstMac << 8) | buf[i];
+        key.srcMac = (key.srcMac << 8) | buf[6 + i];
+    }
+    key.srcIp = key.dstIp = 0;
+    key.srcPort = key.dstPort = 0;
+    key.ipProtocol = 0;
+
+    uint32_t off = 14;
+    key.protocol = (buf[12] << 8) | buf[13];
+    if (key.protocol <= 1500)
+    {
+        // LLC/SNAP, the ether type is at the end of the snap header
+        if (n < 22) return true;
+        key.protocol = (buf[20] << 8) | buf[21];
+        off = 22;
+    }
+
+    ParseIpv4 (buf, n, off, key);
+    return true;
+}
+
+void
+DCFlowMonitor::ParsePayloadKey (Ptr<const Packet> payload, Mac48Address src,
+                                Mac48Address dst, uint16_t protocol, FlowKey &key)
+{
+    uint8_t mac[6];
+    src.CopyTo (mac);
+    key.srcMac = 0;
+    for (uint32_t i = 0;i < 6;i++)
+        key.srcMac = (key.srcMac << 8) | mac[i];
+    dst.CopyTo (mac);
+    key.dstMac = 0;
+    for (uint32_t i = 0;i < 6;i++)
+        key.dstMac = (key.dstMac << 8) | mac[i];
+    key.protocol = protocol;
+    key.srcIp = key.dstIp = 0;
+    key.srcPort = key.dstPort = 0;
+    key.ipProtocol = 0;
+
+    uint8_t buf[96];
+    uint32_t n = payload->CopyData (buf, sizeof (buf));
+    ParseIpv4 (buf, n, 0, key);
+}
+
+void
+DCFlowMonitor::ParseIpv4 (const uint8_t *buf, uint32_t n, uint32_t off, FlowKey &key)
+{
+    if (key.protocol != 0x0800 || n < off + 20) return;
+    uint32_t ihl = (buf[off] & 0x0f) * 4;
+    key.ipProtocol = buf[off + 9];
+    key.srcIp = (buf[off + 12] << 24) | (buf[off + 13] << 16) | (buf[off + 14] << 8) | buf[off + 15];
+    key.dstIp = (buf[off + 16] << 24) | (buf[off + 17] << 16) | (buf[off + 18] << 8) | buf[off + 19];
+    if ((key.ipProtocol == 6 || key.ipProtocol == 17) && n >= off + ihl + 4)
+    {
+        key.srcPort = (buf[off + ihl] << 8) | buf[off + ihl + 1];
+        key.dstPort = (buf[off + ihl + 2] << 8) | buf[off + ihl + 3];
+    }
+}
+
+bool
+DCFlowMonitor::KeyEqual (const FlowKey &a, const FlowKey &b)
+{
+    return a.srcMac == b.srcMac && a.dstMac == b.dstMac
+        && a.srcIp == b.srcIp && a.dstIp == b.dstIp
+        && a.srcPort == b.srcPort && a.dstPort == b.dstPort
+        && a.protocol == b.protocol && a.ipProtocol == b.ipProtocol;
+}
+
+uint32_t
+DCFlowMonitor::KeyHash (const FlowKey &key)
+{
+    uint64_t h = key.srcMac * 0x9e3779b97f4a7c15ULL;
+    h ^= key.dstMac + 0x7f4a7c159e3779b9ULL + (h << 6) + (h >> 2);
+    h ^= ((uint64_t)key.srcIp << 32 | key.dstIp) + (h << 6) + (h >> 2);
+    h ^= ((uint64_t)key.srcPort << 40 | (uint64_t)key.dstPort << 24
+          | (uint64_t)key.protocol << 8 | key.ipProtocol) + (h << 6) + (h >> 2);
+    // final mix of murmur3
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (uint32_t)h;
+}
+
+void
+DCFlowMonitor::Grow (void)
+{
+    std::vector<uint32_t> slots (m_slots.size () * 2, 0);
+    uint32_t mask = slots.size () - 1;
+    for (uint32_t i = 0;i < m_flows.size ();i++)
+    {
+        uint32_t s = m_flows[i].hash & mask;
+        while (slots[s] != 0) s = (s + 1) & mask;
+        slots[s] = i + 1;
+    }
+    m_slots.swap (slots);
+}
+
+uint32_t
+DCFlowMonitor::FindOrAdd (const FlowKey &key, uint32_t hash, Ptr<DCVm> vm)
+{
+    uint32_t mask = m_slots.size () - 1;
+    uint32_t s = hash & mask;
+    while (m_slots[s] != 0)
+    {
+        if (KeyEqual (m_flows[m_slots[s] - 1].key, key))
+            return m_slots[s] - 1;
+        s = (s + 1) & mask;
+    }
+
+    FlowStats f;
+    f.key = key;
+    f.hash = hash;
+    f.src = vm;
+    f.tenant = DCTenantList::GetDCTenant (vm);
+    f.txBytes = f.rxBytes = 0;
+    f.txPackets = f.rxPackets = 0;
+    f.firstFrame = 0;
+    f.path = -1;
+    m_flows.push_back (f);
+    m_slots[s] = m_flows.size ();
+
+    // keep the load under a half, the probe sequences stay short
+    if (m_flows.size () * 2 > m_slots.size ())
+        Grow ();
+    return m_flows.size () - 1;
+}
+
+void
+DCFlowMonitor::NotifyTx (Ptr<DCVm> vm, Ptr<const Packet> packet)
+{
+    NS_LOG_FUNCTION (this << vm << packet);
+    FlowKey key;
+    if (!ParseKey (packet, key)) return;
+
+    // the vm device stamped the hash of the key, see DCMetaTag
+    DCMetaTag meta;
+    uint32_t hash = packet->PeekPacketTag (meta) ? meta.GetFlowId () : KeyHash (key);
+
+    Time now = Simulator::Now ();
+    uint32_t id = FindOrAdd (key, hash, vm);
+    FlowStats &f = m_flows[id];
+    if (f.txPackets == 0)
+    {
+        f.firstTx = now;
+        f.firstFrame = packet->GetSize ();
+    }
+    f.lastTx = now;
+    f.txBytes += packet->GetSize ();
+    f.txPackets++;
+
+    DCFlowTag tag;
+    if (!packet->PeekPacketTag (tag))
+        packet->AddPacketTag (DCFlowTag (id, now));
+}
+
+void
+DCFlowMonitor::NotifyRx (Ptr<DCVm> vm, Ptr<const Packet> packet, Time now)
+{
+    NS_LOG_FUNCTION (this << vm << packet << now);
+    DCFlowTag tag;
+    if (!packet->PeekPacketTag (tag) || tag.GetFlow () >= m_flows.size ()) return;
+
+    FlowStats &f = m_flows[tag.GetFlow ()];
+    if (f.rxPackets == 0)
+    {
+        f.firstRx = now;
+        f.dst = vm;
+        f.path = GetPath (f.src, vm);
+    }
+    f.lastRx = now;
+    f.delaySum += now - tag.GetTxTime ();
+    f.rxBytes += packet->GetSize ();
+    f.rxPackets++;
+}
+
+void
+DCFlowMonitor::AddLink (Ptr<DCNode> child, Ptr<DCNode> parent, Path &path) const
+{
+    Ptr<Node> up = parent->GetOriginalNode ();
+    for (uint32_t i = 0;i < child->GetNDevices ();i++)
+    {
+        Ptr<DCPointChannelBase> c = DynamicCast<DCPointChannelBase> (child->GetDevice (i)->GetChannel ());
+        if (!c) continue;
+        for (uint32_t j = 0;j < c->GetNDevices ();j++)
+        {
+            if (c->GetDevice (j)->GetNode () != up) continue;
+            double rate = c->GetDataRate ().GetBitRate ();
+            path.delay += c->GetDelay ();
+            path.storeForward += 1.0 / rate;
+            if (path.bottleneck == 0 || rate < path.bottleneck)
+                path.bottleneck = rate;
+            return;
+        }
+    }
+    NS_LOG_WARN ("DCFlowMonitor::AddLink(): no link between " << child << " and " << parent);
+}
+
+int32_t
+DCFlowMonitor::GetPath (Ptr<DCNode> src, Ptr<DCNode> dst)
+{
+    std::pair<uint32_t,uint32_t> id (src->GetOriginalNode ()->GetId (),
+                                     dst->GetOriginalNode ()->GetId ());
+    std::map<std::pair<uint32_t,uint32_t>, int32_t>::const_iterator it = m_pathIndex.find (id);
+    if (it != m_pathIndex.end ()) return it->second;
+
+    std::vector<Ptr<DCNode> > up, down;
+    for (Ptr<DCNode> n = src;n;n = n->GetUpNode (0))
+        up.push_back (n);
+    for (Ptr<DCNode> n = dst;n;n = n->GetUpNode (0))
+        down.push_back (n);
+
+    // the lowest common ancestor
+    uint32_t u = 0, d = 0;
+    for (u = 0;u < up.size ();u++)
+    {
+        d = std::find (down.begin (), down.end (), up[u]) - down.begin ();
+        if (d < down.size ()) break;
+    }
+    NS_ASSERT_MSG (u < up.size (), "DCFlowMonitor::GetPath(): " << src << " and " << dst << " are not connected!");
+
+    Path path;
+    path.storeForward = 0;
+    path.bottleneck = 0;
+    for (uint32_t i = 0;i < u;i++)
+        AddLink (up[i], up[i + 1], path);
+    for (uint32_t i = 0;i < d;i++)
+        AddLink (down[i], down[i + 1], path);
+
+    m_paths.push_back (path);
+    m_pathIndex[id] = m_paths.size () - 1;
+    return m_paths.size () - 1;
+}
+
+uint32_t
+DCFlowMonitor::GetNFlows (void) const
+{
+    return m_flows.size ();
+}
+
+const DCFlowMonitor::FlowStats&
+DCFlowMonitor::GetFlow (uint32_t i) const
+{
+    NS_ASSERT (i < m_flows.size ());
+    return m_flows[i];
+}
+
+Time
+DCFlowMonitor::GetFct (uint32_t i) const
+{
+    const FlowStats &f = GetFlow (i);
+    if (f.rxPackets == 0) return Seconds (0);
+    return f.lastRx - f.firstTx;
+}
+
+Time
+DCFlowMonitor::GetIdealFct (uint32_t i) const
+{
+    const FlowStats &f = GetFlow (i);
+    if (f.path < 0) return Seconds (0);
+    const Path &p = m_paths[f.path];
+    double t = f.firstFrame * 8.0 * p.storeForward;
+    if (p.bottleneck > 0)
+        t += (f.txBytes - f.firstFrame) * 8.0 / p.bottleneck;
+    return p.delay + Seconds (t);
+}
+
+double
+DCFlowMonitor::GetSlowdown (uint32_t i) const
+{
+    Time ideal = GetIdealFct (i);
+    if (ideal.IsZero ()) return 0;
+    double s = GetFct (i).GetSeconds () / ideal.GetSeconds ();
+    return s < 1.0 ? 1.0 : s;
+}
+
+static std::string
+TenantName (Ptr<DCTenant> t)
+{
+    return t ? t->GetName () : "-";
+}
+
+void
+DCFlowMonitor::SerializeFlows (std::ostream &os, Ptr<DCTenant> tenant) const
+{
+    os << "flow,tenant,src,dst,proto,sport,dport,txBytes,rxBytes,txPackets,rxPackets,"
+       << "start_us,fct_us,ideal_us,slowdown,meanDelay_us" << std::endl;
+    for (uint32_t i = 0;i < m_flows.size ();i++)
+    {
+        const FlowStats &f = m_flows[i];
+        if (tenant && f.tenant != tenant) continue;
+        os << i << "," << TenantName (f.tenant)
+           << "," << f.src->GetOriginalNode ()->GetId ()
+           << "," << (f.dst ? (int64_t)f.dst->GetOriginalNode ()->GetId () : -1)
+           << "," << (uint32_t)f.key.ipProtocol
+           << "," << f.key.srcPort << "," << f.key.dstPort
+           << "," << f.txBytes << "," << f.rxBytes
+           << "," << f.txPackets << "," << f.rxPackets
+           << "," << f.firstTx.GetMicroSeconds ()
+           << "," << GetFct (i).GetMicroSeconds ()
+           << "," << GetIdealFct (i).GetMicroSeconds ()
+           << "," << GetSlowdown (i)
+           << "," << (f.rxPackets ? f.delaySum.GetMicroSeconds () / f.rxPackets : 0)
+           << std::endl;
+    }
+}
+
+static double
+Percentile (const std::vector<double> &v, double p)
+{
+    uint32_t i = (uint32_t)(p * (v.size () - 1) + 0.5);
+    return v[i];
+}
+
+void
+DCFlowMonitor::SerializeTenants (std::ostream &os) const
+{
+    std::map<Ptr<DCTenant>, std::vector<uint32_t> > flows;
+    for (uint32_t i = 0;i < m_flows.size ();i++)
+        if (m_flows[i].rxPackets > 0)
+            flows[m_flows[i].tenant].push_back (i);
+
+    os << "tenant,flows,fct_mean_us,fct_p50_us,fct_p99_us,fct_max_us,"
+       << "sd_mean,sd_p50,sd_p99,sd_max" << std::endl;
+    std::map<Ptr<DCTenant>, std::vector<uint32_t> >::const_iterator it;
+    for (it = flows.begin ();it != flows.end ();it++)
+    {
+        const std::vector<uint32_t> &ids = it->second;
+        std::vector<double> fct, sd;
+        double fctSum = 0, sdSum = 0;
+        for (uint32_t i = 0;i < ids.size ();i++)
+        {
+            fct.push_back (GetFct (ids[i]).GetMicroSeconds ());
+            sd.push_back (GetSlowdown (ids[i]));
+            fctSum += fct.back ();
+            sdSum += sd.back ();
+        }
+        std::sort (fct.begin (), fct.end ());
+        std::sort (sd.begin (), sd.end ());
+        os << TenantName (it->first) << "," << ids.size ()
+           << "," << fctSum / ids.size ()
+           << "," << Percentile (fct, 0.5) << "," << Percentile (fct, 0.99) << "," << fct.back ()
+           << "," << sdSum / ids.size ()
+           << "," << Percentile (sd, 0.5) << "," << Percentile (sd, 0.99) << "," << sd.back ()
+           << std::endl;
+    }
+}
+
+} // namespace ns3
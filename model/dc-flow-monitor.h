@@ -0,0 +1,227 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_FLOW_MONITOR_H__
+#define __DC_FLOW_MONITOR_H__
+
+#include <vector>
+#include <map>
+#include <ostream>
+#include "ns3/object.h"
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/mac48-address.h"
+#include "dc-point-callback.h"
+
+namespace ns3 {
+
+class DCVm;
+class DCNode;
+class DCTenant;
+class DCFlowMonitor;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Carry the flow index and the send time of a frame from the
+ * sender probe to the receiver probe.
+ */
+class DCFlowTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCFlowTag ();
+    DCFlowTag (uint32_t flow, Time txTime);
+
+    uint32_t GetFlow (void) const;
+    Time GetTxTime (void) const;
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    uint32_t m_flow;
+    int64_t m_txTime;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The hooks of DCFlowMonitor on the net device of one vm.
+ */
+class DCFlowProbe : public DCPointCallback
+{
+public:
+    static TypeId GetTypeId (void);
+    DCFlowProbe (void);
+    DCFlowProbe (DCFlowMonitor *monitor, Ptr<DCVm> vm);
+    virtual ~DCFlowProbe (void);
+
+    Ptr<DCVm> GetVm (void) const;
+
+    virtual void Register (Ptr<DCCsmaNetDevice> device);
+
+protected:
+    virtual void DoDispose (void);
+    virtual void TxPostEnqueue (Ptr<const Packet> packet);
+    virtual void RxSucess (Ptr<const Packet> packet);
+
+private:
+    DCFlowMonitor *m_monitor;
+    Ptr<DCVm> m_vm;
+    DCCsmaNetDevice *m_device;  // held by the vm
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A flow monitor working on the frames of the vms.
+ *
+ * A DCFlowProbe is registered as the DCPointCallback of the device of
+ * every monitored vm, it replaces the port callback set by DCHelper on
+ * that device. At the sender a frame is mapped to its flow, the MAC
+ * addresses, the ether type and, for IPv4, the 5-tuple, and a DCFlowTag
+ * is added. At the receiver only the tag is read, so the per frame cost
+ * is one hash lookup at the sender and none at the receiver.
+ *
+ * Flows live in a flat open addressing hash table, a power of two array
+ * of indexes into a dense vector of records, so a lookup touches two
+ * cache lines at most and no memory is allocated per frame.
+ *
+ * The flow completion time is the time from the first frame sent to the
+ * last frame received. The ideal time is the time of the flow alone on
+ * its path: the first frame is stored and forwarded on every link, the
+ * remaining bytes go at the rate of the slowest link. The path goes up
+ * through the first up node of both ends to their lowest common ancestor.
+ * The slowdown is the completion time over the ideal time.
+ *
+ * The results are exported per tenant, the tenant of a flow is the tenant
+ * of its sender.
+ */
+class DCFlowMonitor : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCFlowMonitor ();
+    virtual ~DCFlowMonitor ();
+
+    /**
+     * \brief Register a probe on the net device of the vm.
+     */
+    void Install (Ptr<DCVm> vm);
+
+    struct FlowKey
+    {
+        uint64_t srcMac;
+        uint64_t dstMac;
+        uint32_t srcIp;
+        uint32_t dstIp;
+        uint16_t srcPort;
+        uint16_t dstPort;
+        uint16_t protocol;      // ether type
+        uint8_t ipProtocol;
+    };
+
+    struct FlowStats
+    {
+        FlowKey key;
+        uint32_t hash;          // the hash the flow was added with
+        Ptr<DCVm> src;
+        Ptr<DCVm> dst;
+        Ptr<DCTenant> tenant;
+        Time firstTx;
+        Time lastTx;
+        Time firstRx;
+        Time lastRx;
+        Time delaySum;
+        uint64_t txBytes;
+        uint64_t rxBytes;
+        uint32_t txPackets;
+        uint32_t rxPackets;
+        uint32_t firstFrame;    // bytes of the first frame sent
+        int32_t path;           // index of the path, -1 before the first rx
+    };
+
+    /**
+     * \brief Read the flow key from the headers of an ethernet frame, or
+     * from its DCL2MetaTag and its payload if it is header free.
+     * \return false if the frame is too short
+     */
+    static bool ParseKey (Ptr<const Packet> packet, FlowKey &key);
+    /**
+     * \brief Read the flow key of a frame before its ethernet header is
+     * added, the L2 part is given.
+     */
+    static void ParsePayloadKey (Ptr<const Packet> payload, Mac48Address src,
+                                 Mac48Address dst, uint16_t protocol, FlowKey &key);
+    static uint32_t KeyHash (const FlowKey &key);
+
+    uint32_t GetNFlows (void) const;
+    const FlowStats& GetFlow (uint32_t i) const;
+
+    /**
+     * \return the completion time of flow i, zero if nothing received
+     */
+    Time GetFct (uint32_t i) const;
+    /**
+     * \return the ideal completion time of flow i on an idle network
+     */
+    Time GetIdealFct (uint32_t i) const;
+    /**
+     * \return the slowdown of flow i, 0 if nothing received
+     */
+    double GetSlowdown (uint32_t i) const;
+
+    /**
+     * \brief Write one line per flow, in CSV.
+     * \param tenant only the flows of this tenant, all flows if 0
+     */
+    void SerializeFlows (std::ostream &os, Ptr<DCTenant> tenant = 0) const;
+    /**
+     * \brief Write the FCT and slowdown distributions of every tenant.
+     *
+     * One line per tenant with the number of flows, the mean, median, 99th
+     * percentile and maximum of the FCT (us) and of the slowdown.
+     */
+    void SerializeTenants (std::ostream &os) const;
+
+    // called by the probes
+    void NotifyTx (Ptr<DCVm> vm, Ptr<const Packet> packet);
+    void NotifyRx (Ptr<DCVm> vm, Ptr<const Packet> packet, Time now);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    struct Path
+    {
+        Time delay;             // propagation of all links
+        double storeForward;    // sum of 1/rate of all links, s/bit
+        double bottleneck;      // bit/s of the slowest link
+    };
+
+    static bool KeyEqual (const FlowKey &a, const FlowKey &b);
+    static void ParseIpv4 (const uint8_t *buf, uint32_t n, uint32_t off, FlowKey &key);
+
+    uint32_t FindOrAdd (const FlowKey &key, uint32_t hash, Ptr<DCVm> vm);
+    void Grow (void);
+    int32_t GetPath (Ptr<DCNode> src, Ptr<DCNode> dst);
+    void AddLink (Ptr<DCNode> child, Ptr<DCNode> parent, Path &path) const;
+
+    std::vector<Ptr<DCFlowProbe> > m_probes;
+
+    // flat hash table, the slots hold flow index + 1, 0 is empty
+    std::vector<uint32_t> m_slots;
+    std::vector<FlowStats> m_flows;
+
+    std::vector<Path> m_paths;
+    std::map<std::pair<uint32_t,uint32_t>, int32_t> m_pathIndex;
+};
+
+} // namespace ns3
+
+#endif /* __DC_FLOW_MONITOR_H__ */
@@ -126,6 +126,10 @@ DCHost::GetTypeId (void)
                 ObjectFactoryValue (GetDefaultFactory<DCCsmaNetDevice>()),
                 MakeObjectFactoryAccessor (&DCHost::m_portDevFactory),
                 MakeObjectFactoryChecker ())
+        .AddAttribute ("VmDeviceFactory","Device factory to create the net device of the vms of this host.",
+                ObjectFactoryValue (GetDefaultFactory<DCCsmaNetDevice>()),
+                MakeObjectFactoryAccessor (&DCHost::m_vmDevFactory),
+                MakeObjectFactoryChecker ())
         .AddAttribute ("SwitchPortQueueFactory","The packet queue factory for switch port devices.",
                 ObjectFactoryValue (GetDefaultFactory<DropTailQueue>()),
                 MakeObjectFactoryAccessor (&DCHost::m_switchPortQueFactory),
@@ -143,7 +147,7 @@ DCHost::GetTypeId (void)
                 MakePointerAccessor (&DCHost::m_vmAddressAllocater),
                 MakePointerChecker<DCAddressAllocater> ())
         .AddAttribute ("VirtualLinkFactory","Virtual link factory to create virtual links for connecting a host and its vms with bandwidth limit.",
-                ObjectFactoryValue (GetDefaultFactory<DCCsmaChannel>()),
+                ObjectFactoryValue (GetDefaultFactory<DCCsmaP2PChannel>()),
                 MakeObjectFactoryAccessor (&DCHost::m_virtualLinkFactory),
                 MakeObjectFactoryChecker ())
     ;
@@ -279,7 +283,7 @@ DCHost::Allocate(
     
     // create a vm
     Ptr<DCVm> vm = m_vmFactory.Create<DCVm>();
-    Ptr<DCPointNetDeviceBase> vmDev = m_portDevFactory.Create<DCPointNetDeviceBase>();
+    Ptr<DCPointNetDeviceBase> vmDev = m_vmDevFactory.Create<DCPointNetDeviceBase>();
     Ptr<Queue> vmQue = m_vmPortQueFactory.Create<Queue>();
     vm->SetPointNetDevice(vmDev);
     vm->SetQueue(vmQue);
@@ -304,7 +308,7 @@ DCHost::Allocate(
     m_bridge->AddBridgePort(hostPortDev);
 
     // set bandwidth and delay
-    Ptr<DCPointChannelBase> link = m_virtualLinkFactory.Create<DCPointChannelBase>();
+    Ptr<DCPointChannelBase> link = DCCsmaP2PChannel::CreateLink(m_virtualLinkFactory);
     link->SetDataRate(hardLimitBw);
     link->SetDelay(Time(0));
     hostPortDev->Attach(link);
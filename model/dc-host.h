@@ -147,6 +147,7 @@ protected:
     Address m_bridgeAddress;
     ObjectFactory m_vmFactory;
     ObjectFactory m_portDevFactory;
+    ObjectFactory m_vmDevFactory;
     ObjectFactory m_switchPortQueFactory;
     ObjectFactory m_vmPortQueFactory;
     ObjectFactory m_virtualLinkFactory;
@@ -0,0 +1,236 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <algorithm>
+#include <vector>
+#include "ns3/log.h"
+#include "dc-int.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCInt");
+
+namespace ns3 {
+
+/*
+ * The ring of record stacks behind the serialized DCIntTag, allocated on
+ * the first tag with a record. A slot holds the serial number of the tag
+ * written in it, so a tag whose slot was taken again finds it out.
+ */
+struct DCIntSlot
+{
+    DCIntSlot () : serial (0) {}
+    uint32_t serial;
+    DCIntRecord records[DCIntTag::MAX_HOPS];
+};
+
+static std::vector<DCIntSlot> g_intRing;
+static uint32_t g_intSerial = 0;
+
+DCIntRecord::DCIntRecord ()
+    : m_timestamp (0),
+      m_switchId (0),
+      m_queueDepth (0),
+      m_egressPort (0),
+      m_utilization (0)
+{
+}
+
+void
+DCIntRecord::SetSwitchId (uint32_t id)
+{
+    m_switchId = id;
+}
+
+uint32_t
+DCIntRecord::GetSwitchId (void) const
+{
+    return m_switchId;
+}
+
+void
+DCIntRecord::SetEgressPort (uint16_t port)
+{
+    m_egressPort = port;
+}
+
+uint16_t
+DCIntRecord::GetEgressPort (void) const
+{
+    return m_egressPort;
+}
+
+void
+DCIntRecord::SetQueueDepth (uint32_t bytes)
+{
+    m_queueDepth = bytes;
+}
+
+uint32_t
+DCIntRecord::GetQueueDepth (void) const
+{
+    return m_queueDepth;
+}
+
+void
+DCIntRecord::SetTimestamp (Time t)
+{
+    m_timestamp = t.GetTimeStep ();
+}
+
+Time
+DCIntRecord::GetTimestamp (void) const
+{
+    return TimeStep (m_timestamp);
+}
+
+void
+DCIntRecord::SetUtilization (double u)
+{
+    if (u < 0) u = 0;
+    if (u > 1) u = 1;
+    m_utilization = (uint16_t)(u * 65535 + 0.5);
+}
+
+double
+DCIntRecord::GetUtilization (void) const
+{
+    return m_utilization / 65535.0;
+}
+
+void
+DCIntRecord::Print (std::ostream &os) const
+{
+    os << "switch=" << m_switchId
+       << " port=" << m_egressPort
+       << " qdepth=" << m_queueDepth
+       << " ts=" << m_timestamp
+       << " util=" << GetUtilization ();
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCIntTag);
+
+const uint8_t DCIntTag::MAX_HOPS;
+const uint32_t DCIntTag::RING_SIZE;
+
+TypeId
+DCIntTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCIntTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCIntTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCIntTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCIntTag::DCIntTag ()
+    : m_hops (0),
+      m_maxHops (MAX_HOPS),
+      m_overflow (false)
+{
+}
+
+DCIntTag::DCIntTag (uint8_t maxHops)
+    : m_hops (0),
+      m_maxHops (maxHops < MAX_HOPS ? maxHops : MAX_HOPS),
+      m_overflow (false)
+{
+}
+
+uint8_t
+DCIntTag::GetHops (void) const
+{
+    return m_hops;
+}
+
+uint8_t
+DCIntTag::GetMaxHops (void) const
+{
+    return m_maxHops;
+}
+
+bool
+DCIntTag::IsOverflow (void) const
+{
+    return m_overflow;
+}
+
+bool
+DCIntTag::AddHop (const DCIntRecord &record)
+{
+    if (m_hops >= m_maxHops)
+    {
+        m_overflow = true;
+        return false;
+    }
+    m_records[m_hops++] = record;
+    return true;
+}
+
+const DCIntRecord *
+DCIntTag::GetRecords (void) const
+{
+    return m_records;
+}
+
+uint32_t
+DCIntTag::GetSerializedSize (void) const
+{
+    return 8;
+}
+
+void
+DCIntTag::Serialize (TagBuffer i) const
+{
+    uint32_t serial = 0;
+    if (m_hops > 0)
+    {
+        if (g_intRing.empty ())
+            g_intRing.resize (RING_SIZE);
+        // 0 is for no slot
+        if (++g_intSerial == 0) ++g_intSerial;
+        serial = g_intSerial;
+        DCIntSlot &slot = g_intRing[serial % RING_SIZE];
+        slot.serial = serial;
+        std::copy (m_records, m_records + m_hops, slot.records);
+    }
+    i.WriteU8 (m_hops);
+    i.WriteU8 (m_maxHops);
+    i.WriteU8 (m_overflow);
+    i.WriteU8 (0);
+    i.WriteU32 (serial);
+}
+
+void
+DCIntTag::Deserialize (TagBuffer i)
+{
+    m_hops = i.ReadU8 ();
+    m_maxHops = i.ReadU8 ();
+    m_overflow = i.ReadU8 ();
+    i.ReadU8 ();
+    uint32_t serial = i.ReadU32 ();
+    if (m_hops == 0) return;
+
+    const DCIntSlot &slot = g_intRing[serial % RING_SIZE];
+    if (slot.serial != serial)
+    {
+        NS_LOG_WARN ("DCIntTag::Deserialize(): the records of " << (uint32_t)m_hops
+                     << " hops were overwritten, more than RING_SIZE tags on the way");
+        m_hops = 0;
+        m_overflow = true;
+        return;
+    }
+    std::copy (slot.records, slot.records + m_hops, m_records);
+}
+
+void
+DCIntTag::Print (std::ostream &os) const
+{
+    os << "hops=" << (uint32_t)m_hops << "/" << (uint32_t)m_maxHops;
+    if (m_overflow)
+        os << " overflow";
+}
+
+} // namespace ns3
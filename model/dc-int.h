@@ -0,0 +1,109 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_INT_H__
+#define __DC_INT_H__
+
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The telemetry of one bridge hop, 20 bytes on the wire.
+ */
+class DCIntRecord
+{
+public:
+    DCIntRecord ();
+
+    void SetSwitchId (uint32_t id);
+    uint32_t GetSwitchId (void) const;
+    void SetEgressPort (uint16_t port);
+    uint16_t GetEgressPort (void) const;
+    /**
+     * \param bytes bytes queued at the egress port when the frame arrived
+     */
+    void SetQueueDepth (uint32_t bytes);
+    uint32_t GetQueueDepth (void) const;
+    void SetTimestamp (Time t);
+    Time GetTimestamp (void) const;
+    /**
+     * \param u utilization of the egress link, 0.0 to 1.0
+     */
+    void SetUtilization (double u);
+    double GetUtilization (void) const;
+
+    void Print (std::ostream &os) const;
+
+private:
+    uint64_t m_timestamp;
+    uint32_t m_switchId;
+    uint32_t m_queueDepth;
+    uint16_t m_egressPort;
+    uint16_t m_utilization;     // in 1/65535
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Ask the bridges on the path to record in-band telemetry, and
+ * carry their records.
+ *
+ * A frame carrying this tag gets a DCIntRecord from every bridge that
+ * forwards it, until MaxHops records have been added; the bridges past
+ * that set the overflow flag. The tag is added by the sender, see the
+ * IntMaxHops attribute of DCCsmaNetDevice, or by an application.
+ *
+ * The records live in a fixed array of the tag. A packet tag of ns-3
+ * serializes to 20 bytes at most, so the tag serializes the array into
+ * a slot of a ring allocated once, of RING_SIZE stacks, and only the
+ * slot number travels in the packet. Every AddPacketTag takes a new
+ * slot, copies of a frame never share one. A frame still on the way
+ * when its slot is taken again, after RING_SIZE later tags, loses its
+ * records: it arrives with no hop and the overflow flag set.
+ */
+class DCIntTag : public Tag
+{
+public:
+    static const uint8_t MAX_HOPS = 16;
+    static const uint32_t RING_SIZE = 16384;
+
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCIntTag ();
+    DCIntTag (uint8_t maxHops);
+
+    uint8_t GetHops (void) const;
+    uint8_t GetMaxHops (void) const;
+    /**
+     * \return true if some hops could not add their record
+     */
+    bool IsOverflow (void) const;
+    /**
+     * \brief Add the record of a hop, or set the overflow flag.
+     * \return false if no more record may be added
+     */
+    bool AddHop (const DCIntRecord &record);
+    /**
+     * \return the GetHops records, in hop order
+     */
+    const DCIntRecord *GetRecords (void) const;
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    uint8_t m_hops;
+    uint8_t m_maxHops;
+    bool m_overflow;
+    DCIntRecord m_records[MAX_HOPS];
+};
+
+} // namespace ns3
+
+#endif /* __DC_INT_H__ */
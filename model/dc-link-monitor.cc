@@ -0,0 +1,286 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "dc-vm.h"
+#include "dc-host.h"
+#include "dc-switch.h"
+#include "dc-node-mapper.h"
+#include "dc-point-channel.h"
+#include "dc-point-net-device.h"
+#include "dc-link-monitor.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCLinkMonitor");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCLinkMonitor);
+
+TypeId
+DCLinkMonitor::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCLinkMonitor")
+        .SetParent<Object> ()
+        .AddConstructor<DCLinkMonitor> ()
+        .AddAttribute ("BinWidth",
+                       "The time of a bin of the matrix.",
+                       TimeValue (MilliSeconds (1)),
+                       MakeTimeAccessor (&DCLinkMonitor::m_binWidth),
+                       MakeTimeChecker ())
+    ;
+    return tid;
+}
+
+DCLinkMonitor::DCLinkMonitor ()
+    : m_binStep (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCLinkMonitor::~DCLinkMonitor ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCLinkMonitor::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_links.clear ();
+    m_channels.clear ();
+    Object::DoDispose ();
+}
+
+bool
+DCLinkMonitor::AddChannel (Ptr<DCCsmaChannel> channel)
+{
+    NS_LOG_FUNCTION (this << channel);
+    NS_ABORT_MSG_UNLESS (m_counts.empty (), "DCLinkMonitor::AddChannel(): the channels must be added before the first frame");
+    if (m_channels.find (channel) != m_channels.end ())
+        return false;
+
+    m_binStep = m_binWidth.GetTimeStep ();
+    NS_ABORT_MSG_UNLESS (m_binStep > 0, "DCLinkMonitor::AddChannel(): BinWidth must be positive");
+    double bps = channel->GetDataRate ().GetBitRate ();
+    NS_ABORT_MSG_IF (bps / 8 * m_binWidth.GetSeconds () >= 4294967296.0,
+                     "DCLinkMonitor::AddChannel(): BinWidth too large for the counters at " << bps << "bps");
+
+    uint32_t first = m_links.size ();
+    m_channels[channel] = first;
+    uint32_t n = channel->GetNDevices ();
+    for (uint32_t i = 0;i < n;i++)
+    {
+        Link link;
+        link.channel = channel;
+        link.src = channel->GetDevice (i);
+        link.dst = n == 2 ? channel->GetDevice (1 - i) : 0;
+        link.bps = bps;
+        m_links.push_back (link);
+    }
+
+    Ptr<DCLinkMonitorProbe> probe = CreateObject<DCLinkMonitorProbe> (this, first);
+    channel->TraceConnectWithoutContext ("TxEnd", MakeCallback (&DCLinkMonitorProbe::TxEnd, probe));
+    return true;
+}
+
+bool
+DCLinkMonitor::AddDevice (Ptr<NetDevice> nd)
+{
+    Ptr<DCCsmaNetDevice> device = nd->GetObject<DCCsmaNetDevice> ();
+    if (device == 0)
+        return false;
+    Ptr<DCCsmaChannel> channel = DynamicCast<DCCsmaChannel> (device->GetChannel ());
+    if (channel == 0)
+        return false;
+    return AddChannel (channel);
+}
+
+uint32_t
+DCLinkMonitor::GetNLinks (void) const
+{
+    return m_links.size ();
+}
+
+uint32_t
+DCLinkMonitor::GetNBins (void) const
+{
+    return m_links.empty () ? 0 : m_counts.size () / m_links.size ();
+}
+
+uint32_t
+DCLinkMonitor::GetBytes (uint32_t link, uint32_t bin) const
+{
+    NS_ASSERT (link < m_links.size ());
+    if (bin >= GetNBins ()) return 0;
+    return m_counts[(uint64_t)bin * m_links.size () + link];
+}
+
+void
+DCLinkMonitor::NotifyTxEnd (uint32_t link, Ptr<const Packet> p)
+{
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    uint32_t size = DCL2MetaTag::GetFrameSize (p);
+    int64_t txTime = Seconds (size * 8 / m_links[link].bps).GetTimeStep ();
+    Count (link, size, now - txTime, now);
+}
+
+void
+DCLinkMonitor::Count (uint32_t link, uint64_t bytes, int64_t from, int64_t to)
+{
+    if (from < 0) from = 0;
+    int64_t first = from / m_binStep;
+    int64_t last = to > from ? (to - 1) / m_binStep : first;
+
+    uint64_t nLinks = m_links.size ();
+    if ((uint64_t)(last + 1) * nLinks > m_counts.size ())
+        m_counts.resize ((last + 1) * nLinks, 0);
+
+    if (first == last)
+    {
+        m_counts[first * nLinks + link] += bytes;
+        return;
+    }
+
+    // split by the time spent in every bin, the rounding goes to the last
+    uint64_t left = bytes;
+    for (int64_t bin = first;bin < last;bin++)
+    {
+        int64_t end = (bin + 1) * m_binStep;
+        int64_t begin = bin == first ? from : bin * m_binStep;
+        uint64_t part = bytes * (end - begin) / (to - from);
+        m_counts[bin * nLinks + link] += part;
+        left -= part;
+    }
+    m_counts[last * nLinks + link] += left;
+}
+
+static std::string
+NodeKind (Ptr<DCNode> node)
+{
+    if (DynamicCast<DCVm> (node)) return "vm";
+    if (DynamicCast<DCHost> (node)) return "host";
+    if (DynamicCast<DCSwitch> (node)) return "switch";
+    return "node";
+}
+
+static uint32_t
+NodeDepth (Ptr<DCNode> node)
+{
+    uint32_t depth = 0;
+    while (node && node->GetNUpNodes () > 0)
+    {
+        node = node->GetUpNode (0);
+        depth++;
+    }
+    return depth;
+}
+
+static void
+WriteEnd (std::ostream &os, Ptr<NetDevice> nd)
+{
+    if (nd == 0)
+    {
+        os << ",-1,,-1,,-1";
+        return;
+    }
+    Ptr<Node> node = nd->GetNode ();
+    Ptr<DCNode> dcNode = DCNodeMapper::GetDCNode (node);
+    os << "," << node->GetId ();
+    if (dcNode)
+        os << "," << dcNode->GetName () << "," << nd->GetIfIndex ()
+           << "," << NodeKind (dcNode) << "," << NodeDepth (dcNode);
+    else
+        os << ",," << nd->GetIfIndex () << ",,-1";
+}
+
+void
+DCLinkMonitor::WriteLinks (std::ostream &os) const
+{
+    os << "link,channel,src_node,src_name,src_port,src_kind,src_depth,"
+       << "dst_node,dst_name,dst_port,dst_kind,dst_depth,rate_bps,delay_ns" << std::endl;
+    for (uint32_t i = 0;i < m_links.size ();i++)
+    {
+        const Link &link = m_links[i];
+        os << i << "," << link.channel->GetId ();
+        WriteEnd (os, link.src);
+        WriteEnd (os, link.dst);
+        os << "," << (uint64_t)link.bps << "," << link.channel->GetDelay ().GetNanoSeconds ()
+           << std::endl;
+    }
+}
+
+void
+DCLinkMonitor::Write (std::string prefix) const
+{
+    NS_LOG_FUNCTION (this << prefix);
+    std::string filename = prefix + ".bin";
+    std::FILE *file = std::fopen (filename.c_str (), "wb");
+    NS_ABORT_MSG_UNLESS (file, "DCLinkMonitor::Write(): can't open " << filename);
+
+    DCLinkMatrixHeader h;
+    std::memset (&h, 0, sizeof (h));
+    h.magic = DCLinkMatrixHeader::MAGIC;
+    h.version = DCLinkMatrixHeader::VERSION;
+    h.counterSize = sizeof (uint32_t);
+    h.nLinks = m_links.size ();
+    h.nBins = GetNBins ();
+    h.binWidth = m_binWidth.GetTimeStep ();
+    h.stepsPerSecond = Seconds (1).GetTimeStep ();
+    std::fwrite (&h, sizeof (h), 1, file);
+
+    // the counters are kept bin major, the file is link major
+    std::vector<uint32_t> row (h.nBins);
+    for (uint32_t link = 0;link < h.nLinks;link++)
+    {
+        for (uint32_t bin = 0;bin < h.nBins;bin++)
+            row[bin] = m_counts[(uint64_t)bin * h.nLinks + link];
+        if (h.nBins > 0)
+            std::fwrite (&row[0], sizeof (uint32_t), h.nBins, file);
+    }
+    std::fclose (file);
+
+    std::ofstream links ((prefix + ".links.csv").c_str ());
+    NS_ABORT_MSG_UNLESS (links, "DCLinkMonitor::Write(): can't open " << prefix << ".links.csv");
+    WriteLinks (links);
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCLinkMonitorProbe);
+
+TypeId
+DCLinkMonitorProbe::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCLinkMonitorProbe")
+        .SetParent<Object> ()
+        .AddConstructor<DCLinkMonitorProbe> ()
+    ;
+    return tid;
+}
+
+DCLinkMonitorProbe::DCLinkMonitorProbe ()
+    : m_firstLink (0)
+{
+}
+
+DCLinkMonitorProbe::DCLinkMonitorProbe (Ptr<DCLinkMonitor> monitor, uint32_t firstLink)
+    : m_monitor (monitor),
+      m_firstLink (firstLink)
+{
+}
+
+void
+DCLinkMonitorProbe::DoDispose (void)
+{
+    m_monitor = 0;
+    Object::DoDispose ();
+}
+
+void
+DCLinkMonitorProbe::TxEnd (Ptr<const Packet> p, uint32_t deviceId)
+{
+    m_monitor->NotifyTxEnd (m_firstLink + deviceId, p);
+}
+
+} // namespace ns3
@@ -0,0 +1,143 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_LINK_MONITOR_H__
+#define __DC_LINK_MONITOR_H__
+
+#include <map>
+#include <vector>
+#include <string>
+#include <ostream>
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/net-device.h"
+
+namespace ns3 {
+
+class DCCsmaChannel;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The header of a link matrix file, 32 bytes.
+ *
+ * It is followed by nLinks rows of nBins counters of counterSize bytes,
+ * the bytes sent on the link in every bin, in the byte order of the
+ * machine writing the file.
+ */
+struct DCLinkMatrixHeader
+{
+    static const uint32_t MAGIC = 0x4d4c4344;   // "DCLM" in little endian
+    static const uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t counterSize;
+    uint32_t nLinks;
+    uint32_t nBins;
+    int64_t binWidth;           // in time steps
+    uint64_t stepsPerSecond;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Count the bytes sent on every link of the fabric in fixed time
+ * bins.
+ *
+ * A link is one direction of a DCCsmaChannel, the one sent by a device
+ * attached to it. The links of a channel get consecutive ids in the order
+ * of the device ids of the channel, so the TxEnd trace of the channel
+ * gives the link id with an addition.
+ *
+ * The counters of a bin are one contiguous row indexed by the link id, a
+ * row is appended when the time reaches a new bin. A frame is counted in
+ * the bins its transmission overlaps, in proportion of the time. All the
+ * channels must be added before the first frame is sent, and after all
+ * their devices are attached.
+ *
+ * Write dumps the matrix link x bin in a binary file and the description
+ * of the links, their ends, rate and delay, in a CSV sidecar file.
+ */
+class DCLinkMonitor : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCLinkMonitor ();
+    virtual ~DCLinkMonitor ();
+
+    /**
+     * \brief Add the links of a channel and connect its TxEnd trace.
+     * \return false if the channel was already added
+     */
+    bool AddChannel (Ptr<DCCsmaChannel> channel);
+    /**
+     * \brief Add the channel of a DCCsmaNetDevice.
+     */
+    bool AddDevice (Ptr<NetDevice> nd);
+
+    uint32_t GetNLinks (void) const;
+    uint32_t GetNBins (void) const;
+    /**
+     * \return the bytes sent on a link in a bin
+     */
+    uint32_t GetBytes (uint32_t link, uint32_t bin) const;
+
+    /**
+     * \brief Write the matrix in prefix.bin and the links in
+     * prefix.links.csv.
+     */
+    void Write (std::string prefix) const;
+    void WriteLinks (std::ostream &os) const;
+
+    // called by the probes
+    void NotifyTxEnd (uint32_t link, Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    struct Link
+    {
+        Ptr<DCCsmaChannel> channel;
+        Ptr<NetDevice> src;
+        Ptr<NetDevice> dst;     // 0 if the channel has more than two devices
+        double bps;
+    };
+
+    void Count (uint32_t link, uint64_t bytes, int64_t from, int64_t to);
+
+    Time m_binWidth;
+    int64_t m_binStep;
+    std::vector<Link> m_links;
+    std::map<Ptr<DCCsmaChannel>, uint32_t> m_channels;
+    // bin major, m_counts[bin * links + link]
+    std::vector<uint32_t> m_counts;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The TxEnd trace sink of one channel of a DCLinkMonitor.
+ */
+class DCLinkMonitorProbe : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCLinkMonitorProbe ();
+    DCLinkMonitorProbe (Ptr<DCLinkMonitor> monitor, uint32_t firstLink);
+
+    void TxEnd (Ptr<const Packet> p, uint32_t deviceId);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    Ptr<DCLinkMonitor> m_monitor;
+    uint32_t m_firstLink;
+};
+
+} // namespace ns3
+
+#endif /* __DC_LINK_MONITOR_H__ */
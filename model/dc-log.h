@@ -0,0 +1,54 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_LOG_H__
+#define __DC_LOG_H__
+
+#include "ns3/log.h"
+#include "ns3/assert.h"
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The logging and assertion macros of the per packet paths of the
+ * module: the bridge and point devices, the bridge forwards and the
+ * channels.
+ *
+ * They are the NS_LOG and NS_ASSERT macros of the same name, unless the
+ * module is configured with --dc-fast, which defines DC_FAST: the logging
+ * then compiles to nothing, even in a debug build, and so do the
+ * assertions unless --dc-fast-asserts defines DC_FAST_ASSERT too.
+ *
+ * NS_LOG_WARN, NS_LOG_ERROR and the aborts are on rare paths and are
+ * kept as they are.
+ */
+
+#ifdef DC_FAST
+
+#define DC_LOG_FUNCTION_NOARGS()
+#define DC_LOG_FUNCTION(parameters)
+#define DC_LOG_DEBUG(msg)
+#define DC_LOG_LOGIC(msg)
+#define DC_LOG_INFO(msg)
+
+#else /* DC_FAST */
+
+#define DC_LOG_FUNCTION_NOARGS() NS_LOG_FUNCTION_NOARGS ()
+#define DC_LOG_FUNCTION(parameters) NS_LOG_FUNCTION (parameters)
+#define DC_LOG_DEBUG(msg) NS_LOG_DEBUG (msg)
+#define DC_LOG_LOGIC(msg) NS_LOG_LOGIC (msg)
+#define DC_LOG_INFO(msg) NS_LOG_INFO (msg)
+
+#endif /* DC_FAST */
+
+#if defined (DC_FAST) && !defined (DC_FAST_ASSERT)
+
+#define DC_ASSERT(condition)
+#define DC_ASSERT_MSG(condition, message)
+
+#else
+
+#define DC_ASSERT(condition) NS_ASSERT (condition)
+#define DC_ASSERT_MSG(condition, message) NS_ASSERT_MSG (condition, message)
+
+#endif
+
+#endif /* __DC_LOG_H__ */
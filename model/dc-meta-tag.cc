@@ -0,0 +1,84 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "dc-meta-tag.h"
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCMetaTag);
+
+TypeId
+DCMetaTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCMetaTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCMetaTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCMetaTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCMetaTag::DCMetaTag ()
+    : m_flowId (0),
+      m_tenantId (0),
+      m_txTime (0)
+{
+}
+
+DCMetaTag::DCMetaTag (uint32_t flowId, uint32_t tenantId, Time txTime)
+    : m_flowId (flowId),
+      m_tenantId (tenantId),
+      m_txTime (txTime.GetTimeStep ())
+{
+}
+
+uint32_t
+DCMetaTag::GetFlowId (void) const
+{
+    return m_flowId;
+}
+
+uint32_t
+DCMetaTag::GetTenantId (void) const
+{
+    return m_tenantId;
+}
+
+Time
+DCMetaTag::GetTxTime (void) const
+{
+    return TimeStep (m_txTime);
+}
+
+uint32_t
+DCMetaTag::GetSerializedSize (void) const
+{
+    return 16;
+}
+
+void
+DCMetaTag::Serialize (TagBuffer i) const
+{
+    i.WriteU32 (m_flowId);
+    i.WriteU32 (m_tenantId);
+    i.WriteU64 (m_txTime);
+}
+
+void
+DCMetaTag::Deserialize (TagBuffer i)
+{
+    m_flowId = i.ReadU32 ();
+    m_tenantId = i.ReadU32 ();
+    m_txTime = i.ReadU64 ();
+}
+
+void
+DCMetaTag::Print (std::ostream &os) const
+{
+    os << "flow=" << m_flowId << " tenant=" << m_tenantId << " tx=" << m_txTime;
+}
+
+} // namespace ns3
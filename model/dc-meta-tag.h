@@ -0,0 +1,55 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_META_TAG_H__
+#define __DC_META_TAG_H__
+
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The flow, the tenant and the send time of a frame of a vm.
+ *
+ * Added once by the DCCsmaNetDevice of the sending vm, in SendFrom, and
+ * kept by every bridge on the path. The bridge and forward modules read
+ * the flow from here instead of parsing the IPv4 and transport headers at
+ * every hop.
+ *
+ * The flow id is DCFlowMonitor::KeyHash of the flow key of the frame, so
+ * it is the hash DCFlowMonitor, DCBinaryTraceWriter and DCCaptureFilter
+ * compute from the headers. The tenant id is the index of the tenant of
+ * the vm in DCTenantList plus one, 0 if the vm has no tenant.
+ */
+class DCMetaTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCMetaTag ();
+    DCMetaTag (uint32_t flowId, uint32_t tenantId, Time txTime);
+
+    uint32_t GetFlowId (void) const;
+    uint32_t GetTenantId (void) const;
+    /**
+     * \return the time the vm sent the frame
+     */
+    Time GetTxTime (void) const;
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    uint32_t m_flowId;
+    uint32_t m_tenantId;
+    int64_t m_txTime;
+};
+
+} // namespace ns3
+
+#endif /* __DC_META_TAG_H__ */
@@ -0,0 +1,380 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstdlib>
+#include "ns3/log.h"
+#include "ns3/enum.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "dc-packet-classifier.h"
+#include "dc-point-net-device.h"
+#include "dc-multi-class-queue.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCMultiClassQueue");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCMultiClassQueue);
+
+TypeId
+DCMultiClassQueue::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCMultiClassQueue")
+        .SetParent<Queue> ()
+        .AddConstructor<DCMultiClassQueue> ()
+        .AddAttribute ("Scheduler",
+                       "The scheduler serving the classes.",
+                       EnumValue (SP),
+                       MakeEnumAccessor (&DCMultiClassQueue::m_scheduler),
+                       MakeEnumChecker (SP, "SP",
+                                        DRR, "DRR",
+                                        WFQ, "WFQ"))
+        .AddAttribute ("Classes",
+                       "The number of traffic classes.",
+                       UintegerValue (MAX_CLASSES),
+                       MakeUintegerAccessor (&DCMultiClassQueue::m_nClasses),
+                       MakeUintegerChecker<uint32_t> (1, MAX_CLASSES))
+        .AddAttribute ("DefaultClass",
+                       "The class of packets without a DCClassTag.",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCMultiClassQueue::m_defaultClass),
+                       MakeUintegerChecker<uint32_t> (0, MAX_CLASSES - 1))
+        .AddAttribute ("Mode",
+                       "Whether to use bytes (see MaxBytes) or packets (see MaxPackets) as the maximum class size metric.",
+                       EnumValue (QUEUE_MODE_PACKETS),
+                       MakeEnumAccessor (&DCMultiClassQueue::SetMode),
+                       MakeEnumChecker (QUEUE_MODE_BYTES, "QUEUE_MODE_BYTES",
+                                        QUEUE_MODE_PACKETS, "QUEUE_MODE_PACKETS"))
+        .AddAttribute ("MaxPackets",
+                       "The maximum number of packets accepted by every class, as counted by DCGsoTag::CountSegments.",
+                       UintegerValue (100),
+                       MakeUintegerAccessor (&DCMultiClassQueue::m_maxPackets),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("MaxBytes",
+                       "The maximum number of bytes accepted by every class.",
+                       UintegerValue (100 * 65535),
+                       MakeUintegerAccessor (&DCMultiClassQueue::m_maxBytes),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("Weights",
+                       "Comma separated class weights of DRR and WFQ, unlisted classes get weight 1.",
+                       StringValue (""),
+                       MakeStringAccessor (&DCMultiClassQueue::SetWeights),
+                       MakeStringChecker ())
+        .AddAttribute ("Quantum",
+                       "DRR bytes per turn of a class with weight 1, should not be less than the largest frame.",
+                       UintegerValue (1518),
+                       MakeUintegerAccessor (&DCMultiClassQueue::m_quantum),
+                       MakeUintegerChecker<uint32_t> (1))
+    ;
+    return tid;
+}
+
+DCMultiClassQueue::DCMultiClassQueue ()
+    : m_nClasses (MAX_CLASSES),
+      m_defaultClass (0),
+      m_scheduler (SP),
+      m_active (0),
+      m_ringHead (0),
+      m_ringSize (0),
+      m_turnStarted (false),
+      m_virtualTime (0),
+      m_bufferPort (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    for (uint32_t i = 0;i < MAX_CLASSES;i++)
+    {
+        m_classes[i].bytes = 0;
+        m_classes[i].segments = 0;
+        m_classes[i].weight = 1;
+        m_classes[i].deficit = 0;
+        m_classes[i].lastFinish = 0;
+    }
+}
+
+DCMultiClassQueue::~DCMultiClassQueue ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCMultiClassQueue::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_buffer = 0;
+    Queue::DoDispose ();
+}
+
+void
+DCMultiClassQueue::SetMode (Queue::QueueMode mode)
+{
+    NS_LOG_FUNCTION (mode);
+    m_mode = mode;
+}
+
+Queue::QueueMode
+DCMultiClassQueue::GetMode (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    return m_mode;
+}
+
+void
+DCMultiClassQueue::SetWeights (std::string weights)
+{
+    NS_LOG_FUNCTION (weights);
+    std::string::size_type begin = 0;
+    for (uint32_t i = 0;i < MAX_CLASSES;i++)
+    {
+        m_classes[i].weight = 1;
+        if (begin >= weights.size ()) continue;
+
+        std::string::size_type end = weights.find (',', begin);
+        if (end == std::string::npos) end = weights.size ();
+        int w = std::atoi (weights.substr (begin, end - begin).c_str ());
+        NS_ASSERT_MSG (w > 0, "DCMultiClassQueue::SetWeights(): bad weight in " << weights);
+        m_classes[i].weight = w;
+        begin = end + 1;
+    }
+}
+
+uint32_t
+DCMultiClassQueue::GetNPackets (uint32_t cls) const
+{
+    NS_ASSERT (cls < MAX_CLASSES);
+    return m_classes[cls].packets.size ();
+}
+
+uint32_t
+DCMultiClassQueue::GetNBytes (uint32_t cls) const
+{
+    NS_ASSERT (cls < MAX_CLASSES);
+    return m_classes[cls].bytes;
+}
+
+void
+DCMultiClassQueue::SetSharedBuffer (Ptr<DCSwitchBuffer> buffer)
+{
+    NS_LOG_FUNCTION (this << buffer);
+    NS_ASSERT_MSG (!m_buffer, "DCMultiClassQueue::SetSharedBuffer(): shared buffer already set!");
+    NS_ASSERT_MSG (m_active == 0, "DCMultiClassQueue::SetSharedBuffer(): queue not empty!");
+    m_buffer = buffer;
+    m_bufferPort = buffer->AddPort (m_nClasses);
+}
+
+Ptr<DCSwitchBuffer>
+DCMultiClassQueue::GetSharedBuffer (void) const
+{
+    return m_buffer;
+}
+
+uint32_t
+DCMultiClassQueue::GetClass (Ptr<const Packet> p) const
+{
+    uint32_t cls = m_defaultClass;
+    DCClassTag tag;
+    if (p->PeekPacketTag (tag))
+        cls = tag.GetClass ();
+    return cls < m_nClasses ? cls : m_nClasses - 1;
+}
+
+bool
+DCMultiClassQueue::DoEnqueue (Ptr<Packet> p)
+{
+    NS_LOG_FUNCTION (this << p);
+
+    uint32_t cls = GetClass (p);
+    Class &c = m_classes[cls];
+    uint32_t segments = DCGsoTag::CountSegments (p);
+
+    if (m_buffer)
+    {
+        if (!m_buffer->Admit (m_bufferPort, cls, p->GetSize ()))
+        {
+            NS_LOG_LOGIC ("Class " << cls << " over the shared buffer threshold -- droppping pkt");
+            Drop (p);
+            return false;
+        }
+    }
+    else if (m_mode == QUEUE_MODE_PACKETS && (c.segments + segments > m_maxPackets))
+    {
+        NS_LOG_LOGIC ("Class " << cls << " full (at max packets) -- droppping pkt");
+        Drop (p);
+        return false;
+    }
+    else if (m_mode == QUEUE_MODE_BYTES && (c.bytes + p->GetSize () >= m_maxBytes))
+    {
+        NS_LOG_LOGIC ("Class " << cls << " full (packet would exceed max bytes) -- droppping pkt");
+        Drop (p);
+        return false;
+    }
+
+    if (c.packets.empty ())
+    {
+        m_active |= (1u << cls);
+        if (m_scheduler == DRR)
+        {
+            NS_ASSERT (m_ringSize < MAX_CLASSES);
+            m_ring[(m_ringHead + m_ringSize) % MAX_CLASSES] = cls;
+            m_ringSize++;
+        }
+    }
+
+    if (m_scheduler == WFQ)
+    {
+        double start = c.lastFinish > m_virtualTime ? c.lastFinish : m_virtualTime;
+        c.lastFinish = start + (double)p->GetSize () / c.weight;
+        c.finish.push_back (c.lastFinish);
+    }
+
+    c.bytes += p->GetSize ();
+    c.segments += segments;
+    c.packets.push_back (p);
+
+    NS_LOG_LOGIC ("Class " << cls << " packets " << c.packets.size () << " bytes " << c.bytes);
+
+    return true;
+}
+
+Ptr<Packet>
+DCMultiClassQueue::Pop (uint32_t cls)
+{
+    Class &c = m_classes[cls];
+    Ptr<Packet> p = c.packets.front ();
+    c.packets.pop_front ();
+    c.bytes -= p->GetSize ();
+    c.segments -= DCGsoTag::CountSegments (p);
+    if (m_buffer)
+        m_buffer->Release (m_bufferPort, cls, p->GetSize ());
+    if (m_scheduler == WFQ)
+    {
+        m_virtualTime = c.finish.front ();
+        c.finish.pop_front ();
+    }
+    if (c.packets.empty ())
+        m_active &= ~(1u << cls);
+
+    NS_LOG_LOGIC ("Popped " << p << " from class " << cls);
+    return p;
+}
+
+uint32_t
+DCMultiClassQueue::SelectWfq (void) const
+{
+    uint32_t best = MAX_CLASSES;
+    for (uint32_t bits = m_active;bits != 0;bits &= bits - 1)
+    {
+        uint32_t cls = __builtin_ctz (bits);
+        if (best == MAX_CLASSES
+                || m_classes[cls].finish.front () < m_classes[best].finish.front ())
+            best = cls;
+    }
+    return best;
+}
+
+Ptr<Packet>
+DCMultiClassQueue::DoDequeue (void)
+{
+    NS_LOG_FUNCTION (this);
+
+    if (m_active == 0)
+    {
+        NS_LOG_LOGIC ("Queue empty");
+        return 0;
+    }
+
+    Ptr<Packet> p;
+    switch (m_scheduler)
+    {
+    case SP:
+        p = Pop (__builtin_ctz (m_active));
+        break;
+
+    case DRR:
+        while (true)
+        {
+            uint32_t cls = m_ring[m_ringHead];
+            Class &c = m_classes[cls];
+            if (!m_turnStarted)
+            {
+                c.deficit += m_quantum * c.weight;
+                m_turnStarted = true;
+            }
+            uint32_t size = c.packets.front ()->GetSize ();
+            if (size <= c.deficit)
+            {
+                c.deficit -= size;
+                p = Pop (cls);
+                if (c.packets.empty ())
+                {
+                    c.deficit = 0;
+                    m_ringHead = (m_ringHead + 1) % MAX_CLASSES;
+                    m_ringSize--;
+                    m_turnStarted = false;
+                }
+                break;
+            }
+            // the turn of this class is over, move it to the tail
+            m_ring[(m_ringHead + m_ringSize) % MAX_CLASSES] = cls;
+            m_ringHead = (m_ringHead + 1) % MAX_CLASSES;
+            m_turnStarted = false;
+        }
+        break;
+
+    case WFQ:
+        p = Pop (SelectWfq ());
+        if (m_active == 0)
+        {
+            // idle, restart the virtual clock
+            m_virtualTime = 0;
+            for (uint32_t i = 0;i < MAX_CLASSES;i++)
+                m_classes[i].lastFinish = 0;
+        }
+        break;
+    }
+
+    return p;
+}
+
+Ptr<const Packet>
+DCMultiClassQueue::DoPeek (void) const
+{
+    NS_LOG_FUNCTION (this);
+
+    if (m_active == 0)
+    {
+        NS_LOG_LOGIC ("Queue empty");
+        return 0;
+    }
+
+    switch (m_scheduler)
+    {
+    case SP:
+        return m_classes[__builtin_ctz (m_active)].packets.front ();
+
+    case DRR:
+        {
+            //
+            // The walk of DoDequeue on copies of the deficits, the ring
+            // itself only rotates so the k-th turn is at k % m_ringSize.
+            //
+            uint32_t deficit[MAX_CLASSES];
+            for (uint32_t i = 0;i < MAX_CLASSES;i++)
+                deficit[i] = m_classes[i].deficit;
+            bool turnStarted = m_turnStarted;
+            for (uint32_t k = 0;;k++)
+            {
+                uint32_t cls = m_ring[(m_ringHead + k % m_ringSize) % MAX_CLASSES];
+                const Class &c = m_classes[cls];
+                if (!turnStarted)
+                    deficit[cls] += m_quantum * c.weight;
+                if (c.packets.front ()->GetSize () <= deficit[cls])
+                    return c.packets.front ();
+                turnStarted = false;
+            }
+        }
+
+    case WFQ:
+        return m_classes[SelectWfq ()].packets.front ();
+    }
+    return 0;
+}
+
+} // namespace ns3
@@ -0,0 +1,136 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_MULTI_CLASS_QUEUE_H__
+#define __DC_MULTI_CLASS_QUEUE_H__
+
+#include <deque>
+#include <string>
+#include "ns3/packet.h"
+#include "ns3/queue.h"
+#include "dc-switch-buffer.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief An egress queue with up to 8 traffic classes.
+ *
+ * The class of a packet is read from its DCClassTag (see
+ * DCPacketClassifier), packets without the tag go to DefaultClass and
+ * classes beyond Classes go to the last class. Every class is a drop
+ * tail fifo limited by MaxPackets or MaxBytes.
+ *
+ * The classes are served by one of three schedulers:
+ *  - SP, strict priority, class 0 first. The non empty classes are kept
+ *    in a bitmap, so the next class is one count-trailing-zeros.
+ *  - DRR, deficit round robin, every turn a class may send Quantum times
+ *    its weight bytes. The non empty classes are kept in a ring. When
+ *    Quantum is at least the largest frame a dequeue looks at two classes
+ *    at most.
+ *  - WFQ, self clocked fair queueing. Every packet gets a finish tag at
+ *    enqueue and the class with the smallest head tag is served, which is
+ *    a scan of at most 8 classes.
+ * All of them are O(1) per dequeue.
+ *
+ * With a shared buffer (SetSharedBuffer) the admission of a packet is
+ * decided by the DCSwitchBuffer and the static MaxPackets and MaxBytes
+ * limits are not used.
+ */
+class DCMultiClassQueue : public Queue
+{
+public:
+    static TypeId GetTypeId (void);
+
+    enum Scheduler
+    {
+        SP,
+        DRR,
+        WFQ
+    };
+
+    static const uint32_t MAX_CLASSES = 8;
+
+    DCMultiClassQueue ();
+    virtual ~DCMultiClassQueue ();
+
+    void SetMode (Queue::QueueMode mode);
+    Queue::QueueMode GetMode (void);
+
+    /**
+     * \brief Set the class weights of DRR and WFQ.
+     * \param weights comma separated weights, e.g. "4,2,1". Classes not
+     *        listed get weight 1.
+     */
+    void SetWeights (std::string weights);
+
+    /**
+     * \return the number of packets queued in class cls
+     */
+    uint32_t GetNPackets (uint32_t cls) const;
+
+    /**
+     * \return the number of bytes queued in class cls
+     */
+    uint32_t GetNBytes (uint32_t cls) const;
+
+    /**
+     * \brief Draw the memory of this queue from a switch buffer.
+     *
+     * The queue joins the buffer as a new port, so it should be called
+     * once, before any packet is queued.
+     */
+    void SetSharedBuffer (Ptr<DCSwitchBuffer> buffer);
+    Ptr<DCSwitchBuffer> GetSharedBuffer (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    virtual bool DoEnqueue (Ptr<Packet> p);
+    virtual Ptr<Packet> DoDequeue (void);
+    virtual Ptr<const Packet> DoPeek (void) const;
+
+    uint32_t GetClass (Ptr<const Packet> p) const;
+    uint32_t SelectWfq (void) const;
+    Ptr<Packet> Pop (uint32_t cls);
+
+    struct Class
+    {
+        std::deque<Ptr<Packet> > packets;
+        std::deque<double> finish;  // WFQ finish tags of the packets
+        uint32_t bytes;
+        uint32_t segments;          // wire segments, see DCGsoTag
+        uint32_t weight;
+        uint32_t deficit;           // DRR
+        double lastFinish;          // WFQ
+    };
+
+    Class m_classes[MAX_CLASSES];
+    uint32_t m_nClasses;
+    uint32_t m_defaultClass;
+    Scheduler m_scheduler;
+
+    uint32_t m_maxPackets;
+    uint32_t m_maxBytes;
+    QueueMode m_mode;
+
+    // bitmap of the non empty classes
+    uint32_t m_active;
+
+    // DRR
+    uint32_t m_quantum;
+    uint32_t m_ring[MAX_CLASSES];
+    uint32_t m_ringHead;
+    uint32_t m_ringSize;
+    bool m_turnStarted;
+
+    // WFQ virtual time, the finish tag of the last packet served
+    double m_virtualTime;
+
+    Ptr<DCSwitchBuffer> m_buffer;
+    uint32_t m_bufferPort;
+};
+
+} // namespace ns3
+
+#endif /* __DC_MULTI_CLASS_QUEUE_H__ */
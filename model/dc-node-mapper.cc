@@ -33,6 +33,8 @@ private:
 
     // map cache
     std::map<Ptr<Node>,Ptr<DCNode> > m_nodes;
+    // the DCNodeList entries already in the cache
+    uint32_t m_nMapped;
 };
 
 NS_OBJECT_ENSURE_REGISTERED (DCNodeMapperPriv);
@@ -55,14 +57,20 @@ DCNodeMapperPriv::Get (Ptr<Node> node)
 
     Ptr<DCNodeMapperPriv> cache = *DoGet();
 
-    // maybe new node added, fresh.
+    std::map<Ptr<Node>,Ptr<DCNode> >::iterator i = cache->m_nodes.find(node);
+    if (i != cache->m_nodes.end()) return i->second;
+
+    // maybe new node added, add the new ones only.
     // DCNodeList doesn't support delete,
     // so we don't consider it either.
-    if (cache->m_nodes.find(node) == cache->m_nodes.end())
-        cache->Build(); 
-    if (cache->m_nodes.find(node) == cache->m_nodes.end())
+    // A node not in DCNodeList costs no rebuild.
+    if (cache->m_nMapped == DCNodeList::GetNDCNodes())
+        return NULL;
+    cache->Build();
+    i = cache->m_nodes.find(node);
+    if (i == cache->m_nodes.end())
         return NULL;
-    return cache->m_nodes[node];
+    return i->second;
 }
 
 Ptr<DCNodeMapperPriv>*
@@ -88,6 +96,7 @@ DCNodeMapperPriv::Delete (void)
 }
 
 DCNodeMapperPriv::DCNodeMapperPriv ()
+    : m_nMapped (0)
 {
     NS_LOG_FUNCTION_NOARGS ();
 }
@@ -107,6 +116,7 @@ DCNodeMapperPriv::DoDispose (void)
         node->Dispose ();
     }
     m_nodes.clear ();
+    m_nMapped = 0;
     Object::DoDispose ();
 }
 
@@ -114,12 +124,11 @@ void
 DCNodeMapperPriv::Build (void)
 {
     NS_LOG_FUNCTION_NOARGS ();
-    m_nodes.clear();
-
-    for (DCNodeList::Iterator iter = DCNodeList::Begin();
-         iter != DCNodeList::End(); iter++)
+    uint32_t n = DCNodeList::GetNDCNodes();
+    for (;m_nMapped < n;m_nMapped++)
     {
-        m_nodes[(*iter)->GetOriginalNode()] = *iter;
+        Ptr<DCNode> dcNode = DCNodeList::GetDCNode(m_nMapped);
+        m_nodes[dcNode->GetOriginalNode()] = dcNode;
     }
 }
 
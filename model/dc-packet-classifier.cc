@@ -0,0 +1,259 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstdlib>
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/string.h"
+#include "ns3/ipv4-header.h"
+#include "dc-vm.h"
+#include "dc-tenant.h"
+#include "dc-tenant-list.h"
+#include "dc-packet-classifier.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCPacketClassifier");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCClassTag);
+
+TypeId
+DCClassTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCClassTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCClassTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCClassTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCClassTag::DCClassTag ()
+    : m_class (0)
+{
+}
+
+DCClassTag::DCClassTag (uint8_t cls)
+    : m_class (cls)
+{
+}
+
+void
+DCClassTag::SetClass (uint8_t cls)
+{
+    m_class = cls;
+}
+
+uint8_t
+DCClassTag::GetClass (void) const
+{
+    return m_class;
+}
+
+uint32_t
+DCClassTag::GetSerializedSize (void) const
+{
+    return 1;
+}
+
+void
+DCClassTag::Serialize (TagBuffer i) const
+{
+    i.WriteU8 (m_class);
+}
+
+void
+DCClassTag::Deserialize (TagBuffer i)
+{
+    m_class = i.ReadU8 ();
+}
+
+void
+DCClassTag::Print (std::ostream &os) const
+{
+    os << "class=" << (uint32_t)m_class;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCPacketClassifier);
+
+TypeId
+DCPacketClassifier::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCPacketClassifier")
+        .SetParent<Object> ()
+        .AddAttribute ("DefaultClass",
+                       "The class of packets not matched by the classifier.",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCPacketClassifier::m_defaultClass),
+                       MakeUintegerChecker<uint8_t> (0, 7))
+    ;
+    return tid;
+}
+
+DCPacketClassifier::DCPacketClassifier ()
+    : m_defaultClass (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+std::map<std::string,uint8_t>
+DCPacketClassifier::ParseMap (std::string s)
+{
+    std::map<std::string,uint8_t> result;
+    std::string::size_type begin = 0;
+    while (begin < s.size ())
+    {
+        std::string::size_type end = s.find (',', begin);
+        if (end == std::string::npos) end = s.size ();
+        std::string item = s.substr (begin, end - begin);
+        begin = end + 1;
+        if (item.empty ()) continue;
+
+        std::string::size_type colon = item.rfind (':');
+        NS_ASSERT_MSG (colon != std::string::npos && colon + 1 < item.size (),
+                       "DCPacketClassifier::ParseMap(): bad item " << item);
+        int cls = std::atoi (item.substr (colon + 1).c_str ());
+        NS_ASSERT_MSG (cls >= 0 && cls < 8,
+                       "DCPacketClassifier::ParseMap(): class out of range in " << item);
+        result[item.substr (0, colon)] = (uint8_t)cls;
+    }
+    return result;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCDscpClassifier);
+
+TypeId
+DCDscpClassifier::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCDscpClassifier")
+        .SetParent<DCPacketClassifier> ()
+        .AddConstructor<DCDscpClassifier> ()
+        .AddAttribute ("Map",
+                       "Comma separated dscp:class list, e.g. \"46:0,26:1\". "
+                       "Unlisted dscp values get DefaultClass. "
+                       "When empty the class is 7 minus the dscp precedence.",
+                       StringValue (""),
+                       MakeStringAccessor (&DCDscpClassifier::SetMap),
+                       MakeStringChecker ())
+    ;
+    return tid;
+}
+
+DCDscpClassifier::DCDscpClassifier ()
+    : m_useMap (false)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    for (uint32_t i = 0;i < 64;i++)
+        m_map[i] = 0xff;
+}
+
+void
+DCDscpClassifier::SetMap (std::string map)
+{
+    NS_LOG_FUNCTION (map);
+    std::map<std::string,uint8_t> m = ParseMap (map);
+    m_useMap = !m.empty ();
+    for (uint32_t i = 0;i < 64;i++)
+        m_map[i] = 0xff;
+    for (std::map<std::string,uint8_t>::iterator it = m.begin ();it != m.end ();it++)
+    {
+        int dscp = std::atoi (it->first.c_str ());
+        NS_ASSERT_MSG (dscp >= 0 && dscp < 64,
+                       "DCDscpClassifier::SetMap(): dscp out of range " << it->first);
+        m_map[dscp] = it->second;
+    }
+}
+
+uint8_t
+DCDscpClassifier::Classify (Ptr<const Packet> packet,
+        const Mac48Address& src,
+        const Mac48Address& dst,
+        uint16_t protocolNumber)
+{
+    if (protocolNumber != 0x0800)
+        return m_defaultClass;
+
+    Ipv4Header header;
+    if (packet->PeekHeader (header) == 0)
+        return m_defaultClass;
+
+    uint8_t dscp = header.GetTos () >> 2;
+    if (!m_useMap)
+        return 7 - (dscp >> 3);
+    return m_map[dscp] == 0xff ? m_defaultClass : m_map[dscp];
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCTenantClassifier);
+
+TypeId
+DCTenantClassifier::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCTenantClassifier")
+        .SetParent<DCPacketClassifier> ()
+        .AddConstructor<DCTenantClassifier> ()
+        .AddAttribute ("Map",
+                       "Comma separated tenant:class list, e.g. \"web:0,batch:3\". "
+                       "Unlisted tenants get DefaultClass.",
+                       StringValue (""),
+                       MakeStringAccessor (&DCTenantClassifier::SetMap),
+                       MakeStringChecker ())
+    ;
+    return tid;
+}
+
+DCTenantClassifier::DCTenantClassifier ()
+    : m_nTenants (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCTenantClassifier::SetMap (std::string map)
+{
+    NS_LOG_FUNCTION (map);
+    m_tenantClass = ParseMap (map);
+    m_cache.clear ();
+    m_nTenants = 0;
+}
+
+void
+DCTenantClassifier::Build (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_cache.clear ();
+    m_nTenants = DCTenantList::GetNDCTenants ();
+    for (DCTenantList::Iterator it = DCTenantList::Begin ();it != DCTenantList::End ();it++)
+    {
+        std::map<std::string,uint8_t>::iterator cls = m_tenantClass.find ((*it)->GetName ());
+        if (cls == m_tenantClass.end ()) continue;
+        for (uint32_t i = 0;i < (*it)->GetN ();i++)
+        {
+            Mac48Address addr = Mac48Address::ConvertFrom ((*it)->GetVm (i)->GetPointNetDeviceAddress ());
+            m_cache[addr] = cls->second;
+        }
+    }
+}
+
+uint8_t
+DCTenantClassifier::Classify (Ptr<const Packet> packet,
+        const Mac48Address& src,
+        const Mac48Address& dst,
+        uint16_t protocolNumber)
+{
+    if (m_nTenants != DCTenantList::GetNDCTenants ())
+        Build ();
+
+    std::map<Mac48Address,uint8_t>::iterator it = m_cache.find (src);
+    if (it == m_cache.end ())
+    {
+        // remember the miss, so unknown sources are looked up only once
+        m_cache[src] = m_defaultClass;
+        return m_defaultClass;
+    }
+    return it->second;
+}
+
+} // namespace ns3
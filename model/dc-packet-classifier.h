@@ -0,0 +1,135 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_PACKET_CLASSIFIER_H__
+#define __DC_PACKET_CLASSIFIER_H__
+
+#include <map>
+#include <string>
+#include "ns3/object.h"
+#include "ns3/tag.h"
+#include "ns3/packet.h"
+#include "ns3/mac48-address.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The traffic class of a packet.
+ *
+ * Set by the DCPacketClassifier of the sending device and read by class
+ * aware queues (DCMultiClassQueue). Being a packet tag it travels with
+ * the packet, so a class given at the edge is kept by ports without a
+ * classifier.
+ */
+class DCClassTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCClassTag ();
+    DCClassTag (uint8_t cls);
+
+    void SetClass (uint8_t cls);
+    uint8_t GetClass (void) const;
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    uint8_t m_class;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Map a packet to a traffic class before it is enqueued.
+ *
+ * DCCsmaNetDevice calls Classify in SendFrom, before the ethernet
+ * header is added, and stores the result in a DCClassTag.
+ */
+class DCPacketClassifier : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+    DCPacketClassifier ();
+    virtual ~DCPacketClassifier () {}
+
+    virtual uint8_t Classify (Ptr<const Packet> packet,
+            const Mac48Address& src,
+            const Mac48Address& dst,
+            uint16_t protocolNumber) = 0;
+
+protected:
+    /**
+     * \brief Parse a "key:class,key:class" list.
+     */
+    static std::map<std::string,uint8_t> ParseMap (std::string s);
+
+    uint8_t m_defaultClass;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Classify ipv4 packets by the DSCP field.
+ *
+ * Without an explicit Map the class is 7 minus the precedence (the
+ * three high bits of DSCP), so network control goes to class 0 and best
+ * effort to class 7. Non ipv4 packets get DefaultClass.
+ */
+class DCDscpClassifier : public DCPacketClassifier
+{
+public:
+    static TypeId GetTypeId (void);
+    DCDscpClassifier ();
+    virtual ~DCDscpClassifier () {}
+
+    virtual uint8_t Classify (Ptr<const Packet> packet,
+            const Mac48Address& src,
+            const Mac48Address& dst,
+            uint16_t protocolNumber);
+
+    void SetMap (std::string map);
+
+private:
+    bool m_useMap;
+    uint8_t m_map[64];
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Classify packets by the tenant of the source vm.
+ *
+ * The tenant of a vm is found through DCTenantList, the source mac
+ * to class table is built on the first packet and rebuilt when tenants
+ * are added. Tenants missing in Map get DefaultClass.
+ */
+class DCTenantClassifier : public DCPacketClassifier
+{
+public:
+    static TypeId GetTypeId (void);
+    DCTenantClassifier ();
+    virtual ~DCTenantClassifier () {}
+
+    virtual uint8_t Classify (Ptr<const Packet> packet,
+            const Mac48Address& src,
+            const Mac48Address& dst,
+            uint16_t protocolNumber);
+
+    void SetMap (std::string map);
+
+private:
+    void Build (void);
+
+    std::map<std::string,uint8_t> m_tenantClass;
+    std::map<Mac48Address,uint8_t> m_cache;
+    uint32_t m_nTenants;
+};
+
+} // namespace ns3
+
+#endif /* __DC_PACKET_CLASSIFIER_H__ */
@@ -0,0 +1,357 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstring>
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/boolean.h"
+#include "ns3/simulator.h"
+#include "ns3/mac48-address.h"
+#include "dc-node.h"
+#include "dc-node-mapper.h"
+#include "dc-point-net-device.h"
+#include "dc-capture-filter.h"
+#include "dc-pcapng-writer.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCPcapngWriter");
+
+namespace ns3 {
+
+// block types and options of pcapng
+static const uint32_t PCAPNG_SHB = 0x0A0D0D0A;
+static const uint32_t PCAPNG_IDB = 0x00000001;
+static const uint32_t PCAPNG_EPB = 0x00000006;
+static const uint32_t PCAPNG_BYTE_ORDER = 0x1A2B3C4D;
+static const uint16_t OPT_ENDOFOPT = 0;
+static const uint16_t OPT_COMMENT = 1;
+static const uint16_t IF_NAME = 2;
+static const uint16_t IF_DESCRIPTION = 3;
+static const uint16_t IF_MACADDR = 6;
+static const uint16_t IF_TSRESOL = 9;
+
+NS_OBJECT_ENSURE_REGISTERED (DCPcapngWriter);
+
+TypeId
+DCPcapngWriter::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCPcapngWriter")
+        .SetParent<Object> ()
+        .AddConstructor<DCPcapngWriter> ()
+        .AddAttribute ("Shards",
+                       "The number of files, a device goes to the file of its node id modulo Shards.",
+                       UintegerValue (1),
+                       MakeUintegerAccessor (&DCPcapngWriter::m_nShards),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("BufferSize",
+                       "The bytes kept in memory for every shard before writing them to the file.",
+                       UintegerValue (4 * 1024 * 1024),
+                       MakeUintegerAccessor (&DCPcapngWriter::m_bufferSize),
+                       MakeUintegerChecker<uint32_t> (65536))
+        .AddAttribute ("SnapLen",
+                       "The bytes captured of every packet.",
+                       UintegerValue (65535),
+                       MakeUintegerAccessor (&DCPcapngWriter::m_snapLen),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("Async",
+                       "Write the shards through DCAsyncWriters.",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&DCPcapngWriter::m_isAsync),
+                       MakeBooleanChecker ())
+    ;
+    return tid;
+}
+
+DCPcapngWriter::DCPcapngWriter ()
+    : m_nShards (1),
+      m_bufferSize (0),
+      m_snapLen (65535),
+      m_isAsync (false),
+      m_nInterfaces (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCPcapngWriter::~DCPcapngWriter ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Close ();
+}
+
+void
+DCPcapngWriter::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Close ();
+    m_filter = 0;
+    Object::DoDispose ();
+}
+
+void
+DCPcapngWriter::PutU32 (std::vector<uint8_t> &b, uint32_t v)
+{
+    uint8_t *p = (uint8_t *)&v;
+    b.insert (b.end (), p, p + 4);
+}
+
+void
+DCPcapngWriter::PutOption (std::vector<uint8_t> &b, uint16_t code, const void *data, uint16_t len)
+{
+    uint16_t h[2] = { code, len };
+    uint8_t *p = (uint8_t *)h;
+    b.insert (b.end (), p, p + 4);
+    p = (uint8_t *)data;
+    b.insert (b.end (), p, p + len);
+    b.resize (b.size () + ((4 - len % 4) % 4), 0);
+}
+
+void
+DCPcapngWriter::Open (std::string prefix)
+{
+    NS_LOG_FUNCTION (this << prefix);
+    NS_ASSERT_MSG (m_shards.empty (), "DCPcapngWriter::Open(): already open!");
+
+    // section header, the same for all shards
+    std::vector<uint8_t> shb;
+    PutU32 (shb, PCAPNG_SHB);
+    PutU32 (shb, 0);
+    PutU32 (shb, PCAPNG_BYTE_ORDER);
+    uint16_t version[2] = { 1, 0 };
+    shb.insert (shb.end (), (uint8_t *)version, (uint8_t *)version + 4);
+    PutU32 (shb, 0xffffffff);   // section length unknown
+    PutU32 (shb, 0xffffffff);
+    std::string comment = "ns-3 datacenter";
+    PutOption (shb, OPT_COMMENT, comment.data (), comment.size ());
+    PutOption (shb, OPT_ENDOFOPT, 0, 0);
+    PutU32 (shb, 0);
+    uint32_t len = shb.size ();
+    std::memcpy (&shb[4], &len, 4);
+    std::memcpy (&shb[len - 4], &len, 4);
+
+    m_shards.resize (m_nShards);
+    for (uint32_t i = 0;i < m_nShards;i++)
+    {
+        std::ostringstream oss;
+        oss << prefix;
+        if (m_nShards > 1) oss << "-" << i;
+        oss << ".pcapng";
+
+        Shard &s = m_shards[i];
+        s.file = 0;
+        s.used = 0;
+        s.nInterfaces = 0;
+        if (m_isAsync)
+        {
+            s.async = CreateObject<DCAsyncWriter> ();
+            s.async->Open (oss.str ());
+        }
+        else
+        {
+            s.file = std::fopen (oss.str ().c_str (), "wb");
+            NS_ABORT_MSG_UNLESS (s.file, "DCPcapngWriter::Open(): can't open " << oss.str ());
+            std::setvbuf (s.file, 0, _IONBF, 0);
+            s.buffer.resize (m_bufferSize);
+        }
+        Append (s, &shb[0], shb.size ());
+    }
+
+    Simulator::ScheduleDestroy (&DCPcapngWriter::Close, Ptr<DCPcapngWriter> (this));
+}
+
+void
+DCPcapngWriter::Append (Shard &s, const uint8_t *data, uint32_t size)
+{
+    if (s.async)
+    {
+        s.async->Write (data, size);
+        return;
+    }
+    if (!s.file) return;
+    if (s.used + size > s.buffer.size ())
+    {
+        FlushShard (s);
+        if (size > s.buffer.size ())
+        {
+            std::fwrite (data, 1, size, s.file);
+            return;
+        }
+    }
+    std::memcpy (&s.buffer[s.used], data, size);
+    s.used += size;
+}
+
+void
+DCPcapngWriter::FlushShard (Shard &s)
+{
+    if (!s.file || s.used == 0) return;
+    if (std::fwrite (&s.buffer[0], 1, s.used, s.file) != s.used)
+    {
+        NS_LOG_WARN ("DCPcapngWriter::FlushShard(): short write, packets lost");
+    }
+    s.used = 0;
+}
+
+void
+DCPcapngWriter::Flush (void)
+{
+    NS_LOG_FUNCTION (this);
+    for (uint32_t i = 0;i < m_shards.size ();i++)
+        FlushShard (m_shards[i]);
+}
+
+void
+DCPcapngWriter::Close (void)
+{
+    NS_LOG_FUNCTION (this);
+    for (uint32_t i = 0;i < m_shards.size ();i++)
+    {
+        Shard &s = m_shards[i];
+        if (s.async)
+        {
+            s.async->Close ();
+            s.async = 0;
+        }
+        if (s.file)
+        {
+            FlushShard (s);
+            std::fclose (s.file);
+            s.file = 0;
+        }
+    }
+    m_shards.clear ();
+}
+
+bool
+DCPcapngWriter::AddDevice (Ptr<NetDevice> nd, bool promiscuous)
+{
+    NS_LOG_FUNCTION (this << nd << promiscuous);
+    NS_ASSERT_MSG (!m_shards.empty (), "DCPcapngWriter::AddDevice(): not open!");
+    Ptr<DCCsmaNetDevice> device = nd->GetObject<DCCsmaNetDevice> ();
+    if (device == 0)
+    {
+        NS_LOG_INFO ("DCPcapngWriter::AddDevice(): Device " << nd << " not of type ns3::DCCsmaNetDevice");
+        return false;
+    }
+    // the capture holds real frames, even of a header free device
+    device->EnableCapture (m_filter);
+
+    Ptr<Node> node = nd->GetNode ();
+    uint32_t shard = node->GetId () % m_nShards;
+    Shard &s = m_shards[shard];
+
+    std::ostringstream name;
+    Ptr<DCNode> dcNode = DCNodeMapper::GetDCNode (node);
+    if (dcNode && !dcNode->GetName ().empty ())
+        name << dcNode->GetName ();
+    else
+        name << "node" << node->GetId ();
+    name << "/port" << nd->GetIfIndex ();
+    std::ostringstream desc;
+    desc << "node " << node->GetId () << " device " << nd->GetIfIndex ();
+
+    std::vector<uint8_t> idb;
+    PutU32 (idb, PCAPNG_IDB);
+    PutU32 (idb, 0);
+    uint16_t linkType[2] = { 1, 0 };    // LINKTYPE_ETHERNET
+    idb.insert (idb.end (), (uint8_t *)linkType, (uint8_t *)linkType + 4);
+    PutU32 (idb, m_snapLen);
+    PutOption (idb, IF_NAME, name.str ().data (), name.str ().size ());
+    PutOption (idb, IF_DESCRIPTION, desc.str ().data (), desc.str ().size ());
+    uint8_t mac[6];
+    Mac48Address::ConvertFrom (nd->GetAddress ()).CopyTo (mac);
+    PutOption (idb, IF_MACADDR, mac, 6);
+    uint8_t resol = 9;                  // nanoseconds
+    PutOption (idb, IF_TSRESOL, &resol, 1);
+    PutOption (idb, OPT_ENDOFOPT, 0, 0);
+    PutU32 (idb, 0);
+    uint32_t len = idb.size ();
+    std::memcpy (&idb[4], &len, 4);
+    std::memcpy (&idb[len - 4], &len, 4);
+    Append (s, &idb[0], idb.size ());
+
+    Ptr<DCPcapngProbe> probe = CreateObject<DCPcapngProbe> (this, shard, s.nInterfaces);
+    device->TraceConnectWithoutContext (promiscuous ? "PromiscSniffer" : "Sniffer",
+                                        MakeCallback (&DCPcapngProbe::Sniff, probe));
+    s.nInterfaces++;
+    m_nInterfaces++;
+    return true;
+}
+
+void
+DCPcapngWriter::WritePacket (uint32_t shard, uint32_t interface, Ptr<const Packet> p)
+{
+    if (shard >= m_shards.size ()) return;
+    if (m_filter && !m_filter->Match (p)) return;
+
+    uint32_t size = p->GetSize ();
+    uint32_t incl = size < m_snapLen ? size : m_snapLen;
+    uint32_t padded = (incl + 3) & ~3u;
+    uint32_t len = 32 + padded;
+    if (m_scratch.size () < len)
+        m_scratch.resize (len);
+
+    uint64_t ts = Simulator::Now ().GetNanoSeconds ();
+    uint32_t h[7];
+    h[0] = PCAPNG_EPB;
+    h[1] = len;
+    h[2] = interface;
+    h[3] = ts >> 32;
+    h[4] = ts & 0xffffffff;
+    h[5] = incl;
+    h[6] = size;
+    std::memcpy (&m_scratch[0], h, 28);
+    p->CopyData (&m_scratch[28], incl);
+    std::memset (&m_scratch[28 + incl], 0, padded - incl);
+    std::memcpy (&m_scratch[28 + padded], &len, 4);
+    Append (m_shards[shard], &m_scratch[0], len);
+}
+
+uint32_t
+DCPcapngWriter::GetNInterfaces (void) const
+{
+    return m_nInterfaces;
+}
+
+void
+DCPcapngWriter::SetFilter (Ptr<DCCaptureFilter> filter)
+{
+    m_filter = filter;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCPcapngProbe);
+
+TypeId
+DCPcapngProbe::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCPcapngProbe")
+        .SetParent<Object> ()
+        .AddConstructor<DCPcapngProbe> ()
+    ;
+    return tid;
+}
+
+DCPcapngProbe::DCPcapngProbe ()
+    : m_shard (0),
+      m_interface (0)
+{
+}
+
+DCPcapngProbe::DCPcapngProbe (Ptr<DCPcapngWriter> writer, uint32_t shard, uint32_t interface)
+    : m_writer (writer),
+      m_shard (shard),
+      m_interface (interface)
+{
+}
+
+void
+DCPcapngProbe::DoDispose (void)
+{
+    m_writer = 0;
+    Object::DoDispose ();
+}
+
+void
+DCPcapngProbe::Sniff (Ptr<const Packet> p)
+{
+    if (m_writer) m_writer->WritePacket (m_shard, m_interface, p);
+}
+
+} // namespace ns3
@@ -0,0 +1,122 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_PCAPNG_WRITER_H__
+#define __DC_PCAPNG_WRITER_H__
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/net-device.h"
+#include "dc-async-writer.h"
+
+namespace ns3 {
+
+class DCCaptureFilter;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Capture many net devices into one pcapng file, or a few shards.
+ *
+ * Every device added is an interface of the file, its interface
+ * description block carries the name of the DCNode and the port, the
+ * node and device ids and the MAC address. Packets are enhanced packet
+ * blocks with nanosecond timestamps.
+ *
+ * With Shards > 1 a device goes to the shard of its node id, the files
+ * are prefix-0.pcapng, prefix-1.pcapng, ... Every shard is written
+ * sequentially through a large buffer, or a DCAsyncWriter with Async, so
+ * thousands of devices need only a few open files.
+ */
+class DCPcapngWriter : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCPcapngWriter ();
+    virtual ~DCPcapngWriter ();
+
+    /**
+     * \brief Create the shard files and write their section headers.
+     */
+    void Open (std::string prefix);
+    void Close (void);
+    void Flush (void);
+
+    /**
+     * \brief Add an interface and connect its sniffer trace.
+     * \param promiscuous capture the PromiscSniffer trace instead of Sniffer
+     * \return false if the device is not a DCCsmaNetDevice
+     */
+    bool AddDevice (Ptr<NetDevice> nd, bool promiscuous);
+
+    /**
+     * \brief Write an enhanced packet block of an interface.
+     */
+    void WritePacket (uint32_t shard, uint32_t interface, Ptr<const Packet> p);
+
+    uint32_t GetNInterfaces (void) const;
+
+    /**
+     * \brief Write only the packets passing the filter. Set it before
+     * AddDevice, a header free device then only rebuilds the headers of
+     * the packets passing it, see DCCsmaNetDevice::EnableCapture.
+     */
+    void SetFilter (Ptr<DCCaptureFilter> filter);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    struct Shard
+    {
+        std::FILE *file;
+        Ptr<DCAsyncWriter> async;
+        std::vector<uint8_t> buffer;
+        uint32_t used;
+        uint32_t nInterfaces;
+    };
+
+    void Append (Shard &s, const uint8_t *data, uint32_t size);
+    void FlushShard (Shard &s);
+    static void PutOption (std::vector<uint8_t> &b, uint16_t code, const void *data, uint16_t len);
+    static void PutU32 (std::vector<uint8_t> &b, uint32_t v);
+
+    uint32_t m_nShards;
+    uint32_t m_bufferSize;
+    uint32_t m_snapLen;
+    bool m_isAsync;
+    std::vector<Shard> m_shards;
+    uint32_t m_nInterfaces;
+    std::vector<uint8_t> m_scratch;
+    Ptr<DCCaptureFilter> m_filter;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The sniffer trace sink of one interface of a DCPcapngWriter.
+ */
+class DCPcapngProbe : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCPcapngProbe ();
+    DCPcapngProbe (Ptr<DCPcapngWriter> writer, uint32_t shard, uint32_t interface);
+
+    void Sniff (Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    Ptr<DCPcapngWriter> m_writer;
+    uint32_t m_shard;
+    uint32_t m_interface;
+};
+
+} // namespace ns3
+
+#endif /* __DC_PCAPNG_WRITER_H__ */
@@ -29,6 +29,8 @@ DCPointCallback::Register(Ptr<DCCsmaNetDevice> dev)
             MakeCallback(&DCPointCallback::TxDrop,this));
     dev->SetRxDropCallback(
             MakeCallback(&DCPointCallback::RxDrop,this));
+    dev->SetRxSucessCallback(
+            MakeCallback(&DCPointCallback::RxSucess,this));
 }
 
 } // namespace ns3
@@ -25,6 +25,7 @@ protected:
     virtual void TxSentSucess (Ptr<const Packet>) {}
     virtual void TxDrop (Ptr<const Packet>) {}
     virtual void RxDrop (Ptr<const Packet>) {}      
+    virtual void RxSucess (Ptr<const Packet>) {}
 };
 
 } // namespace ns3
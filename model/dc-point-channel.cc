@@ -1,5 +1,7 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 #include "ns3/boolean.h"
+#include "ns3/abort.h"
+#include "dc-log.h"
 #include "dc-point-channel.h"
 #include "dc-point-net-device.h"
 #include "ns3/packet.h"
@@ -10,6 +12,70 @@ NS_LOG_COMPONENT_DEFINE ("DCCsmaChannel");
 
 namespace ns3 {
 
+NS_OBJECT_ENSURE_REGISTERED (DCCutThroughTag);
+
+TypeId
+DCCutThroughTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCCutThroughTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCCutThroughTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCCutThroughTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCCutThroughTag::DCCutThroughTag ()
+    : m_tail (0)
+{
+}
+
+DCCutThroughTag::DCCutThroughTag (Time tail)
+    : m_tail (tail.GetTimeStep ())
+{
+}
+
+void
+DCCutThroughTag::SetTail (Time tail)
+{
+    m_tail = tail.GetTimeStep ();
+}
+
+Time
+DCCutThroughTag::GetTail (void) const
+{
+    return TimeStep (m_tail);
+}
+
+uint32_t
+DCCutThroughTag::GetSerializedSize (void) const
+{
+    return 8;
+}
+
+void
+DCCutThroughTag::Serialize (TagBuffer i) const
+{
+    i.WriteU64 (m_tail);
+}
+
+void
+DCCutThroughTag::Deserialize (TagBuffer i)
+{
+    m_tail = i.ReadU64 ();
+}
+
+void
+DCCutThroughTag::Print (std::ostream &os) const
+{
+    os << "tail=" << m_tail;
+}
+
 NS_OBJECT_ENSURE_REGISTERED (DCCsmaChannel);
 
 TypeId
@@ -37,6 +103,9 @@ DCCsmaChannel::GetTypeId (void)
                        BooleanValue (false),
                        MakeBooleanAccessor (&DCCsmaChannel::m_sourceProp),
                        MakeBooleanChecker ())
+        .AddTraceSource ("TxEnd",
+                         "A device finished writing a frame on the channel: frame, device id",
+                         MakeTraceSourceAccessor (&DCCsmaChannel::m_txEndTrace))
 
         ;
     return tid;
@@ -44,23 +113,23 @@ DCCsmaChannel::GetTypeId (void)
 
 DCCsmaChannel::DCCsmaChannel ()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_currentSrc = 0;
     m_deviceList.clear ();
 }
 
 DCCsmaChannel::~DCCsmaChannel ()
 {
-    NS_LOG_FUNCTION (this);
+    DC_LOG_FUNCTION (this);
     m_deviceList.clear ();
 }
 
 uint32_t
 DCCsmaChannel::Attach (Ptr<NetDevice> device)
 {
-    NS_LOG_FUNCTION (this << device);
+    DC_LOG_FUNCTION (this << device);
     Ptr<DCCsmaNetDevice> dev = dynamic_cast<DCCsmaNetDevice*>(PeekPointer(device));
-    NS_ASSERT (dev != 0);
+    DC_ASSERT (dev != 0);
 
     DCCsmaDeviceRec rec (dev);
     m_deviceList.push_back (rec);
@@ -70,8 +139,8 @@ DCCsmaChannel::Attach (Ptr<NetDevice> device)
 bool
 DCCsmaChannel::Reattach (Ptr<DCCsmaNetDevice> device)
 {
-    NS_LOG_FUNCTION (this << device);
-    NS_ASSERT (device != 0);
+    DC_LOG_FUNCTION (this << device);
+    DC_ASSERT (device != 0);
 
     std::vector<DCCsmaDeviceRec>::iterator it;
     for (it = m_deviceList.begin (); it < m_deviceList.end ( ); it++)
@@ -95,7 +164,7 @@ DCCsmaChannel::Reattach (Ptr<DCCsmaNetDevice> device)
 bool
 DCCsmaChannel::Reattach (Ptr<NetDevice> device)
 {
-    NS_LOG_FUNCTION (this << device);
+    DC_LOG_FUNCTION (this << device);
     Ptr<DCCsmaNetDevice> dev = dynamic_cast<DCCsmaNetDevice*>(PeekPointer(device));
     if (!dev) return false;
 
@@ -105,7 +174,7 @@ DCCsmaChannel::Reattach (Ptr<NetDevice> device)
 bool
 DCCsmaChannel::Reattach (uint32_t deviceId)
 {
-    NS_LOG_FUNCTION (this << deviceId);
+    DC_LOG_FUNCTION (this << deviceId);
 
     if (deviceId < m_deviceList.size ())
     {
@@ -126,7 +195,7 @@ DCCsmaChannel::Reattach (uint32_t deviceId)
 bool
 DCCsmaChannel::Detach (uint32_t deviceId)
 {
-    NS_LOG_FUNCTION (this << deviceId);
+    DC_LOG_FUNCTION (this << deviceId);
 
     if (deviceId < m_deviceList.size ())
     {
@@ -155,8 +224,8 @@ DCCsmaChannel::Detach (uint32_t deviceId)
 bool
 DCCsmaChannel::Detach (Ptr<NetDevice> device)
 {
-    NS_LOG_FUNCTION (this << device);
-    NS_ASSERT (device != 0);
+    DC_LOG_FUNCTION (this << device);
+    DC_ASSERT (device != 0);
 
     std::vector<DCCsmaDeviceRec>::iterator it;
     for (it = m_deviceList.begin (); it < m_deviceList.end (); it++) 
@@ -173,8 +242,8 @@ DCCsmaChannel::Detach (Ptr<NetDevice> device)
 bool
 DCCsmaChannel::TransmitStart (Ptr<Packet> p, uint32_t srcId)
 {
-    NS_LOG_FUNCTION (this << p << srcId);
-    NS_LOG_INFO ("UID is " << p->GetUid () << ")");
+    DC_LOG_FUNCTION (this << p << srcId);
+    DC_LOG_INFO ("UID is " << p->GetUid () << ")");
 
     if ( (m_fullDuplex && m_deviceList[srcId].state != IDLE)
          || ((!m_fullDuplex) && m_deviceList[m_currentSrc].state != IDLE))
@@ -189,15 +258,48 @@ DCCsmaChannel::TransmitStart (Ptr<Packet> p, uint32_t srcId)
         return false;
     }
 
-    NS_LOG_LOGIC ("switch to TRANSMITTING");
+    DC_LOG_LOGIC ("switch to TRANSMITTING");
     m_currentSrc = srcId;
     
     // zhengpf
     m_deviceList[srcId].state = TRANSMITTING;
     m_deviceList[srcId].currentPkt = p;
+
+    //
+    // Cut-through receivers get the frame once its first bytes have
+    // arrived, the tag tells them when the tail will arrive.
+    //
+    Time tail = Simulator::Now () + Seconds (m_bps.CalculateTxTime (DCL2MetaTag::GetFrameSize (p))) + m_delay;
+    for (uint32_t devId = 0; devId < m_deviceList.size (); devId++)
+    {
+        if (devId == srcId || !m_deviceList[devId].IsActive () || !IsCutThrough (devId, p))
+            continue;
+        DeliverHead (devId, srcId, p, tail);
+    }
     return true;
 }
 
+void
+DCCsmaChannel::DeliverHead (uint32_t deviceId, uint32_t srcId, Ptr<Packet> p, Time tail)
+{
+    Ptr<DCCsmaNetDevice> dev = m_deviceList[deviceId].devicePtr;
+    Ptr<Packet> copy = p->Copy ();
+    DCCutThroughTag tag;
+    copy->RemovePacketTag (tag);
+    copy->AddPacketTag (DCCutThroughTag (tail));
+    Time head = Seconds (m_bps.CalculateTxTime (dev->GetCutThroughBytes ())) + m_delay;
+    Simulator::ScheduleWithContext (dev->GetNode ()->GetId (), head,
+                                    &DCCsmaNetDevice::Receive, dev,
+                                    copy, m_deviceList[srcId].devicePtr);
+}
+
+bool
+DCCsmaChannel::IsCutThrough (uint32_t deviceId, Ptr<const Packet> p) const
+{
+    uint32_t bytes = m_deviceList[deviceId].devicePtr->GetCutThroughBytes ();
+    return bytes > 0 && bytes < DCL2MetaTag::GetFrameSize (p);
+}
+
 bool
 DCCsmaChannel::IsActive (uint32_t deviceId)
 {
@@ -215,10 +317,10 @@ DCCsmaChannel::TransmitEnd (uint32_t deviceId)
         return false;
     }
 
-    NS_LOG_FUNCTION (this << m_deviceList[deviceId].currentPkt << deviceId);
-    NS_LOG_INFO ("UID is " << m_deviceList[deviceId].currentPkt->GetUid () << ")");
+    DC_LOG_FUNCTION (this << m_deviceList[deviceId].currentPkt << deviceId);
+    DC_LOG_INFO ("UID is " << m_deviceList[deviceId].currentPkt->GetUid () << ")");
 
-    NS_ASSERT (m_deviceList[deviceId].state == TRANSMITTING);
+    DC_ASSERT (m_deviceList[deviceId].state == TRANSMITTING);
 
     bool retVal = true;
 
@@ -228,15 +330,18 @@ DCCsmaChannel::TransmitEnd (uint32_t deviceId)
         retVal = false;
     }
 
-    NS_LOG_LOGIC ("Schedule event in " << m_delay.GetSeconds () << " sec");
+    m_txEndTrace (m_deviceList[deviceId].currentPkt, deviceId);
+
+    DC_LOG_LOGIC ("Schedule event in " << m_delay.GetSeconds () << " sec");
 
-    NS_LOG_LOGIC ("Receive");
+    DC_LOG_LOGIC ("Receive");
 
     std::vector<DCCsmaDeviceRec>::iterator it;
     uint32_t devId = 0;
     for (it = m_deviceList.begin (); it < m_deviceList.end (); it++)
     {
-      if (it->IsActive () && devId != deviceId)
+      if (it->IsActive () && devId != deviceId
+          && !IsCutThrough (devId, m_deviceList[deviceId].currentPkt))
         {
             // schedule reception events
             Simulator::ScheduleWithContext (it->devicePtr->GetNode ()->GetId (),
@@ -265,10 +370,10 @@ DCCsmaChannel::TransmitEnd (uint32_t deviceId)
 void
 DCCsmaChannel::PropagationCompleteEvent (uint32_t deviceId)
 {
-    NS_LOG_FUNCTION (this << m_deviceList[deviceId].currentPkt);
-    NS_LOG_INFO ("UID is " << m_deviceList[deviceId].currentPkt->GetUid () << ")");
+    DC_LOG_FUNCTION (this << m_deviceList[deviceId].currentPkt);
+    DC_LOG_INFO ("UID is " << m_deviceList[deviceId].currentPkt->GetUid () << ")");
 
-    NS_ASSERT (m_deviceList[deviceId].state == PROPAGATING);
+    DC_ASSERT (m_deviceList[deviceId].state == PROPAGATING);
     m_deviceList[deviceId].state = IDLE;
 }
 
@@ -373,6 +478,225 @@ DCCsmaChannel::GetDevice (uint32_t i) const
     return GetDCCsmaDevice (i);
 }
 
+NS_OBJECT_ENSURE_REGISTERED (DCCsmaP2PChannel);
+
+TypeId
+DCCsmaP2PChannel::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCCsmaP2PChannel")
+        .SetParent<DCCsmaChannel> ()
+        .AddConstructor<DCCsmaP2PChannel> ()
+    ;
+    return tid;
+}
+
+DCCsmaP2PChannel::DCCsmaP2PChannel ()
+{
+    DC_LOG_FUNCTION_NOARGS ();
+}
+
+DCCsmaP2PChannel::~DCCsmaP2PChannel ()
+{
+    DC_LOG_FUNCTION (this);
+}
+
+Ptr<DCPointChannelBase>
+DCCsmaP2PChannel::CreateLink (ObjectFactory factory)
+{
+    Ptr<DCPointChannelBase> chnl = factory.Create<DCPointChannelBase> ();
+    if (DynamicCast<DCCsmaP2PChannel> (chnl) != 0 && !chnl->FullDuplex ())
+    {
+        NS_LOG_WARN ("DCCsmaP2PChannel::CreateLink(): a half duplex link is a DCCsmaChannel");
+        factory.SetTypeId (DCCsmaChannel::GetTypeId ());
+        chnl = factory.Create<DCPointChannelBase> ();
+    }
+    return chnl;
+}
+
+void
+DCCsmaP2PChannel::DoDispose (void)
+{
+    m_peer[0] = 0;
+    m_peer[1] = 0;
+    DCCsmaChannel::DoDispose ();
+}
+
+uint32_t
+DCCsmaP2PChannel::Attach (Ptr<NetDevice> device)
+{
+    DC_LOG_FUNCTION (this << device);
+    NS_ABORT_MSG_IF (m_deviceList.size () >= 2, "DCCsmaP2PChannel::Attach(): a point to point channel has two devices");
+    NS_ABORT_MSG_UNLESS (m_fullDuplex, "DCCsmaP2PChannel::Attach(): a point to point channel must be full duplex");
+
+    uint32_t id = DCCsmaChannel::Attach (device);
+    if (id == 1)
+    {
+        m_peer[0] = m_deviceList[1].devicePtr;
+        m_peer[1] = m_deviceList[0].devicePtr;
+    }
+    return id;
+}
+
+bool
+DCCsmaP2PChannel::TransmitStart (Ptr<Packet> p, uint32_t srcId)
+{
+    DC_LOG_FUNCTION (this << p << srcId);
+
+    DCCsmaDeviceRec &src = m_deviceList[srcId];
+    if (src.state != IDLE)
+    {
+        NS_LOG_WARN ("DCCsmaP2PChannel::TransmitStart(): State is not IDLE");
+        return false;
+    }
+    if (!src.active)
+    {
+        NS_LOG_ERROR ("DCCsmaP2PChannel::TransmitStart(): Seclected source is not currently attached to network");
+        return false;
+    }
+
+    m_currentSrc = srcId;
+    src.state = TRANSMITTING;
+    src.currentPkt = p;
+
+    uint32_t peerId = 1 - srcId;
+    if (m_peer[srcId] && m_deviceList[peerId].active && IsCutThrough (peerId, p))
+    {
+        Time tail = Simulator::Now () + Seconds (m_bps.CalculateTxTime (DCL2MetaTag::GetFrameSize (p))) + m_delay;
+        DeliverHead (peerId, srcId, p, tail);
+    }
+    return true;
+}
+
+bool
+DCCsmaP2PChannel::TransmitEnd (uint32_t deviceId)
+{
+    DCCsmaDeviceRec &src = m_deviceList[deviceId];
+    if (src.state != TRANSMITTING)
+    {
+        NS_LOG_ERROR ("DCCsmaP2PChannel::TransmitEnd(): Seclected source is not in TRANSMITTING state");
+        return false;
+    }
+    DC_LOG_FUNCTION (this << src.currentPkt << deviceId);
+
+    bool retVal = true;
+    if (!src.active)
+    {
+        NS_LOG_ERROR ("DCCsmaP2PChannel::TransmitEnd(): Seclected source was detached before the end of the transmission");
+        retVal = false;
+    }
+
+    Ptr<Packet> p = src.currentPkt;
+    m_txEndTrace (p, deviceId);
+
+    // the peer is the only receiver, it gets the frame itself
+    uint32_t peerId = 1 - deviceId;
+    Ptr<DCCsmaNetDevice> peer = m_peer[deviceId];
+    if (peer && m_deviceList[peerId].active && !IsCutThrough (peerId, p))
+    {
+        Simulator::ScheduleWithContext (peer->GetNode ()->GetId (), m_delay,
+                                        &DCCsmaNetDevice::Receive, peer,
+                                        p, src.devicePtr);
+    }
+
+    if (m_sourceProp)
+    {
+        src.state = PROPAGATING;
+        Simulator::Schedule (m_delay, &DCCsmaChannel::PropagationCompleteEvent,
+                             this, deviceId);
+    }
+    else
+        src.state = IDLE;
+
+    return retVal;
+}
+
+bool
+DCCsmaChannel::CanTrain (uint32_t srcId, Ptr<const Packet> p)
+{
+    uint32_t receivers = 0;
+    for (uint32_t devId = 0; devId < m_deviceList.size (); devId++)
+    {
+        if (devId == srcId || !m_deviceList[devId].IsActive ())
+            continue;
+        if (IsCutThrough (devId, p))
+            return false;
+        receivers++;
+    }
+    return receivers == 1;
+}
+
+bool
+DCCsmaChannel::TransmitTrainEnd (uint32_t deviceId, Ptr<DCPacketTrain> train)
+{
+    DCCsmaDeviceRec &src = m_deviceList[deviceId];
+    if (src.state != TRANSMITTING)
+    {
+        NS_LOG_ERROR ("DCCsmaChannel::TransmitTrainEnd(): Seclected source is not in TRANSMITTING state");
+        return false;
+    }
+    DC_LOG_FUNCTION (this << train->GetN () << deviceId);
+
+    bool retVal = true;
+    if (!src.active)
+    {
+        NS_LOG_ERROR ("DCCsmaChannel::TransmitTrainEnd(): Seclected source was detached before the end of the transmission");
+        retVal = false;
+    }
+
+    for (uint32_t i = 0; i < train->GetN (); i++)
+    {
+        m_txEndTrace (train->Get (i), deviceId);
+    }
+
+    // CanTrain let the train go to one receiver, it gets the frames themselves
+    for (uint32_t devId = 0; devId < m_deviceList.size (); devId++)
+    {
+        if (devId == deviceId || !m_deviceList[devId].IsActive ())
+            continue;
+        Ptr<DCCsmaNetDevice> dev = m_deviceList[devId].devicePtr;
+        Simulator::ScheduleWithContext (dev->GetNode ()->GetId (), m_delay,
+                                        &DCCsmaNetDevice::ReceiveTrain, dev,
+                                        train, src.devicePtr);
+        break;
+    }
+
+    if (m_sourceProp)
+    {
+        src.state = PROPAGATING;
+        Simulator::Schedule (m_delay, &DCCsmaChannel::PropagationCompleteEvent,
+                             this, deviceId);
+    }
+    else
+        src.state = IDLE;
+
+    return retVal;
+}
+
+void
+DCPacketTrain::Add (Ptr<Packet> p, Time end)
+{
+    m_packets.push_back (p);
+    m_ends.push_back (end);
+}
+
+uint32_t
+DCPacketTrain::GetN (void) const
+{
+    return m_packets.size ();
+}
+
+Ptr<Packet>
+DCPacketTrain::Get (uint32_t i) const
+{
+    return m_packets[i];
+}
+
+Time
+DCPacketTrain::GetEnd (uint32_t i) const
+{
+    return m_ends[i];
+}
+
 DCCsmaDeviceRec::DCCsmaDeviceRec ()
 {
     active = false;
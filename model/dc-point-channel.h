@@ -2,6 +2,11 @@
 #ifndef _DC_POINT_CHANNEL_H
 #define _DC_POINT_CHANNEL_H
 
+#include <vector>
+#include "ns3/tag.h"
+#include "ns3/traced-callback.h"
+#include "ns3/simple-ref-count.h"
+#include "ns3/object-factory.h"
 #include "dc-point-channel-base.h"
 
 namespace ns3 {
@@ -10,6 +15,63 @@ class Packet;
 
 class DCCsmaNetDevice;
 
+/**
+ * \ingroup datacenter
+ *
+ * \brief The arrival time of the last bit of a frame handed up early.
+ *
+ * Added by DCCsmaChannel to frames delivered to a cut-through device
+ * (see DCCsmaNetDevice::SetCutThroughBytes) before their tail has
+ * arrived. The egress device reads it so a frame is never sent out
+ * faster than it comes in.
+ */
+class DCCutThroughTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCCutThroughTag ();
+    DCCutThroughTag (Time tail);
+
+    void SetTail (Time tail);
+    Time GetTail (void) const;
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    int64_t m_tail;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Back to back frames of one flow sent as one transmission, see
+ * DCCsmaNetDevice::SetTrainLength.
+ *
+ * Every frame keeps the time its last bit left the sender, so the
+ * receiver knows when each one would have arrived alone.
+ */
+class DCPacketTrain : public SimpleRefCount<DCPacketTrain>
+{
+public:
+    void Add (Ptr<Packet> p, Time end);
+
+    uint32_t GetN (void) const;
+    Ptr<Packet> Get (uint32_t i) const;
+    /**
+     * \return the time the last bit of frame i left the sender
+     */
+    Time GetEnd (uint32_t i) const;
+
+private:
+    std::vector<Ptr<Packet> > m_packets;
+    std::vector<Time> m_ends;
+};
+
 /**
  * Current state of the channel
  */ 
@@ -146,7 +208,7 @@ public:
     * \return True if the channel is not busy and the transmitting net
     * device is currently active.
     */
-    bool TransmitStart (Ptr<Packet> p, uint32_t srcId);
+    virtual bool TransmitStart (Ptr<Packet> p, uint32_t srcId);
 
     /**
     * \brief Indicates that the net device has finished transmitting
@@ -162,7 +224,25 @@ public:
     * \return Returns true unless the source was detached before it
     * completed its transmission.
     */
-    bool TransmitEnd (uint32_t deviceId);
+    virtual bool TransmitEnd (uint32_t deviceId);
+
+    /**
+    * \brief Whether the frames following p may go in a train with it:
+    * there is one receiver and it does not take p in cut-through.
+    */
+    bool CanTrain (uint32_t srcId, Ptr<const Packet> p);
+
+    /**
+    * \brief Indicates that the net device has finished transmitting a
+    * train, whose head was given to TransmitStart.
+    *
+    * The receiver gets the whole train in one event, when the last frame
+    * arrives, see DCCsmaNetDevice::ReceiveTrain.
+    *
+    * \return Returns true unless the source was detached before it
+    * completed its transmission.
+    */
+    bool TransmitTrainEnd (uint32_t deviceId, Ptr<DCPacketTrain> train);
 
     /**
     * \brief Indicates that the channel has finished propagating the
@@ -173,6 +253,12 @@ public:
     */
     void PropagationCompleteEvent (uint32_t deviceId);
 
+    /**
+    * \brief Whether a frame is handed up to a device before its tail
+    * arrives, see DCCsmaNetDevice::SetCutThroughBytes.
+    */
+    bool IsCutThrough (uint32_t deviceId, Ptr<const Packet> p) const;
+
     /**
     * \return Returns the device number assigned to a net device by the
     * channel
@@ -275,6 +361,13 @@ private:
     DCCsmaChannel (DCCsmaChannel const &);
     DCCsmaChannel &operator = (DCCsmaChannel const &);
 
+protected:
+    /**
+    * \brief Hand the head of a frame to a cut-through device, the tag
+    * tells when the tail arrives.
+    */
+    void DeliverHead (uint32_t deviceId, uint32_t srcId, Ptr<Packet> p, Time tail);
+
     /**
     * The assigned data rate of the channel
     */
@@ -320,6 +413,56 @@ private:
     // add by zhengpf
     bool m_fullDuplex;
     bool m_sourceProp;
+
+    TracedCallback<Ptr<const Packet>, uint32_t> m_txEndTrace;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A full duplex DCCsmaChannel with exactly two devices.
+ *
+ * Every link built by DCHelper and DCHost has two ends, so the frame of
+ * one end is received by the other one only. The peer of each end is
+ * kept when the second device attaches: a transmission schedules one
+ * receive event for the peer, with the frame itself instead of a copy,
+ * and does not scan the device list.
+ *
+ * It is the default link of DCHelper and DCHost, DCCsmaChannel is left
+ * for the links shared by more devices and the half duplex links, see
+ * CreateLink.
+ */
+class DCCsmaP2PChannel : public DCCsmaChannel
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCCsmaP2PChannel ();
+    virtual ~DCCsmaP2PChannel ();
+
+    /**
+    * \brief Create a link with a factory, as DCHelper and DCHost do.
+    *
+    * A DCCsmaP2PChannel must be full duplex: if the factory makes a half
+    * duplex one, a DCCsmaChannel with the same attributes is made
+    * instead, with a warning.
+    */
+    static Ptr<DCPointChannelBase> CreateLink (ObjectFactory factory);
+
+    /**
+    * \brief Attach one of the two ends.
+    */
+    virtual uint32_t Attach (Ptr<NetDevice> device);
+
+    virtual bool TransmitStart (Ptr<Packet> p, uint32_t srcId);
+    virtual bool TransmitEnd (uint32_t deviceId);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    // m_peer[i] receives the frames of device i
+    Ptr<DCCsmaNetDevice> m_peer[2];
 };
 
 } // namespace ns3
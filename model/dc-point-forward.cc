@@ -1,5 +1,6 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
 #include "ns3/log.h"
+#include "ns3/simulator.h"
 #include "ns3/ipv4.h"
 #include "ns3/ipv4-header.h"
 #include "dc-node-list.h"
@@ -36,6 +37,9 @@ DCPointNullForward::GetTypeId(void)
 NS_OBJECT_ENSURE_REGISTERED (DCPointStaticForward);
 
 std::map<Ipv4Address,Mac48Address> DCPointStaticForward::m_cache;
+uint32_t DCPointStaticForward::m_nCached = 0;
+bool DCPointStaticForward::m_stale = false;
+Time DCPointStaticForward::m_built;
 
 TypeId
 DCPointStaticForward::GetTypeId(void)
@@ -63,6 +67,29 @@ DCPointStaticForward::RedirectDest (bool arp, Ptr<Packet> packet,const Mac48Addr
 Mac48Address
 DCPointStaticForward::Search (Ipv4Address addr)
 {
+    // a miss scans the vms when some were added or got an address since
+    // the last scan, or else at most once per 100us for the
+    // addresses assigned without Invalidate. An unknown address is not
+    // cached so that the vm it is assigned to later is found
+    if (m_stale || m_nCached != DCNodeList::GetNDCNodes()
+        || Simulator::Now() - m_built >= MicroSeconds(100))
+    {
+        Build();
+        std::map<Ipv4Address,Mac48Address>::iterator i = m_cache.find(addr);
+        if (i != m_cache.end()) return i->second;
+    }
+
+    NS_LOG_WARN("DCPointStaticForward::Search(): Can't find any node with ipv4 address " << addr);
+    return Mac48Address::GetBroadcast();
+}
+
+void
+DCPointStaticForward::Build (void)
+{
+    if (m_nCached == 0)
+        Simulator::ScheduleDestroy (&DCPointStaticForward::Clear);
+
+    m_cache.clear();
     DCNodeList::Iterator i;
     for (i = DCNodeList::Begin();i != DCNodeList::End();i++)
     {
@@ -88,13 +115,27 @@ DCPointStaticForward::Search (Ipv4Address addr)
                     || ifIpv4Addr.IsLocalMulticast() || ifIpv4Addr == Ipv4Address::GetZero()
                     || ifIpv4Addr == Ipv4Address::GetAny() || ifIpv4Addr == Ipv4Address::GetLoopback()) continue;
                 m_cache[ifIpv4Addr] = mac;
-                if (addr == ifIpv4Addr) return mac;
             }
         }
     }
+    m_nCached = DCNodeList::GetNDCNodes();
+    m_stale = false;
+    m_built = Simulator::Now();
+}
 
-    NS_ASSERT_MSG(1,"DCPointStaticForward::Search(): Can't find any node with ipv4 address " << addr);
-    return Mac48Address::GetBroadcast();
+void
+DCPointStaticForward::Invalidate (void)
+{
+    m_stale = true;
+}
+
+void
+DCPointStaticForward::Clear (void)
+{
+    m_cache.clear();
+    m_nCached = 0;
+    m_stale = false;
+    m_built = Time();
 }
 
 } // namespace ns3
@@ -4,6 +4,7 @@
 
 #include <map>
 #include "ns3/mac48-address.h"
+#include "ns3/nstime.h"
 
 namespace ns3 {
 
@@ -36,9 +37,27 @@ public:
     
     virtual Mac48Address RedirectDest (bool arp,Ptr<Packet> packet,const Mac48Address& dest, uint16_t protocolNumber);
 
+    /**
+     * \brief Rebuild the cache at the next miss, to be called when an
+     * address is assigned to a vm (DCIPv4Tenant::AddVm does). An address
+     * assigned another way, e.g. by Ipv4AddressHelper, is found by the
+     * rebuild a miss makes at most once per 100us.
+     */
+    static void Invalidate(void);
+
 private:
     static Mac48Address Search(Ipv4Address addr);
+    static void Build(void);
+    static void Clear(void);
+
+    // address of every vm, the unknown addresses are not cached
     static std::map<Ipv4Address,Mac48Address> m_cache;
+    // the DCNodeList entries already in the cache
+    static uint32_t m_nCached;
+    // an address was assigned since the last build
+    static bool m_stale;
+    // when the cache was built
+    static Time m_built;
 };
 
 }
@@ -1,18 +1,34 @@
 /* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <algorithm>
 #include "ns3/log.h"
 #include "ns3/queue.h"
 #include "ns3/simulator.h"
 #include "ns3/ethernet-header.h"
 #include "ns3/ethernet-trailer.h"
 #include "ns3/llc-snap-header.h"
+#include "ns3/ipv4-header.h"
+#include "ns3/tcp-header.h"
 #include "ns3/error-model.h"
 #include "ns3/enum.h"
 #include "ns3/boolean.h"
 #include "ns3/uinteger.h"
 #include "ns3/pointer.h"
 #include "ns3/trace-source-accessor.h"
+#include "dc-log.h"
 #include "dc-point-channel.h"
 #include "dc-point-forward.h"
+#include "dc-packet-classifier.h"
+#include "dc-int.h"
+#include "dc-vm.h"
+#include "dc-tenant.h"
+#include "dc-tenant-list.h"
+#include "dc-node-mapper.h"
+#include "dc-meta-tag.h"
+#include "dc-flow-monitor.h"
+#include "dc-capture-filter.h"
+#include "dc-bridge-net-device.h"
+#include "dc-ecn-queue.h"
+#include "dc-multi-class-queue.h"
 #include "dc-point-net-device.h"
 
 NS_LOG_COMPONENT_DEFINE ("DCCsmaNetDevice");
@@ -23,6 +39,186 @@ namespace ns3 {
     int DCCsmaNetDevice::m_count = 0;
 #endif
 
+NS_OBJECT_ENSURE_REGISTERED (DCL2MetaTag);
+
+TypeId
+DCL2MetaTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCL2MetaTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCL2MetaTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCL2MetaTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCL2MetaTag::DCL2MetaTag ()
+    : m_protocol (0),
+      m_overhead (0)
+{
+}
+
+DCL2MetaTag::DCL2MetaTag (Mac48Address source, Mac48Address dest, uint16_t protocol, uint16_t overhead)
+    : m_source (source),
+      m_dest (dest),
+      m_protocol (protocol),
+      m_overhead (overhead)
+{
+}
+
+Mac48Address
+DCL2MetaTag::GetSource (void) const
+{
+    return m_source;
+}
+
+Mac48Address
+DCL2MetaTag::GetDestination (void) const
+{
+    return m_dest;
+}
+
+uint16_t
+DCL2MetaTag::GetProtocol (void) const
+{
+    return m_protocol;
+}
+
+uint16_t
+DCL2MetaTag::GetOverhead (void) const
+{
+    return m_overhead;
+}
+
+uint32_t
+DCL2MetaTag::GetFrameSize (Ptr<const Packet> p)
+{
+    uint32_t size = p->GetSize ();
+    DCL2MetaTag tag;
+    if (p->PeekPacketTag (tag))
+        size += tag.m_overhead;
+    DCGsoTag gso;
+    if (p->PeekPacketTag (gso))
+        size += gso.GetExtraBytes ();
+    return size;
+}
+
+uint32_t
+DCL2MetaTag::GetSerializedSize (void) const
+{
+    return 16;
+}
+
+void
+DCL2MetaTag::Serialize (TagBuffer i) const
+{
+    uint8_t mac[6];
+    m_source.CopyTo (mac);
+    i.Write (mac, 6);
+    m_dest.CopyTo (mac);
+    i.Write (mac, 6);
+    i.WriteU16 (m_protocol);
+    i.WriteU16 (m_overhead);
+}
+
+void
+DCL2MetaTag::Deserialize (TagBuffer i)
+{
+    uint8_t mac[6];
+    i.Read (mac, 6);
+    m_source.CopyFrom (mac);
+    i.Read (mac, 6);
+    m_dest.CopyFrom (mac);
+    m_protocol = i.ReadU16 ();
+    m_overhead = i.ReadU16 ();
+}
+
+void
+DCL2MetaTag::Print (std::ostream &os) const
+{
+    os << "src=" << m_source << " dst=" << m_dest << " protocol=" << m_protocol
+       << " overhead=" << m_overhead;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCGsoTag);
+
+TypeId
+DCGsoTag::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCGsoTag")
+        .SetParent<Tag> ()
+        .AddConstructor<DCGsoTag> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCGsoTag::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCGsoTag::DCGsoTag ()
+    : m_segments (1),
+      m_extraBytes (0)
+{
+}
+
+DCGsoTag::DCGsoTag (uint16_t segments, uint32_t extraBytes)
+    : m_segments (segments),
+      m_extraBytes (extraBytes)
+{
+}
+
+uint16_t
+DCGsoTag::GetSegments (void) const
+{
+    return m_segments;
+}
+
+uint32_t
+DCGsoTag::GetExtraBytes (void) const
+{
+    return m_extraBytes;
+}
+
+uint32_t
+DCGsoTag::GetSerializedSize (void) const
+{
+    return 6;
+}
+
+void
+DCGsoTag::Serialize (TagBuffer i) const
+{
+    i.WriteU16 (m_segments);
+    i.WriteU32 (m_extraBytes);
+}
+
+void
+DCGsoTag::Deserialize (TagBuffer i)
+{
+    m_segments = i.ReadU16 ();
+    m_extraBytes = i.ReadU32 ();
+}
+
+uint32_t
+DCGsoTag::CountSegments (Ptr<const Packet> p)
+{
+    DCGsoTag tag;
+    return p->PeekPacketTag (tag) ? tag.m_segments : 1;
+}
+
+void
+DCGsoTag::Print (std::ostream &os) const
+{
+    os << "segments=" << m_segments << " extra=" << m_extraBytes;
+}
 
 NS_OBJECT_ENSURE_REGISTERED (DCCsmaNetDevice);
 
@@ -48,6 +244,40 @@ DCCsmaNetDevice::GetTypeId (void)
                        MakeEnumAccessor (&DCCsmaNetDevice::SetEncapsulationMode),
                        MakeEnumChecker (DIX, "Dix",
                                         LLC, "Llc"))
+        .AddAttribute ("TxMode",
+                       "The transmit state machine, Switched sends back to back on full duplex links.",
+                       EnumValue (SWITCHED),
+                       MakeEnumAccessor (&DCCsmaNetDevice::SetTxMode),
+                       MakeEnumChecker (SWITCHED, "Switched",
+                                        CSMA, "Csma"))
+        .AddAttribute ("GsoSize",
+                       "The largest TCP segment accepted from the IP stack, cut in MTU sized wire segments, 0 to disable. "
+                       "Other IP packets are fragmented for the MTU by the device.",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCCsmaNetDevice::SetGsoSize,
+                                             &DCCsmaNetDevice::GetGsoSize),
+                       MakeUintegerChecker<uint16_t> ())
+        .AddAttribute ("GsoMode",
+                       "How a segment larger than the MTU is sent, Software cuts it to validate Offload.",
+                       EnumValue (GSO_OFFLOAD),
+                       MakeEnumAccessor (&DCCsmaNetDevice::SetGsoMode),
+                       MakeEnumChecker (GSO_OFFLOAD, "Offload",
+                                        GSO_SOFTWARE, "Software"))
+        .AddAttribute ("TrainLength",
+                       "The most back to back frames of one flow sent as one transmission, 1 to disable. "
+                       "The frames of a train leave the queue when it starts, so the queue length is "
+                       "understated, and no train is built on a DCEcnQueue or a shared buffer queue.",
+                       UintegerValue (1),
+                       MakeUintegerAccessor (&DCCsmaNetDevice::SetTrainLength,
+                                             &DCCsmaNetDevice::GetTrainLength),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("HeaderFreeL2",
+                       "Leave the L2 headers out of sent frames, the addressing travels in a packet tag. "
+                       "Only applies when every device of the channel is a bridge port.",
+                       BooleanValue (false),
+                       MakeBooleanAccessor (&DCCsmaNetDevice::SetHeaderFreeL2,
+                                            &DCCsmaNetDevice::GetHeaderFreeL2),
+                       MakeBooleanChecker ())
         .AddAttribute ("SendEnable", 
                        "Enable or disable the transmitter section of the device.",
                        BooleanValue (true),
@@ -84,6 +314,29 @@ DCCsmaNetDevice::GetTypeId (void)
                        MakePointerAccessor (&DCCsmaNetDevice::m_forward),
                        MakePointerChecker<DCPointForward> ())
 
+        .AddAttribute ("Classifier", "The traffic class classifier of sent packets",
+                       PointerValue (),
+                       MakePointerAccessor (&DCCsmaNetDevice::m_classifier),
+                       MakePointerChecker<DCPacketClassifier> ())
+
+        .AddAttribute ("CutThroughBytes",
+                       "Bytes of a frame received before it is handed up, 0 means store-and-forward",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCCsmaNetDevice::m_cutThroughBytes),
+                       MakeUintegerChecker<uint32_t> ())
+
+        .AddAttribute ("IntMaxHops",
+                       "Ask for in-band telemetry of this many hops on sent frames, 0 disables it",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCCsmaNetDevice::m_intMaxHops),
+                       MakeUintegerChecker<uint8_t> (0, DCIntTag::MAX_HOPS))
+
+        .AddAttribute ("UtilizationWindow",
+                       "The window of the transmitter utilization",
+                       TimeValue (MicroSeconds (50)),
+                       MakeTimeAccessor (&DCCsmaNetDevice::m_utilWindow),
+                       MakeTimeChecker ())
+
         //
         // Trace sources at the "top" of the net device, where packets transition
         // to/from higher layers.
@@ -140,9 +393,25 @@ DCCsmaNetDevice::GetTypeId (void)
 DCCsmaNetDevice::DCCsmaNetDevice ()
     : m_linkUp (false)
 {
-    NS_LOG_FUNCTION (this);
+    DC_LOG_FUNCTION (this);
     m_txMachineState = READY;
+    m_txMode = SWITCHED;
+    m_headerFreeL2 = false;
+    m_sendHeaderFree = false;
+    m_capture = false;
+    m_bridge = 0;
+    m_trainLength = 1;
+    m_gsoSize = 0;
+    m_gsoMode = GSO_OFFLOAD;
+    m_rxTrain = false;
+    m_metaGeneration = 0;
+    m_metaStamp = false;
+    m_metaTenant = 0;
     m_tInterframeGap = Seconds (0);
+    m_cutThroughBytes = 0;
+    m_txIdleStart = false;
+    m_intMaxHops = 0;
+    m_util = 0;
     m_channel = 0; 
 
     // 
@@ -165,45 +434,49 @@ DCCsmaNetDevice::DCCsmaNetDevice ()
 
 DCCsmaNetDevice::~DCCsmaNetDevice()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_queue = 0;
 }
 
 void
 DCCsmaNetDevice::DoDispose ()
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_channel = 0;
     m_node = 0;
+    m_classifier = 0;
+    m_bridge = 0;
+    m_train = 0;
+    m_captureFilter = 0;
     NetDevice::DoDispose ();
 }
 
 void
 DCCsmaNetDevice::SetEncapsulationMode (enum EncapsulationMode mode)
 {
-    NS_LOG_FUNCTION (mode);
+    DC_LOG_FUNCTION (mode);
 
     m_encapMode = mode;
 
-    NS_LOG_LOGIC ("m_encapMode = " << m_encapMode);
-    NS_LOG_LOGIC ("m_mtu = " << m_mtu);
+    DC_LOG_LOGIC ("m_encapMode = " << m_encapMode);
+    DC_LOG_LOGIC ("m_mtu = " << m_mtu);
 }
 
 DCCsmaNetDevice::EncapsulationMode
 DCCsmaNetDevice::GetEncapsulationMode (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_encapMode;
 }
 
 bool
 DCCsmaNetDevice::SetMtu (uint16_t mtu)
 {
-    NS_LOG_FUNCTION (this << mtu);
+    DC_LOG_FUNCTION (this << mtu);
     m_mtu = mtu;
 
-    NS_LOG_LOGIC ("m_encapMode = " << m_encapMode);
-    NS_LOG_LOGIC ("m_mtu = " << m_mtu);
+    DC_LOG_LOGIC ("m_encapMode = " << m_encapMode);
+    DC_LOG_LOGIC ("m_mtu = " << m_mtu);
 
     return true;
 }
@@ -211,50 +484,204 @@ DCCsmaNetDevice::SetMtu (uint16_t mtu)
 uint16_t
 DCCsmaNetDevice::GetMtu (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
-    return m_mtu;
+    DC_LOG_FUNCTION_NOARGS ();
+    // the IP stack may hand super-segments, see SetGsoSize
+    return m_gsoSize > m_mtu ? m_gsoSize : m_mtu;
 }
 
 
 void
 DCCsmaNetDevice::SetSendEnable (bool sendEnable)
 {
-    NS_LOG_FUNCTION (sendEnable);
+    DC_LOG_FUNCTION (sendEnable);
     m_sendEnable = sendEnable;
 }
 
 void
 DCCsmaNetDevice::SetReceiveEnable (bool receiveEnable)
 {
-    NS_LOG_FUNCTION (receiveEnable);
+    DC_LOG_FUNCTION (receiveEnable);
     m_receiveEnable = receiveEnable;
 }
 
 bool
 DCCsmaNetDevice::IsSendEnabled (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_sendEnable;
 }
 
 bool
 DCCsmaNetDevice::IsReceiveEnabled (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_receiveEnable;
 }
 
 void
 DCCsmaNetDevice::SetInterframeGap (Time t)
 {
-    NS_LOG_FUNCTION (t);
+    DC_LOG_FUNCTION (t);
     m_tInterframeGap = t;
 }
 
+void
+DCCsmaNetDevice::SetTxMode (enum TxMode mode)
+{
+    DC_LOG_FUNCTION (mode);
+    m_txMode = mode;
+    if (m_channel != 0 && !m_channel->FullDuplex ())
+    {
+        m_txMode = CSMA;
+    }
+}
+
+DCCsmaNetDevice::TxMode
+DCCsmaNetDevice::GetTxMode (void) const
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    return m_txMode;
+}
+
+void
+DCCsmaNetDevice::SetHeaderFreeL2 (bool enable)
+{
+    DC_LOG_FUNCTION (enable);
+    m_headerFreeL2 = enable;
+    UpdateHeaderFree ();
+}
+
+bool
+DCCsmaNetDevice::GetHeaderFreeL2 (void) const
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    return m_headerFreeL2;
+}
+
+void
+DCCsmaNetDevice::EnableCapture (Ptr<DCCaptureFilter> filter)
+{
+    DC_LOG_FUNCTION (filter);
+    // a second capture with another filter needs every frame
+    m_captureFilter = !m_capture || m_captureFilter == filter ? filter : 0;
+    m_capture = true;
+}
+
+bool
+DCCsmaNetDevice::CaptureMatch (Ptr<const Packet> payload, const DCL2MetaTag &meta) const
+{
+    if (m_captureFilter == 0) return true;
+    DCFlowMonitor::FlowKey key;
+    DCFlowMonitor::ParsePayloadKey (payload, meta.GetSource (), meta.GetDestination (), meta.GetProtocol (), key);
+    return m_captureFilter->Match (key);
+}
+
+void
+DCCsmaNetDevice::UpdateHeaderFree (void)
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    if (m_channel == 0)
+    {
+        m_sendHeaderFree = false;
+        return;
+    }
+
+    //
+    // A header free frame is only understood by a bridge port: the stack
+    // of a vm, or of any other end point, would get a frame without its
+    // headers and with a DCL2MetaTag left on it.
+    //
+    bool bridged = true;
+    for (uint32_t i = 0;i < m_channel->GetNDevices ();i++)
+    {
+        if (m_channel->GetDCCsmaDevice (i)->m_bridge == 0)
+            bridged = false;
+    }
+    for (uint32_t i = 0;i < m_channel->GetNDevices ();i++)
+    {
+        Ptr<DCCsmaNetDevice> device = m_channel->GetDCCsmaDevice (i);
+        device->m_sendHeaderFree = bridged && device->m_headerFreeL2;
+    }
+}
+
+void
+DCCsmaNetDevice::SetGsoSize (uint16_t size)
+{
+    DC_LOG_FUNCTION (size);
+    m_gsoSize = size;
+}
+
+uint16_t
+DCCsmaNetDevice::GetGsoSize (void) const
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    return m_gsoSize;
+}
+
+void
+DCCsmaNetDevice::SetGsoMode (DCCsmaNetDevice::GsoMode mode)
+{
+    DC_LOG_FUNCTION (mode);
+    m_gsoMode = mode;
+}
+
+DCCsmaNetDevice::GsoMode
+DCCsmaNetDevice::GetGsoMode (void) const
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    return m_gsoMode;
+}
+
+void
+DCCsmaNetDevice::SetTrainLength (uint32_t length)
+{
+    DC_LOG_FUNCTION (length);
+    m_trainLength = length;
+}
+
+uint32_t
+DCCsmaNetDevice::GetTrainLength (void) const
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    return m_trainLength;
+}
+
+void
+DCCsmaNetDevice::ReceiveTrain (Ptr<DCPacketTrain> train, Ptr<DCCsmaNetDevice> senderDevice)
+{
+    DC_LOG_FUNCTION (train->GetN () << senderDevice);
+
+    //
+    // Every frame arrives the same delay after it left the sender.
+    //
+    Time delay = Simulator::Now () - train->GetEnd (train->GetN () - 1);
+    m_rxTrain = true;
+    for (uint32_t i = 0;i < train->GetN ();i++)
+    {
+        m_rxTime = train->GetEnd (i) + delay;
+        Receive (train->Get (i), senderDevice);
+    }
+    m_rxTrain = false;
+}
+
+Time
+DCCsmaNetDevice::GetRxTime (void) const
+{
+    return m_rxTrain ? m_rxTime : Simulator::Now ();
+}
+
+void
+DCCsmaNetDevice::SetBridge (DCCsmaBridgeNetDevice *bridge)
+{
+    DC_LOG_FUNCTION (bridge);
+    m_bridge = bridge;
+    UpdateHeaderFree ();
+}
+
 void
 DCCsmaNetDevice::SetBackoffParams (Time slotTime, uint32_t minSlots, uint32_t maxSlots, uint32_t ceiling, uint32_t maxRetries)
 {
-    NS_LOG_FUNCTION (slotTime << minSlots << maxSlots << ceiling << maxRetries);
+    DC_LOG_FUNCTION (slotTime << minSlots << maxSlots << ceiling << maxRetries);
     m_backoff.m_slotTime = slotTime;
     m_backoff.m_minSlots = minSlots;
     m_backoff.m_maxSlots = maxSlots;
@@ -265,7 +692,35 @@ DCCsmaNetDevice::SetBackoffParams (Time slotTime, uint32_t minSlots, uint32_t ma
 void
 DCCsmaNetDevice::AddHeader (Ptr<Packet> p,   Mac48Address source,  Mac48Address dest,  uint16_t protocolNumber)
 {
-    NS_LOG_FUNCTION (p << source << dest << protocolNumber);
+    DC_LOG_FUNCTION (p << source << dest << protocolNumber);
+
+    if (!m_sendHeaderFree)
+    {
+        AddL2Header (p, source, dest, protocolNumber);
+        return;
+    }
+
+    //
+    // Count the bytes AddL2Header would add: the Ethernet header and
+    // trailer, the LLC/SNAP header and the padding to 46 bytes of payload.
+    //
+    uint32_t payload = p->GetSize ();
+    if (m_encapMode == LLC)
+    {
+        payload += 8;
+    }
+    uint32_t overhead = 14 + 4 + (payload - p->GetSize ());
+    if (payload < 46)
+    {
+        overhead += 46 - payload;
+    }
+    p->AddPacketTag (DCL2MetaTag (source, dest, protocolNumber, overhead));
+}
+
+void
+DCCsmaNetDevice::AddL2Header (Ptr<Packet> p,   Mac48Address source,  Mac48Address dest,  uint16_t protocolNumber)
+{
+    DC_LOG_FUNCTION (p << source << dest << protocolNumber);
 
     EthernetHeader header (false);
     header.SetSource (source);
@@ -273,16 +728,16 @@ DCCsmaNetDevice::AddHeader (Ptr<Packet> p,   Mac48Address source,  Mac48Address
 
     EthernetTrailer trailer;
 
-    NS_LOG_LOGIC ("p->GetSize () = " << p->GetSize ());
-    NS_LOG_LOGIC ("m_encapMode = " << m_encapMode);
-    NS_LOG_LOGIC ("m_mtu = " << m_mtu);
+    DC_LOG_LOGIC ("p->GetSize () = " << p->GetSize ());
+    DC_LOG_LOGIC ("m_encapMode = " << m_encapMode);
+    DC_LOG_LOGIC ("m_mtu = " << m_mtu);
 
     uint16_t lengthType = 0;
     switch (m_encapMode) 
     {
     case DIX:
         {
-            NS_LOG_LOGIC ("Encapsulating packet as DIX (type interpretation)");
+            DC_LOG_LOGIC ("Encapsulating packet as DIX (type interpretation)");
             //
             // This corresponds to the type interpretation of the lengthType field as
             // in the old Ethernet Blue Book.
@@ -306,7 +761,7 @@ DCCsmaNetDevice::AddHeader (Ptr<Packet> p,   Mac48Address source,  Mac48Address
         break;
     case LLC:
         {
-            NS_LOG_LOGIC ("Encapsulating packet as LLC (length interpretation)");
+            DC_LOG_LOGIC ("Encapsulating packet as LLC (length interpretation)");
 
             LlcSnapHeader llc;
             llc.SetType (protocolNumber);
@@ -333,7 +788,8 @@ DCCsmaNetDevice::AddHeader (Ptr<Packet> p,   Mac48Address source,  Mac48Address
                 p->AddAtEnd (padd);
             }
 
-            NS_ASSERT_MSG (p->GetSize () <= GetMtu (),
+            DCGsoTag gso;
+            DC_ASSERT_MSG (p->GetSize () <= GetMtu () || p->PeekPacketTag (gso),
                            "DCCsmaNetDevice::AddHeader(): 802.3 Length/Type field with LLC/SNAP: "
                            "length interpretation must not exceed device frame size minus overhead");
         }
@@ -344,7 +800,7 @@ DCCsmaNetDevice::AddHeader (Ptr<Packet> p,   Mac48Address source,  Mac48Address
         break;
     }
 
-    NS_LOG_LOGIC ("header.SetLengthType (" << lengthType << ")");
+    DC_LOG_LOGIC ("header.SetLengthType (" << lengthType << ")");
     header.SetLengthType (lengthType);
     p->AddHeader (header);
 
@@ -356,26 +812,44 @@ DCCsmaNetDevice::AddHeader (Ptr<Packet> p,   Mac48Address source,  Mac48Address
     p->AddTrailer (trailer);
 }
 
+void
+DCCsmaNetDevice::Sniff (Ptr<const Packet> p)
+{
+    DCL2MetaTag meta;
+    if (m_capture && p->PeekPacketTag (meta) && CaptureMatch (p, meta))
+    {
+        // the capture gets the frame the headers would make
+        Ptr<Packet> frame = p->Copy ();
+        frame->RemovePacketTag (meta);
+        AddL2Header (frame, meta.GetSource (), meta.GetDestination (), meta.GetProtocol ());
+        m_snifferTrace (frame);
+        m_promiscSnifferTrace (frame);
+        return;
+    }
+    m_snifferTrace (p);
+    m_promiscSnifferTrace (p);
+}
+
 void
 DCCsmaNetDevice::TransmitStart (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 
     //
     // This function is called to start the process of transmitting a packet.  We 
     // expect that the packet to transmit will be found in m_currentPkt.
     //
-    NS_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitStart(): m_currentPkt not set");
+    DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitStart(): m_currentPkt not set");
 
-    NS_LOG_LOGIC ("m_currentPkt = " << m_currentPkt);
-    NS_LOG_LOGIC ("UID = " << m_currentPkt->GetUid ());
+    DC_LOG_LOGIC ("m_currentPkt = " << m_currentPkt);
+    DC_LOG_LOGIC ("UID = " << m_currentPkt->GetUid ());
 
     //
     // Only transmit if the send side of net device is enabled
     //
     if (IsSendEnabled () == false)
     {
-        NS_LOG_LOGIC ("Send side disabled, packet (" << m_currentPkt << ") drop");
+        DC_LOG_LOGIC ("Send side disabled, packet (" << m_currentPkt << ") drop");
         if (!m_pktProcHook.txDrop.IsNull())
             m_pktProcHook.txDrop(m_currentPkt);
         m_phyTxDropTrace (m_currentPkt);
@@ -389,9 +863,33 @@ DCCsmaNetDevice::TransmitStart (void)
     // Specifically, if we are ready to start transmitting, we cannot already
     // be transmitting (i.e., BUSY)
     //
-    NS_ASSERT_MSG ((m_txMachineState == READY) || (m_txMachineState == BACKOFF), 
+    DC_ASSERT_MSG ((m_txMachineState == READY) || (m_txMachineState == BACKOFF), 
                  "Must be READY to transmit. Tx state is: " << m_txMachineState);
 
+    //
+    // A frame forwarded in cut-through mode must not leave before it has
+    // arrived: from an idle port it may start early as long as its tail
+    // goes out after it came in, otherwise it waits for its tail.
+    //
+    DCCutThroughTag cutThrough;
+    if (m_currentPkt->RemovePacketTag (cutThrough))
+    {
+        Time earliest = cutThrough.GetTail ();
+        if (m_txIdleStart)
+        {
+            earliest = earliest - Seconds (m_bps.CalculateTxTime (DCL2MetaTag::GetFrameSize (m_currentPkt)));
+        }
+        m_txIdleStart = false;
+        if (earliest > Simulator::Now ())
+        {
+            DC_LOG_LOGIC ("Hold cut-through frame until " << earliest.GetSeconds () << " sec");
+            m_txMachineState = BACKOFF;
+            Simulator::Schedule (earliest - Simulator::Now (), &DCCsmaNetDevice::TransmitStart, this);
+            return;
+        }
+    }
+    m_txIdleStart = false;
+
     //
     // Now we have to sense the state of the medium and either start transmitting
     // if it is idle, or backoff our transmission if someone else is on the wire.
@@ -418,7 +916,7 @@ DCCsmaNetDevice::TransmitStart (void)
             m_backoff.IncrNumRetries ();
             Time backoffTime = m_backoff.GetBackoffTime ();
 
-            NS_LOG_LOGIC ("Channel busy, backing off for " << backoffTime.GetSeconds () << " sec");
+            DC_LOG_LOGIC ("Channel busy, backing off for " << backoffTime.GetSeconds () << " sec");
 
             Simulator::Schedule (backoffTime, &DCCsmaNetDevice::TransmitStart, this);
         }
@@ -447,32 +945,98 @@ DCCsmaNetDevice::TransmitStart (void)
             m_txMachineState = BUSY;
             m_phyTxBeginTrace (m_currentPkt);
 
-            Time tEvent = Seconds (m_bps.CalculateTxTime (m_currentPkt->GetSize ()));
-            NS_LOG_LOGIC ("Schedule TransmitCompleteEvent in " << tEvent.GetSeconds () << "sec");
+            Time tEvent = Seconds (m_bps.CalculateTxTime (DCL2MetaTag::GetFrameSize (m_currentPkt)));
+            m_util = GetTxUtilization () + tEvent.GetSeconds () / m_utilWindow.GetSeconds ();
+            m_utilUpdated = Simulator::Now ();
+            if (m_txMode == SWITCHED && m_trainLength > 1)
+            {
+                tEvent = BuildTrain (tEvent);
+            }
+            DC_LOG_LOGIC ("Schedule TransmitCompleteEvent in " << tEvent.GetSeconds () << "sec");
             Simulator::Schedule (tEvent, &DCCsmaNetDevice::TransmitCompleteEvent, this);
         }
     }
 }
 
+Time
+DCCsmaNetDevice::BuildTrain (Time first)
+{
+    DCMetaTag head;
+    if (!QueueAllowsTrain () || !m_currentPkt->PeekPacketTag (head)
+        || !m_channel->CanTrain (m_deviceId, m_currentPkt))
+    {
+        return first;
+    }
+
+    Time end = first;
+    while (m_queue->IsEmpty () == false
+           && (m_train == 0 || m_train->GetN () < m_trainLength))
+    {
+        //
+        // Only the frames of the same flow, and not held for cut-through.
+        //
+        Ptr<const Packet> next = m_queue->Peek ();
+        DCMetaTag meta;
+        DCCutThroughTag cutThrough;
+        if (!next->PeekPacketTag (meta)
+            || meta.GetFlowId () != head.GetFlowId ()
+            || meta.GetTenantId () != head.GetTenantId ()
+            || next->PeekPacketTag (cutThrough))
+        {
+            break;
+        }
+        if (m_train == 0)
+        {
+            m_train = Create<DCPacketTrain> ();
+            m_train->Add (m_currentPkt, Simulator::Now () + first);
+        }
+
+        Ptr<Packet> p = m_queue->Dequeue ();
+        Sniff (p);
+        m_phyTxBeginTrace (p);
+        Time tx = Seconds (m_bps.CalculateTxTime (DCL2MetaTag::GetFrameSize (p)));
+        m_util += tx.GetSeconds () / m_utilWindow.GetSeconds ();
+        end = end + m_tInterframeGap + tx;
+        m_train->Add (p, Simulator::Now () + end);
+    }
+    DC_LOG_LOGIC ("Train of " << (m_train ? m_train->GetN () : 1) << " frames");
+    return end;
+}
+
+bool
+DCCsmaNetDevice::QueueAllowsTrain (void) const
+{
+    //
+    // A train is dequeued when it starts, the queues that mark or admit
+    // frames on the queue length would see it too short.
+    //
+    if (DynamicCast<DCEcnQueue> (m_queue))
+    {
+        return false;
+    }
+    Ptr<DCMultiClassQueue> mcq = DynamicCast<DCMultiClassQueue> (m_queue);
+    return !(mcq && mcq->GetSharedBuffer ());
+}
+
 void
 DCCsmaNetDevice::TransmitAbort (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 
     //
     // When we started the process of transmitting the current packet, it was 
     // placed in m_currentPkt.  So we had better find one there.
     //
-    NS_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitAbort(): m_currentPkt zero");
-    NS_LOG_LOGIC ("m_currentPkt=" << m_currentPkt);
-    NS_LOG_LOGIC ("Pkt UID is " << m_currentPkt->GetUid () << ")");
+    DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitAbort(): m_currentPkt zero");
+    DC_LOG_LOGIC ("m_currentPkt=" << m_currentPkt);
+    DC_LOG_LOGIC ("Pkt UID is " << m_currentPkt->GetUid () << ")");
 
     if (!m_pktProcHook.txDrop.IsNull())
         m_pktProcHook.txDrop(m_currentPkt);
     m_phyTxDropTrace (m_currentPkt);
     m_currentPkt = 0;
 
-    NS_ASSERT_MSG (m_txMachineState == BACKOFF, "Must be in BACKOFF state to abort. Tx state is: " << m_txMachineState);
+    DC_ASSERT_MSG (m_txMachineState == BACKOFF, "Must be in BACKOFF state to abort. Tx state is: " << m_txMachineState);
 
     // 
     // We're done with that one, so reset the backoff algorithm and ready the
@@ -493,9 +1057,8 @@ DCCsmaNetDevice::TransmitAbort (void)
     else
     {
         m_currentPkt = m_queue->Dequeue ();
-        NS_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitAbort(): IsEmpty false but no Packet on queue?");
-        m_snifferTrace (m_currentPkt);
-        m_promiscSnifferTrace (m_currentPkt);
+        DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitAbort(): IsEmpty false but no Packet on queue?");
+        Sniff (m_currentPkt);
         TransmitStart ();
     }
 }
@@ -503,7 +1066,7 @@ DCCsmaNetDevice::TransmitAbort (void)
 void
 DCCsmaNetDevice::TransmitCompleteEvent (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 
     //
     // This function is called to finish the  process of transmitting a packet.
@@ -511,25 +1074,56 @@ DCCsmaNetDevice::TransmitCompleteEvent (void)
     // schedule an event that will be executed when it's time to re-enable
     // the transmitter after the interframe gap.
     //
-    NS_ASSERT_MSG (m_txMachineState == BUSY, "DCCsmaNetDevice::transmitCompleteEvent(): Must be BUSY if transmitting");
-    NS_ASSERT (m_channel->GetState (m_deviceId) == TRANSMITTING);
+    DC_ASSERT_MSG (m_txMachineState == BUSY, "DCCsmaNetDevice::transmitCompleteEvent(): Must be BUSY if transmitting");
+    DC_ASSERT (m_channel->GetState (m_deviceId) == TRANSMITTING);
     m_txMachineState = GAP;
 
     //
     // When we started transmitting the current packet, it was placed in 
     // m_currentPkt.  So we had better find one there.
     //
-    NS_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitCompleteEvent(): m_currentPkt zero");
-    NS_LOG_LOGIC ("m_currentPkt=" << m_currentPkt);
-    NS_LOG_LOGIC ("Pkt UID is " << m_currentPkt->GetUid () << ")");
+    DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitCompleteEvent(): m_currentPkt zero");
+    DC_LOG_LOGIC ("m_currentPkt=" << m_currentPkt);
+    DC_LOG_LOGIC ("Pkt UID is " << m_currentPkt->GetUid () << ")");
 
-    m_channel->TransmitEnd (m_deviceId);
-    if (!m_pktProcHook.txSentSucess.IsNull())
-        m_pktProcHook.txSentSucess(m_currentPkt);
-    m_phyTxEndTrace (m_currentPkt);
+    if (m_train)
+    {
+        m_channel->TransmitTrainEnd (m_deviceId, m_train);
+        for (uint32_t i = 0;i < m_train->GetN ();i++)
+        {
+            if (!m_pktProcHook.txSentSucess.IsNull())
+                m_pktProcHook.txSentSucess(m_train->Get (i));
+            m_phyTxEndTrace (m_train->Get (i));
+        }
+        m_train = 0;
+    }
+    else
+    {
+        m_channel->TransmitEnd (m_deviceId);
+        if (!m_pktProcHook.txSentSucess.IsNull())
+            m_pktProcHook.txSentSucess(m_currentPkt);
+        m_phyTxEndTrace (m_currentPkt);
+    }
     m_currentPkt = 0;
 
-    NS_LOG_LOGIC ("Schedule TransmitReadyEvent in " << m_tInterframeGap.GetSeconds () << "sec");
+    if (m_txMode == SWITCHED && m_tInterframeGap.IsZero ())
+    {
+        //
+        // No gap to wait for, e.g. on a full duplex link, start the next
+        // frame now instead of in a TransmitReadyEvent.
+        //
+        m_txMachineState = READY;
+        if (m_queue->IsEmpty () == false)
+        {
+            m_currentPkt = m_queue->Dequeue ();
+            DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitCompleteEvent(): IsEmpty false but no Packet on queue?");
+            Sniff (m_currentPkt);
+            TransmitStart ();
+        }
+        return;
+    }
+
+    DC_LOG_LOGIC ("Schedule TransmitReadyEvent in " << m_tInterframeGap.GetSeconds () << "sec");
 
     Simulator::Schedule (m_tInterframeGap, &DCCsmaNetDevice::TransmitReadyEvent, this);
 }
@@ -537,21 +1131,21 @@ DCCsmaNetDevice::TransmitCompleteEvent (void)
 void
 DCCsmaNetDevice::TransmitReadyEvent (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
 
     //
     // This function is called to enable the transmitter after the interframe
     // gap has passed.  If there are pending transmissions, we use this opportunity
     // to start the next transmit.
     //
-    NS_ASSERT_MSG (m_txMachineState == GAP, "DCCsmaNetDevice::TransmitReadyEvent(): Must be in interframe gap");
+    DC_ASSERT_MSG (m_txMachineState == GAP, "DCCsmaNetDevice::TransmitReadyEvent(): Must be in interframe gap");
     m_txMachineState = READY;
 
     //
     // We expect that the packet we had been transmitting was cleared when the 
     // TransmitCompleteEvent() was executed.
     //
-    NS_ASSERT_MSG (m_currentPkt == 0, "DCCsmaNetDevice::TransmitReadyEvent(): m_currentPkt nonzero");
+    DC_ASSERT_MSG (m_currentPkt == 0, "DCCsmaNetDevice::TransmitReadyEvent(): m_currentPkt nonzero");
 
     //
     // Get the next packet from the queue for transmitting
@@ -563,9 +1157,8 @@ DCCsmaNetDevice::TransmitReadyEvent (void)
     else
     {
         m_currentPkt = m_queue->Dequeue ();
-        NS_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitReadyEvent(): IsEmpty false but no Packet on queue?");
-        m_snifferTrace (m_currentPkt);
-        m_promiscSnifferTrace (m_currentPkt);
+        DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::TransmitReadyEvent(): IsEmpty false but no Packet on queue?");
+        Sniff (m_currentPkt);
         TransmitStart ();
     }
 }
@@ -573,10 +1166,10 @@ DCCsmaNetDevice::TransmitReadyEvent (void)
 bool
 DCCsmaNetDevice::Attach (Ptr<DCPointChannelBase> ch)
 {
-    NS_LOG_FUNCTION (this << &ch);
+    DC_LOG_FUNCTION (this << &ch);
 
     Ptr<DCCsmaChannel> chnl = dynamic_cast<DCCsmaChannel*>(PeekPointer(ch));
-    NS_ASSERT_MSG (chnl != 0, "DCCsmaNetDevice::Attach(): the channel should be a DCCsmaChannel");
+    DC_ASSERT_MSG (chnl != 0, "DCCsmaNetDevice::Attach(): the channel should be a DCCsmaChannel");
     m_channel = chnl;
 
     m_deviceId = m_channel->Attach (this);
@@ -592,6 +1185,12 @@ DCCsmaNetDevice::Attach (Ptr<DCPointChannelBase> ch)
     //
     m_tInterframeGap = m_channel->FullDuplex()?Seconds(0):Seconds (m_bps.CalculateTxTime (96/8));
 
+    //
+    // Back to back transmission needs a full duplex channel.
+    //
+    SetTxMode (m_txMode);
+    UpdateHeaderFree ();
+
     //
     // This device is up whenever a channel is attached to it.
     //
@@ -602,22 +1201,22 @@ DCCsmaNetDevice::Attach (Ptr<DCPointChannelBase> ch)
 void
 DCCsmaNetDevice::SetQueue (Ptr<Queue> q)
 {
-    NS_LOG_FUNCTION (q);
+    DC_LOG_FUNCTION (q);
     m_queue = q;
 }
 
 void
 DCCsmaNetDevice::SetReceiveErrorModel (Ptr<ErrorModel> em)
 {
-    NS_LOG_FUNCTION (em);
+    DC_LOG_FUNCTION (em);
     m_receiveErrorModel = em; 
 }
 
 void
 DCCsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<DCCsmaNetDevice> senderDevice)
 {
-    NS_LOG_FUNCTION (packet << senderDevice);
-    NS_LOG_LOGIC ("UID is " << packet->GetUid ());
+    DC_LOG_FUNCTION (packet << senderDevice);
+    DC_LOG_LOGIC ("UID is " << packet->GetUid ());
 
     //
     // We never forward up packets that we sent.  Real devices don't do this since
@@ -639,7 +1238,7 @@ DCCsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<DCCsmaNetDevice> senderDevice)
     //
     if (IsReceiveEnabled () == false)
     {
-        NS_LOG_LOGIC ("Receive side disabled, packet (" << packet <<") drop");
+        DC_LOG_LOGIC ("Receive side disabled, packet (" << packet <<") drop");
         if (!m_pktProcHook.rxDrop.IsNull())
             m_pktProcHook.rxDrop(packet);
         m_phyRxDropTrace (packet);
@@ -648,83 +1247,118 @@ DCCsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<DCCsmaNetDevice> senderDevice)
 
     if (m_receiveErrorModel && m_receiveErrorModel->IsCorrupt (packet) )
     {
-        NS_LOG_LOGIC ("Dropping pkt due to error model ");
+        DC_LOG_LOGIC ("Dropping pkt due to error model ");
         if (!m_pktProcHook.rxDrop.IsNull())
             m_pktProcHook.rxDrop(packet);
         m_phyRxDropTrace (packet);
         return;
     }
 
-    //
-    // Trace sinks will expect complete packets, not packets without some of the
-    // headers.
-    //
-    Ptr<Packet> originalPacket = packet->Copy ();
+    Ptr<Packet> originalPacket;
+    Mac48Address source;
+    Mac48Address destination;
+    uint16_t protocol;
 
-    EthernetTrailer trailer;
-    packet->RemoveTrailer (trailer);
-    if (Node::ChecksumEnabled ())
+    DCL2MetaTag meta;
+    if (packet->RemovePacketTag (meta))
     {
-        trailer.EnableFcs (true);
+        //
+        // A header free frame: the addressing is in the tag and there is
+        // nothing to strip. Rebuild the headers for the trace sinks unless
+        // this device is header free too and no capture wants real frames.
+        //
+        source = meta.GetSource ();
+        destination = meta.GetDestination ();
+        protocol = meta.GetProtocol ();
+        if (m_sendHeaderFree && !m_capture)
+        {
+            originalPacket = packet;
+        }
+        else if (m_sendHeaderFree && !CaptureMatch (packet, meta))
+        {
+            // the capture drops it, keep the tag for its filter
+            originalPacket = packet->Copy ();
+            originalPacket->AddPacketTag (meta);
+        }
+        else
+        {
+            originalPacket = packet->Copy ();
+            AddL2Header (originalPacket, source, destination, protocol);
+        }
     }
-
-    trailer.CheckFcs (packet);
-    bool crcGood = trailer.CheckFcs (packet);
-    if (!crcGood)
+    else
     {
-        NS_LOG_INFO ("CRC error on Packet " << packet);
-        if (m_pktProcHook.rxDrop.IsNull())
-            m_pktProcHook.rxDrop(packet);
-        m_phyRxDropTrace (packet);
-        return;
-    }
-
-    EthernetHeader header (false);
-    packet->RemoveHeader (header);
+        //
+        // Trace sinks will expect complete packets, not packets without some of the
+        // headers.
+        //
+        originalPacket = packet->Copy ();
 
-    NS_LOG_LOGIC ("Pkt source is " << header.GetSource ());
-    NS_LOG_LOGIC ("Pkt destination is " << header.GetDestination ());
+        EthernetTrailer trailer;
+        packet->RemoveTrailer (trailer);
+        if (Node::ChecksumEnabled ())
+        {
+            trailer.EnableFcs (true);
+        }
 
-    uint16_t protocol;
-    //
-    // If the length/type is less than 1500, it corresponds to a length 
-    // interpretation packet.  In this case, it is an 802.3 packet and 
-    // will also have an 802.2 LLC header.  If greater than 1500, we
-    // find the protocol number (Ethernet type) directly.
-    //
-    if (header.GetLengthType () <= 1500)
-    {
-        NS_ASSERT (packet->GetSize () >= header.GetLengthType ());
-        uint32_t padlen = packet->GetSize () - header.GetLengthType ();
-        NS_ASSERT (padlen <= 46);
-        if (padlen > 0)
+        bool crcGood = trailer.CheckFcs (packet);
+        if (!crcGood)
         {
-            packet->RemoveAtEnd (padlen);
+            DC_LOG_INFO ("CRC error on Packet " << packet);
+            if (!m_pktProcHook.rxDrop.IsNull())
+                m_pktProcHook.rxDrop(packet);
+            m_phyRxDropTrace (packet);
+            return;
         }
 
-        LlcSnapHeader llc;
-        packet->RemoveHeader (llc);
-        protocol = llc.GetType ();
-    }
-    else
-    {
-        protocol = header.GetLengthType ();
+        EthernetHeader header (false);
+        packet->RemoveHeader (header);
+        source = header.GetSource ();
+        destination = header.GetDestination ();
+
+        //
+        // If the length/type is less than 1500, it corresponds to a length 
+        // interpretation packet.  In this case, it is an 802.3 packet and 
+        // will also have an 802.2 LLC header.  If greater than 1500, we
+        // find the protocol number (Ethernet type) directly.
+        //
+        if (header.GetLengthType () <= 1500)
+        {
+            DC_ASSERT (packet->GetSize () >= header.GetLengthType ());
+            uint32_t padlen = packet->GetSize () - header.GetLengthType ();
+            DC_ASSERT (padlen <= 46);
+            if (padlen > 0)
+            {
+                packet->RemoveAtEnd (padlen);
+            }
+
+            LlcSnapHeader llc;
+            packet->RemoveHeader (llc);
+            protocol = llc.GetType ();
+        }
+        else
+        {
+            protocol = header.GetLengthType ();
+        }
     }
 
+    DC_LOG_LOGIC ("Pkt source is " << source);
+    DC_LOG_LOGIC ("Pkt destination is " << destination);
+
     //
     // Classify the packet based on its destination.
     //
     PacketType packetType;
 
-    if (header.GetDestination ().IsBroadcast ())
+    if (destination.IsBroadcast ())
     {
         packetType = PACKET_BROADCAST;
     }
-    else if (header.GetDestination ().IsGroup ())
+    else if (destination.IsGroup ())
     {
         packetType = PACKET_MULTICAST;
     }
-    else if (header.GetDestination () == m_address)
+    else if (destination == m_address)
     {
         packetType = PACKET_HOST;
     }
@@ -733,16 +1367,32 @@ DCCsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<DCCsmaNetDevice> senderDevice)
         packetType = PACKET_OTHERHOST;
     }
 
+    if (!m_intRxCallback.IsNull ())
+    {
+        DCIntTag tag;
+        if (packet->PeekPacketTag (tag))
+        {
+            m_intRxCallback (packet, tag.GetRecords (), tag.GetHops ());
+        }
+    }
+
     // 
     // For all kinds of packetType we receive, we hit the promiscuous sniffer
     // hook and pass a copy up to the promiscuous callback.  Pass a copy to 
     // make sure that nobody messes with our packet.
     //
     m_promiscSnifferTrace (originalPacket);
-    if (!m_promiscRxCallback.IsNull ())
+    if (m_bridge || !m_promiscRxCallback.IsNull ())
     {
         m_macPromiscRxTrace (originalPacket);
-        m_promiscRxCallback (this, packet, protocol, header.GetSource (), header.GetDestination (), packetType);
+    }
+    if (m_bridge)
+    {
+        m_bridge->ReceiveFromPort (this, packet, protocol, source, destination, packetType);
+    }
+    if (!m_promiscRxCallback.IsNull ())
+    {
+        m_promiscRxCallback (this, packet, protocol, source, destination, packetType);
     }
 
     //
@@ -754,21 +1404,23 @@ DCCsmaNetDevice::Receive (Ptr<Packet> packet, Ptr<DCCsmaNetDevice> senderDevice)
     {
         m_snifferTrace (originalPacket);
         m_macRxTrace (originalPacket);
-        m_rxCallback (this, packet, protocol, header.GetSource ());
+        if (!m_pktProcHook.rxSucess.IsNull())
+            m_pktProcHook.rxSucess(originalPacket);
+        m_rxCallback (this, packet, protocol, source);
     }
 }
 
 Ptr<Queue>
 DCCsmaNetDevice::GetQueue (void) const 
 { 
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_queue;
 }
 
 void
 DCCsmaNetDevice::NotifyLinkUp (void)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_linkUp = true;
     m_linkChangeCallbacks ();
 }
@@ -776,77 +1428,77 @@ DCCsmaNetDevice::NotifyLinkUp (void)
 void
 DCCsmaNetDevice::SetIfIndex (const uint32_t index)
 {
-    NS_LOG_FUNCTION (index);
+    DC_LOG_FUNCTION (index);
     m_ifIndex = index;
 }
 
 uint32_t
 DCCsmaNetDevice::GetIfIndex (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_ifIndex;
 }
 
 Ptr<Channel>
 DCCsmaNetDevice::GetChannel (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_channel;
 }
 
 void
 DCCsmaNetDevice::SetAddress (Address address)
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     m_address = Mac48Address::ConvertFrom (address);
 }
 
 Address
 DCCsmaNetDevice::GetAddress (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_address;
 }
 
 bool
 DCCsmaNetDevice::IsLinkUp (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_linkUp;
 }
 
 void
 DCCsmaNetDevice::AddLinkChangeCallback (Callback<void> callback)
 {
-    NS_LOG_FUNCTION (&callback);
+    DC_LOG_FUNCTION (&callback);
     m_linkChangeCallbacks.ConnectWithoutContext (callback);
 }
 
 bool
 DCCsmaNetDevice::IsBroadcast (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
 Address
 DCCsmaNetDevice::GetBroadcast (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return Mac48Address ("ff:ff:ff:ff:ff:ff");
 }
 
 bool
 DCCsmaNetDevice::IsMulticast (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
 Address
 DCCsmaNetDevice::GetMulticast (Ipv4Address multicastGroup) const
 {
-    NS_LOG_FUNCTION (multicastGroup);
+    DC_LOG_FUNCTION (multicastGroup);
 
     Mac48Address ad = Mac48Address::GetMulticast (multicastGroup);
 
@@ -855,7 +1507,7 @@ DCCsmaNetDevice::GetMulticast (Ipv4Address multicastGroup) const
     // use it by just returning the EUI-48 address which is automagically converted
     // to an Address.
     //
-    NS_LOG_LOGIC ("multicast address is " << ad);
+    DC_LOG_LOGIC ("multicast address is " << ad);
 
     return ad;
 }
@@ -863,21 +1515,21 @@ DCCsmaNetDevice::GetMulticast (Ipv4Address multicastGroup) const
 bool
 DCCsmaNetDevice::IsPointToPoint (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return false;
 }
 
 bool
 DCCsmaNetDevice::IsBridge (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return false;
 }
 
 bool
 DCCsmaNetDevice::Send (Ptr<Packet> packet,const Address& dest, uint16_t protocolNumber)
 {
-    NS_LOG_FUNCTION (packet << dest << protocolNumber);
+    DC_LOG_FUNCTION (packet << dest << protocolNumber);
     Mac48Address addr = Mac48Address::ConvertFrom(dest);
     if (m_forward)
         addr = m_forward->RedirectDest(m_enableArp, packet, addr, protocolNumber);
@@ -887,18 +1539,18 @@ DCCsmaNetDevice::Send (Ptr<Packet> packet,const Address& dest, uint16_t protocol
 bool
 DCCsmaNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
 {
-    NS_LOG_FUNCTION (packet << src << dest << protocolNumber);
-    NS_LOG_LOGIC ("packet =" << packet);
-    NS_LOG_LOGIC ("UID is " << packet->GetUid () << ")");
+    DC_LOG_FUNCTION (packet << src << dest << protocolNumber);
+    DC_LOG_LOGIC ("packet =" << packet);
+    DC_LOG_LOGIC ("UID is " << packet->GetUid () << ")");
 
-    NS_ASSERT (IsLinkUp ());
+    DC_ASSERT (IsLinkUp ());
 
     //
     // Only transmit if send side of net device is enabled
     //
     if (IsSendEnabled () == false)
     {
-        NS_LOG_LOGIC ("Send side disabled, packet (" << packet << ") drop");
+        DC_LOG_LOGIC ("Send side disabled, packet (" << packet << ") drop");
         if (!m_pktProcHook.txDrop.IsNull())
             m_pktProcHook.txDrop (packet);
         m_macTxDropTrace (packet);
@@ -907,14 +1559,230 @@ DCCsmaNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address
 
     Mac48Address destination = Mac48Address::ConvertFrom (dest);
     Mac48Address source = Mac48Address::ConvertFrom (src);
+
+    //
+    // A super-segment from the IP stack, see SetGsoSize
+    //
+    if (m_gsoSize > m_mtu && protocolNumber == 0x0800 && packet->GetSize () > m_mtu)
+    {
+        bool tcp;
+        uint32_t headers = GetL3HeaderSize (packet, tcp);
+        if (headers > 0 && !tcp)
+        {
+            return SendFragments (packet, src, dest, protocolNumber);
+        }
+        if (tcp && headers < m_mtu)
+        {
+            if (m_gsoMode == GSO_SOFTWARE)
+            {
+                return SendSegments (packet, src, dest, protocolNumber);
+            }
+            uint32_t mss = m_mtu - headers;
+            uint32_t segments = (packet->GetSize () - headers + mss - 1) / mss;
+            uint32_t l2 = m_encapMode == LLC ? 14 + 4 + 8 : 14 + 4;
+            packet->AddPacketTag (DCGsoTag (segments, (segments - 1) * (headers + l2)));
+        }
+    }
+
+    TagFrame (packet, packet, source, destination, protocolNumber);
+
     AddHeader (packet, source, destination, protocolNumber);
 
+    return EnqueueFrame (packet);
+}
+
+uint32_t
+DCCsmaNetDevice::GetL3HeaderSize (Ptr<const Packet> packet, bool &tcp) const
+{
+    //
+    // Read the IHL and protocol of the IPv4 header and the data offset of
+    // the TCP header, without deserializing them.
+    //
+    uint8_t buf[80];
+    uint32_t n = packet->CopyData (buf, sizeof (buf));
+    tcp = false;
+    if (n < 20 || (buf[0] >> 4) != 4)
+        return 0;
+    uint32_t ihl = (buf[0] & 0x0f) * 4;
+    if (buf[9] != 6 || n < ihl + 20)
+        return ihl;
+    tcp = true;
+    return ihl + (buf[ihl + 12] >> 4) * 4;
+}
+
+bool
+DCCsmaNetDevice::SendSegments (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
+{
+    DC_LOG_FUNCTION (packet << src << dest << protocolNumber);
+
+    Ptr<Packet> p = packet->Copy ();
+    Ipv4Header ip;
+    p->RemoveHeader (ip);
+    TcpHeader tcp;
+    p->RemoveHeader (tcp);
+
+    uint32_t mss = m_mtu - ip.GetSerializedSize () - tcp.GetSerializedSize ();
+    uint32_t size = p->GetSize ();
+    uint8_t flags = tcp.GetFlags ();
+    bool sent = true;
+    for (uint32_t offset = 0, i = 0;offset < size;offset += mss, i++)
+    {
+        uint32_t len = std::min (mss, size - offset);
+        // the fragment keeps the packet tags of the super-segment
+        Ptr<Packet> segment = p->CreateFragment (offset, len);
+
+        TcpHeader segTcp = tcp;
+        segTcp.SetSequenceNumber (tcp.GetSequenceNumber () + offset);
+        if (offset + len < size)
+        {
+            // FIN and PSH go with the last wire segment
+            segTcp.SetFlags (flags & ~(TcpHeader::FIN | TcpHeader::PSH));
+        }
+        if (Node::ChecksumEnabled ())
+        {
+            segTcp.EnableChecksums ();
+            segTcp.InitializeChecksum (ip.GetSource (), ip.GetDestination (), 6);
+        }
+        segment->AddHeader (segTcp);
+
+        Ipv4Header segIp = ip;
+        segIp.SetPayloadSize (segment->GetSize ());
+        segIp.SetIdentification (ip.GetIdentification () + i);
+        if (Node::ChecksumEnabled ())
+        {
+            segIp.EnableChecksum ();
+        }
+        segment->AddHeader (segIp);
+
+        sent = SendFrom (segment, src, dest, protocolNumber) && sent;
+    }
+    return sent;
+}
+
+bool
+DCCsmaNetDevice::SendFragments (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber)
+{
+    DC_LOG_FUNCTION (packet << src << dest << protocolNumber);
+
+    Ptr<Packet> p = packet->Copy ();
+    Ipv4Header ip;
+    p->RemoveHeader (ip);
+    if (ip.IsDontFragment ())
+    {
+        DC_LOG_LOGIC ("Larger than the MTU and may not fragment, packet (" << packet << ") drop");
+        if (!m_pktProcHook.txDrop.IsNull())
+            m_pktProcHook.txDrop (packet);
+        m_macTxDropTrace (packet);
+        return false;
+    }
+
+    // the packet may be a fragment already, its fragments continue it
+    uint32_t chunk = (m_mtu - ip.GetSerializedSize ()) & ~7u;
+    uint32_t size = p->GetSize ();
+    uint16_t base = ip.GetFragmentOffset ();
+    bool last = ip.IsLastFragment ();
+    bool sent = true;
+    for (uint32_t offset = 0;offset < size;offset += chunk)
+    {
+        uint32_t len = std::min (chunk, size - offset);
+        Ptr<Packet> fragment = p->CreateFragment (offset, len);
+
+        Ipv4Header fragIp = ip;
+        fragIp.SetPayloadSize (len);
+        fragIp.SetFragmentOffset (base + offset);
+        if (offset + len < size || !last)
+        {
+            fragIp.SetMoreFragments ();
+        }
+        else
+        {
+            fragIp.SetLastFragment ();
+        }
+        if (Node::ChecksumEnabled ())
+        {
+            fragIp.EnableChecksum ();
+        }
+        fragment->AddHeader (fragIp);
+
+        sent = SendFrom (fragment, src, dest, protocolNumber) && sent;
+    }
+    return sent;
+}
+
+void
+DCCsmaNetDevice::Frame (Ptr<Packet> packet, Mac48Address source, Mac48Address dest, uint16_t protocolNumber)
+{
+    DC_LOG_FUNCTION (packet << source << dest << protocolNumber);
+    AddHeader (packet, source, dest, protocolNumber);
+}
+
+bool
+DCCsmaNetDevice::HasSameFraming (Ptr<const DCCsmaNetDevice> other) const
+{
+    //
+    // The frame depends on the encapsulation and on whether the device
+    // sends header free frames, and on AddHeader if a subclass overrides it.
+    //
+    return other->m_encapMode == m_encapMode
+        && other->m_sendHeaderFree == m_sendHeaderFree
+        && other->GetInstanceTypeId () == GetInstanceTypeId ();
+}
+
+bool
+DCCsmaNetDevice::SendFramed (Ptr<Packet> frame, Ptr<const Packet> payload,
+                             Mac48Address source, Mac48Address dest, uint16_t protocolNumber)
+{
+    DC_LOG_FUNCTION (frame << source << dest << protocolNumber);
+
+    DC_ASSERT (IsLinkUp ());
+
+    if (IsSendEnabled () == false)
+    {
+        DC_LOG_LOGIC ("Send side disabled, packet (" << frame << ") drop");
+        if (!m_pktProcHook.txDrop.IsNull())
+            m_pktProcHook.txDrop (frame);
+        m_macTxDropTrace (frame);
+        return false;
+    }
+
+    TagFrame (frame, payload, source, dest, protocolNumber);
+
+    return EnqueueFrame (frame);
+}
+
+void
+DCCsmaNetDevice::TagFrame (Ptr<Packet> frame, Ptr<const Packet> payload,
+                           Mac48Address source, Mac48Address dest, uint16_t protocolNumber)
+{
+    if (m_classifier)
+    {
+        DCClassTag tag;
+        frame->RemovePacketTag (tag);
+        tag.SetClass (m_classifier->Classify (payload, source, dest, protocolNumber));
+        frame->AddPacketTag (tag);
+    }
+
+    if (m_intMaxHops > 0)
+    {
+        DCIntTag tag;
+        if (!frame->PeekPacketTag (tag))
+            frame->AddPacketTag (DCIntTag (m_intMaxHops));
+    }
+
+    StampMeta (frame, source, dest, protocolNumber);
+}
+
+bool
+DCCsmaNetDevice::EnqueueFrame (Ptr<Packet> packet)
+{
     m_macTxTrace (packet);
 
+    bool idle = m_txMachineState == READY && m_queue->IsEmpty ();
+
     if (!m_pktProcHook.txPreEnqueue.IsNull()
             && !m_pktProcHook.txPreEnqueue(this,m_queue,packet))
     {
-        NS_LOG_LOGIC ("ProcPacketHook dicede to drop a packet " << packet);
+        DC_LOG_LOGIC ("ProcPacketHook dicede to drop a packet " << packet);
         return false;
     }
 
@@ -924,7 +1792,7 @@ DCCsmaNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address
     //
     if (m_queue->Enqueue (packet) == false)
     {
-        NS_LOG_LOGIC ("Enqueue failed, packet (" << packet << ") drop");
+        DC_LOG_LOGIC ("Enqueue failed, packet (" << packet << ") drop");
         if (!m_pktProcHook.txDrop.IsNull())
             m_pktProcHook.txDrop(packet);
         m_macTxDropTrace (packet);
@@ -944,26 +1812,60 @@ DCCsmaNetDevice::SendFrom (Ptr<Packet> packet, const Address& src, const Address
       if (m_queue->IsEmpty () == false)
       {
           m_currentPkt = m_queue->Dequeue ();
-          NS_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::SendFrom(): IsEmpty false but no Packet on queue?");
-          m_promiscSnifferTrace (m_currentPkt);
-          m_snifferTrace (m_currentPkt);
+          DC_ASSERT_MSG (m_currentPkt != 0, "DCCsmaNetDevice::EnqueueFrame(): IsEmpty false but no Packet on queue?");
+          Sniff (m_currentPkt);
+          m_txIdleStart = idle;
           TransmitStart ();
       }
     }
     return true;
 }
 
+void
+DCCsmaNetDevice::StampMeta (Ptr<Packet> packet, Mac48Address source, Mac48Address dest, uint16_t protocolNumber)
+{
+    //
+    // Only the device of a vm stamps, the frames it sends are new. The
+    // node and its tenant are looked up again after the tenants change.
+    //
+    if (m_metaGeneration != DCTenantList::GetGeneration ())
+    {
+        Ptr<DCVm> vm = DynamicCast<DCVm> (DCNodeMapper::GetDCNode (m_node));
+        m_metaStamp = vm != 0;
+        m_metaTenant = 0;
+        if (vm)
+        {
+            Ptr<DCTenant> tenant = DCTenantList::GetDCTenant (vm);
+            for (uint32_t i = 0;tenant && i < DCTenantList::GetNDCTenants ();i++)
+            {
+                if (DCTenantList::GetDCTenant (i) == tenant)
+                    m_metaTenant = i + 1;
+            }
+        }
+        m_metaGeneration = DCTenantList::GetGeneration ();
+    }
+    if (!m_metaStamp)
+        return;
+
+    DCMetaTag tag;
+    if (packet->PeekPacketTag (tag))
+        return;
+    DCFlowMonitor::FlowKey key;
+    DCFlowMonitor::ParsePayloadKey (packet, source, dest, protocolNumber, key);
+    packet->AddPacketTag (DCMetaTag (DCFlowMonitor::KeyHash (key), m_metaTenant, Simulator::Now ()));
+}
+
 Ptr<Node>
 DCCsmaNetDevice::GetNode (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_node;
 }
 
 void
 DCCsmaNetDevice::SetNode (Ptr<Node> node)
 {
-    NS_LOG_FUNCTION (node);
+    DC_LOG_FUNCTION (node);
 
     m_node = node;
 }
@@ -971,14 +1873,14 @@ DCCsmaNetDevice::SetNode (Ptr<Node> node)
 bool
 DCCsmaNetDevice::NeedsArp (void) const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return m_enableArp;
 }
 
 void
 DCCsmaNetDevice::SetReceiveCallback (NetDevice::ReceiveCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_rxCallback = cb;
 }
 
@@ -986,64 +1888,108 @@ Address DCCsmaNetDevice::GetMulticast (Ipv6Address addr) const
 {
     Mac48Address ad = Mac48Address::GetMulticast (addr);
 
-    NS_LOG_LOGIC ("MAC IPv6 multicast address is " << ad);
+    DC_LOG_LOGIC ("MAC IPv6 multicast address is " << ad);
     return ad;
 }
 
 void
 DCCsmaNetDevice::SetTxPreEnqueueCallback (DCCsmaNetDevice::TxPreEnqueueCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_pktProcHook.txPreEnqueue = cb;
 }
 
 void
 DCCsmaNetDevice::SetTxPostEnqueueCallback (DCCsmaNetDevice::TxPostEnqueueCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_pktProcHook.txPostEnqueue = cb;
 }
 
 void
 DCCsmaNetDevice::SetTxSentSucessCallback (DCCsmaNetDevice::TxSentSucessCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_pktProcHook.txSentSucess = cb;
 }
 
 void
 DCCsmaNetDevice::SetTxDropCallback (DCCsmaNetDevice::TxDropCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_pktProcHook.txDrop = cb;
 }
 
 void
 DCCsmaNetDevice:: SetRxDropCallback (DCCsmaNetDevice::RxDropCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_pktProcHook.rxDrop = cb;
 }
 
+void
+DCCsmaNetDevice::SetRxSucessCallback (DCCsmaNetDevice::RxSucessCallback cb)
+{
+    DC_LOG_FUNCTION (&cb);
+    m_pktProcHook.rxSucess = cb;
+}
+
 void
 DCCsmaNetDevice::SetPromiscReceiveCallback (NetDevice::PromiscReceiveCallback cb)
 {
-    NS_LOG_FUNCTION (&cb);
+    DC_LOG_FUNCTION (&cb);
     m_promiscRxCallback = cb;
 }
 
 void 
 DCCsmaNetDevice::SetForward (Ptr<DCPointForward> forward)
 {
-    NS_LOG_FUNCTION_NOARGS ();
-    NS_ASSERT_MSG (forward, "DCCsmaNetDevice::SetForward(): forward == NULL!");
+    DC_LOG_FUNCTION_NOARGS ();
+    DC_ASSERT_MSG (forward, "DCCsmaNetDevice::SetForward(): forward == NULL!");
     m_forward = forward;
 }
 
+void
+DCCsmaNetDevice::SetClassifier (Ptr<DCPacketClassifier> classifier)
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    m_classifier = classifier;
+}
+
+void
+DCCsmaNetDevice::SetCutThroughBytes (uint32_t bytes)
+{
+    DC_LOG_FUNCTION (bytes);
+    m_cutThroughBytes = bytes;
+}
+
+uint32_t
+DCCsmaNetDevice::GetCutThroughBytes (void) const
+{
+    return m_cutThroughBytes;
+}
+
+double
+DCCsmaNetDevice::GetTxUtilization (void) const
+{
+    double window = m_utilWindow.GetSeconds ();
+    double elapsed = (Simulator::Now () - m_utilUpdated).GetSeconds ();
+    if (window <= 0 || elapsed >= window) return 0;
+    double u = m_util * (1 - elapsed / window);
+    return u < 1 ? u : 1;
+}
+
+void
+DCCsmaNetDevice::SetIntReceiveCallback (IntReceiveCallback cb)
+{
+    DC_LOG_FUNCTION_NOARGS ();
+    m_intRxCallback = cb;
+}
+
 bool
 DCCsmaNetDevice::SupportsSendFrom () const
 {
-    NS_LOG_FUNCTION_NOARGS ();
+    DC_LOG_FUNCTION_NOARGS ();
     return true;
 }
 
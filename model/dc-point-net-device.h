@@ -14,6 +14,7 @@
 #include "ns3/ptr.h"
 #include "ns3/callback.h"
 #include "ns3/mac48-address.h"
+#include "ns3/tag.h"
 #include "dc-point-net-device-base.h"
 #include "dc-backoff.h"
 
@@ -24,9 +25,109 @@ class DCPointChannelBase;
 class DCCsmaChannel;
 class ErrorModel;
 class DCPointForward;
+class DCPacketClassifier;
+class DCIntRecord;
+class DCCsmaBridgeNetDevice;
+class DCPacketTrain;
+class DCCaptureFilter;
 
 #define __DEBUG_POINT_DEVICE__
 
+/**
+ * \ingroup datacenter
+ *
+ * \brief The L2 addressing of a frame sent without its Ethernet header.
+ *
+ * Added by a DCCsmaNetDevice in HeaderFreeL2 mode instead of the Ethernet
+ * header, the LLC/SNAP header, the padding and the trailer. The bytes they
+ * would take are kept in the tag, so the frame is still serialized on the
+ * link for its real size (see GetFrameSize).
+ */
+class DCL2MetaTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCL2MetaTag ();
+    DCL2MetaTag (Mac48Address source, Mac48Address dest, uint16_t protocol, uint16_t overhead);
+
+    Mac48Address GetSource (void) const;
+    Mac48Address GetDestination (void) const;
+    uint16_t GetProtocol (void) const;
+    /**
+     * \return the bytes of the L2 headers, padding and trailer left out
+     */
+    uint16_t GetOverhead (void) const;
+
+    /**
+     * \return the size of the frame on the wire, with the L2 bytes left out
+     * by a header free sender and the headers of the wire segments of a
+     * super-segment (see DCGsoTag)
+     */
+    static uint32_t GetFrameSize (Ptr<const Packet> p);
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    Mac48Address m_source;
+    Mac48Address m_dest;
+    uint16_t m_protocol;
+    uint16_t m_overhead;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A super-segment carried as one frame, see
+ * DCCsmaNetDevice::SetGsoSize.
+ *
+ * Added by the device of a vm to a TCP segment larger than its MTU. The
+ * segment stands for the wire segments it would be cut in, the tag keeps
+ * their number and the bytes of the headers their copies would add, so
+ * the frame is serialized on every link for the size of the wire segments
+ * (see DCL2MetaTag::GetFrameSize).
+ *
+ * A queue counting packets should count a super-segment as its wire
+ * segments, CountSegments gives their number. DCEcnQueue and
+ * DCMultiClassQueue do, other queues in packet mode, such as
+ * DropTailQueue, count it as one packet: use them in byte mode.
+ */
+class DCGsoTag : public Tag
+{
+public:
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCGsoTag ();
+    DCGsoTag (uint16_t segments, uint32_t extraBytes);
+
+    uint16_t GetSegments (void) const;
+    /**
+     * \return the bytes of the L2, IP and TCP headers of every wire segment
+     * but the first
+     */
+    uint32_t GetExtraBytes (void) const;
+
+    /**
+     * \return the wire segments of a frame, 1 without the tag, for the
+     * queues that count packets
+     */
+    static uint32_t CountSegments (Ptr<const Packet> p);
+
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (TagBuffer i) const;
+    virtual void Deserialize (TagBuffer i);
+    virtual void Print (std::ostream &os) const;
+
+private:
+    uint16_t m_segments;
+    uint32_t m_extraBytes;
+};
+
 /** 
  * \defgroup csma DCCsmaNetDevice
  *
@@ -56,6 +157,22 @@ public:
         LLC,         /**< 802.2 LLC/SNAP Packet*/
     };
 
+    /**
+    * Enumeration of the transmit state machines.
+    */
+    enum TxMode {
+        CSMA,        /**< Carrier sense, backoff and an interframe gap event */
+        SWITCHED,    /**< Back to back frames on a full duplex link */
+    };
+
+    /**
+    * Enumeration of the ways to send a super-segment, see SetGsoSize.
+    */
+    enum GsoMode {
+        GSO_OFFLOAD,    /**< One frame standing for its wire segments */
+        GSO_SOFTWARE,   /**< Cut in wire segments by the device */
+    };
+
     /**
     * Construct a CsmaNetDevice
     *
@@ -79,6 +196,97 @@ public:
     */
     void SetInterframeGap (Time t);
 
+    /**
+    * Set the transmit state machine of the device.
+    *
+    * In SWITCHED mode the frames of the queue are serialized back to back,
+    * one event per frame: a frame is delivered at the end of its
+    * serialization and the next one starts an interframe gap later. The
+    * gap is 0 on a full duplex link, then the next frame is started by the
+    * end of the previous one and there is no TransmitReadyEvent. The
+    * device goes back to CSMA when it is attached to a half duplex
+    * channel, and still backs off if the channel is not idle.
+    *
+    * \param mode the transmit mode
+    */
+    void SetTxMode (DCCsmaNetDevice::TxMode mode);
+    DCCsmaNetDevice::TxMode GetTxMode (void) const;
+
+    /**
+    * Let the IP stack above hand TCP segments up to size bytes to the
+    * device, like a NIC doing TSO/GSO. Meant for the device of a vm, see
+    * DCHelper::SetVmDeviceAttribute, with the SegmentSize of TCP raised
+    * to match.
+    *
+    * GetMtu, and so the Mtu attribute, reports size, SetMtu still sets
+    * the MTU of the wire. A TCP segment larger than the MTU is sent as one frame carrying a
+    * DCGsoTag in GSO_OFFLOAD mode: every link is busy for the wire
+    * segments, but the hosts and switches handle one frame, and the
+    * receiving vm gets the whole segment, as after GRO. A queue drops the
+    * super-segment as a whole, and TCP acks it as one segment. In
+    * GSO_SOFTWARE mode the device cuts it in wire segments itself, the
+    * per-MTU simulation to validate GSO_OFFLOAD against.
+    *
+    * Only TCP is offloaded. The IP stack no longer fragments for the wire
+    * MTU, so the device fragments the other IP packets larger than the
+    * MTU itself, in both modes, and drops them if they may not fragment.
+    *
+    * See DCGsoTag for the queues in packet mode.
+    *
+    * \param size the largest segment, 0 to disable
+    */
+    void SetGsoSize (uint16_t size);
+    uint16_t GetGsoSize (void) const;
+    void SetGsoMode (DCCsmaNetDevice::GsoMode mode);
+    DCCsmaNetDevice::GsoMode GetGsoMode (void) const;
+
+    /**
+    * Send the frames without their L2 headers.
+    *
+    * The addresses and the protocol travel in a DCL2MetaTag, the receiver
+    * takes them from there instead of parsing and stripping the headers.
+    * A receiver not in this mode rebuilds the headers for its traces.
+    *
+    * The mode only applies between bridge ports: a device sends header
+    * free frames only if it and every other device of its channel are
+    * ports of a bridge, so a vm, or any other end point, keeps getting
+    * real frames. Set it with DCHelper::SetPortDeviceAttribute.
+    *
+    * \param enable true to leave the L2 headers out
+    */
+    void SetHeaderFreeL2 (bool enable);
+    bool GetHeaderFreeL2 (void) const;
+
+    /**
+    * Fire the Sniffer, PromiscSniffer and MacRx traces with real frames.
+    *
+    * In HeaderFreeL2 mode the device then rebuilds the L2 headers of a
+    * copy of each frame for these traces, the frame on the wire stays
+    * header free. Called by the capture helpers on the devices they
+    * trace, it costs a copy per frame.
+    *
+    * With the filter of the capture, the headers are only rebuilt for
+    * the frames it matches, from the addressing in the DCL2MetaTag: the
+    * others reach the traces header free, with their tag, and the sinks
+    * drop them. Captures with different filters on one device get all
+    * the frames rebuilt.
+    *
+    * \param filter the filter of the sinks, 0 if they take every frame
+    */
+    void EnableCapture (Ptr<DCCaptureFilter> filter = 0);
+
+    /**
+    * Hand the received frames to a bridge with a direct call.
+    *
+    * Set by DCCsmaBridgeNetDevice::AddBridgePort instead of a protocol
+    * handler of the node, so a frame reaches the bridge without the
+    * handler list of the node, and keeps its Mac48Address addresses. The
+    * promiscuous receive callback, if any, is still called.
+    *
+    * \param bridge the bridge owning this port, 0 to unbind
+    */
+    void SetBridge (DCCsmaBridgeNetDevice *bridge);
+
     /**
     * Set the backoff parameters used to determine the wait to retry
     * transmitting a packet when the channel is busy.
@@ -149,6 +357,49 @@ public:
     */
     void Receive (Ptr<Packet> p, Ptr<DCCsmaNetDevice> sender);
 
+    /**
+    * Receive a train of frames, see SetTrainLength. Called by the channel
+    * when the last bit of the last frame has arrived, the frames are
+    * received in order, GetRxTime tells when each one arrived.
+    *
+    * \param train the frames
+    * \param sender the CsmaNetDevice that transmitted the train
+    */
+    void ReceiveTrain (Ptr<DCPacketTrain> train, Ptr<DCCsmaNetDevice> sender);
+
+    /**
+    * \return the time the last bit of the frame being received arrived,
+    * earlier than now for the frames of a train
+    */
+    Time GetRxTime (void) const;
+
+    /**
+    * Send up to length back to back frames of one flow as one
+    * transmission, in Switched mode.
+    *
+    * When a frame starts and the next queued frames carry the DCMetaTag of
+    * the same flow, they are dequeued with it and the transmission ends
+    * with the last of them: one TransmitCompleteEvent and one receive
+    * event for the train instead of one per frame. The time of every frame
+    * is kept, the link is busy exactly as long as for the frames alone,
+    * but the receiver hands them up together when the last one arrives.
+    *
+    * Meant for throughput experiments on bulk flows, the extra latency
+    * of a frame is bounded by the length of the train. A frame the
+    * receiver takes in cut-through is never put in a train.
+    *
+    * The frames of a train leave the queue when the train starts, not
+    * when each of them starts, so the queue length seen by the queue
+    * itself and by DCQueueSampler is understated while a train is on the
+    * wire. No train is built when the queue is a DCEcnQueue or a
+    * DCMultiClassQueue with a shared buffer, whose marking and admission
+    * depend on that length.
+    *
+    * \param length the most frames of a train, 1 to send every frame alone
+    */
+    void SetTrainLength (uint32_t length);
+    uint32_t GetTrainLength (void) const;
+
     /**
     * Is the send side of the network device enabled
     *
@@ -199,15 +450,53 @@ public:
     typedef Callback<void, Ptr<const Packet> > TxSentSucessCallback;
     typedef Callback<void, Ptr<const Packet> > TxDropCallback;
     typedef Callback<void, Ptr<const Packet> > RxDropCallback;
+    typedef Callback<void, Ptr<const Packet> > RxSucessCallback;
 
     virtual void SetTxPreEnqueueCallback (TxPreEnqueueCallback cb);
     virtual void SetTxPostEnqueueCallback (TxPostEnqueueCallback cb);
     virtual void SetTxSentSucessCallback (TxSentSucessCallback cb);
     virtual void SetTxDropCallback (TxDropCallback cb);
     virtual void SetRxDropCallback (RxDropCallback cb);
+    virtual void SetRxSucessCallback (RxSucessCallback cb);
 
     virtual void SetForward (Ptr<DCPointForward> forward);
 
+    /**
+     * \brief Set the classifier giving the traffic class of sent packets.
+     *
+     * The class is stored in a DCClassTag before the packet is enqueued,
+     * see DCMultiClassQueue.
+     */
+    virtual void SetClassifier (Ptr<DCPacketClassifier> classifier);
+
+    /**
+     * \brief Receive frames in cut-through mode.
+     *
+     * A frame longer than bytes is handed up as soon as its first bytes
+     * have arrived instead of after its last bit. When it is forwarded
+     * to an idle port it is sent out at once, but not so fast that it
+     * would end before it has been received; when the port is busy it
+     * waits until it has been fully received (store-and-forward).
+     *
+     * \param bytes the bytes needed before forwarding, 0 disables
+     *        cut-through
+     */
+    void SetCutThroughBytes (uint32_t bytes);
+    uint32_t GetCutThroughBytes (void) const;
+
+    /**
+     * \return the busy fraction of the transmitter over the last
+     *         UtilizationWindow
+     */
+    double GetTxUtilization (void) const;
+
+    /**
+     * Called with the in-band telemetry records of a received frame
+     * carrying a DCIntTag, the records are in hop order.
+     */
+    typedef Callback<void, Ptr<const Packet>, const DCIntRecord *, uint32_t> IntReceiveCallback;
+    virtual void SetIntReceiveCallback (IntReceiveCallback cb);
+
     //
     // The following methods are inherited from NetDevice base class.
     //
@@ -281,6 +570,43 @@ public:
     virtual bool SendFrom (Ptr<Packet> packet, const Address& source, const Address& dest, 
                          uint16_t protocolNumber);
 
+    /**
+    * Add the headers and trailers of this device to a packet, to build a
+    * frame sent by SendFramed on this device or on any device with the
+    * same framing.
+    *
+    * A bridge flooding a frame builds it once, every port sends a copy
+    * sharing the bytes of the frame. ns-3 copies the bytes only if a copy
+    * is written afterwards, by an error model or an ECN mark.
+    *
+    * \param packet packet to frame
+    * \param source layer 2 source address
+    * \param dest layer 2 destination address
+    * \param protocolNumber protocol number
+    */
+    void Frame (Ptr<Packet> packet, Mac48Address source, Mac48Address dest, uint16_t protocolNumber);
+
+    /**
+    * \param other another device
+    * \return true if Frame of the other device builds the same frame
+    */
+    bool HasSameFraming (Ptr<const DCCsmaNetDevice> other) const;
+
+    /**
+    * Start sending a frame built by Frame down the channel. The packet
+    * classifier sees the payload, the frame gets the tags SendFrom would
+    * add.
+    *
+    * \param frame frame to send, owned by this device
+    * \param payload the packet the frame was built from
+    * \param source layer 2 source address
+    * \param dest layer 2 destination address
+    * \param protocolNumber protocol number
+    * \return true if successfull, false otherwise (drop, ...)
+    */
+    bool SendFramed (Ptr<Packet> frame, Ptr<const Packet> payload,
+                     Mac48Address source, Mac48Address dest, uint16_t protocolNumber);
+
     /**
     * Get the node to which this device is attached.
     *
@@ -353,8 +679,31 @@ protected:
     */
     virtual void AddHeader (Ptr<Packet> p, Mac48Address source, Mac48Address dest, uint16_t protocolNumber);
 
+    /**
+    * Serialize the Ethernet header, the LLC/SNAP header, the padding and
+    * the trailer, whatever the HeaderFreeL2 mode.
+    */
+    void AddL2Header (Ptr<Packet> p, Mac48Address source, Mac48Address dest, uint16_t protocolNumber);
+
 private:
 
+    /**
+    * Work out again whether the devices of the channel send header free
+    * frames, after a change of their mode, their bridge or the channel.
+    */
+    void UpdateHeaderFree (void);
+
+    /**
+    * Fire the Sniffer and PromiscSniffer traces for a frame being sent.
+    */
+    void Sniff (Ptr<const Packet> p);
+
+    /**
+    * \return true if the capture filter, if any, matches a header free
+    *         frame, from its payload and its DCL2MetaTag
+    */
+    bool CaptureMatch (Ptr<const Packet> payload, const DCL2MetaTag &meta) const;
+
     /**
     * Operator = is declared but not implemented.  This disables the assignment
     * operator for CsmaNetDevice objects.
@@ -479,6 +828,67 @@ protected:
     */
     TxMachineState m_txMachineState;
 
+    /**
+    * The transmit state machine in use.
+    * \see TxMode
+    */
+    TxMode m_txMode;
+
+    /**
+    * Whether the L2 headers are left out of sent frames.
+    * \see SetHeaderFreeL2
+    */
+    bool m_headerFreeL2;
+
+    /**
+    * Whether the L2 headers are left out of the frames sent now: the mode
+    * is set and the channel only links bridge ports.
+    * \see UpdateHeaderFree
+    */
+    bool m_sendHeaderFree;
+
+    /**
+    * Whether the traces get real frames in HeaderFreeL2 mode.
+    * \see EnableCapture
+    */
+    bool m_capture;
+
+    /**
+    * The filter of the captures, 0 to rebuild every frame.
+    * \see EnableCapture
+    */
+    Ptr<DCCaptureFilter> m_captureFilter;
+
+    /**
+    * The bridge owning this port, not a Ptr since the bridge holds the
+    * port.
+    * \see SetBridge
+    */
+    DCCsmaBridgeNetDevice *m_bridge;
+
+    /**
+    * The most frames of a train, the train in transmission if any, and
+    * the arrival time of the frame of a train being received.
+    * \see SetTrainLength
+    */
+    uint32_t m_trainLength;
+    Ptr<DCPacketTrain> m_train;
+    bool m_rxTrain;
+    Time m_rxTime;
+
+    /**
+    * Dequeue the frames following m_currentPkt in its train.
+    * \param first the transmission time of m_currentPkt
+    * \return the transmission time of the train
+    */
+    Time BuildTrain (Time first);
+
+    /**
+    * \return false if the queue marks or admits frames on its length,
+    * which a train would understate
+    */
+    bool QueueAllowsTrain (void) const;
+
     /**
     * The type of packet that should be created by the AddHeader
     * function and that should be processed by the ProcessHeader
@@ -500,6 +910,82 @@ protected:
     */
     Time m_tInterframeGap;
 
+    /**
+     * Bytes of a frame received before it is handed up, 0 for
+     * store-and-forward.
+     */
+    uint32_t m_cutThroughBytes;
+
+    /**
+     * Whether m_currentPkt arrived at an idle transmitter, so it may be
+     * sent out before it has been received completely.
+     */
+    bool m_txIdleStart;
+
+    /**
+     * In-band telemetry: hops recorded for frames sent by this device,
+     * and the sink of the records of received frames.
+     */
+    uint8_t m_intMaxHops;
+    IntReceiveCallback m_intRxCallback;
+
+    /**
+     * DCMetaTag: the DCTenantList generation the node was checked at, 0
+     * before, whether it is a vm whose frames are stamped, and the tenant
+     * id of the vm.
+     */
+    uint32_t m_metaGeneration;
+    bool m_metaStamp;
+    uint32_t m_metaTenant;
+
+    /**
+     * Stamp a DCMetaTag on a frame sent by a vm, see SendFrom.
+     */
+    void StampMeta (Ptr<Packet> packet, Mac48Address source, Mac48Address dest, uint16_t protocolNumber);
+
+    /**
+     * The largest segment accepted from above and how a segment larger
+     * than the MTU is sent.
+     * \see SetGsoSize
+     */
+    uint16_t m_gsoSize;
+    GsoMode m_gsoMode;
+
+    /**
+     * \brief Find the headers of an IPv4 packet.
+     * \param tcp true if it is a TCP segment
+     * \return the bytes of the IP and TCP headers, 0 if it is not IPv4
+     */
+    uint32_t GetL3HeaderSize (Ptr<const Packet> packet, bool &tcp) const;
+    /**
+     * Cut a TCP segment in wire segments and send them, GSO_SOFTWARE mode.
+     */
+    bool SendSegments (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber);
+    /**
+     * Cut an IP packet other than TCP in IP fragments for the wire MTU and
+     * send them, the job of the IP stack when it knew the MTU.
+     */
+    bool SendFragments (Ptr<Packet> packet, const Address& src, const Address& dest, uint16_t protocolNumber);
+
+    /**
+     * Add the class, INT and meta tags of SendFrom to a frame, the class
+     * of the payload.
+     */
+    void TagFrame (Ptr<Packet> frame, Ptr<const Packet> payload,
+                   Mac48Address source, Mac48Address dest, uint16_t protocolNumber);
+    /**
+     * Queue a frame and start its transmission if the device is idle, the
+     * end of SendFrom and SendFramed.
+     */
+    bool EnqueueFrame (Ptr<Packet> frame);
+
+    /**
+     * Transmitter utilization, busy seconds per window decayed linearly.
+     */
+    Time m_utilWindow;
+    double m_util;
+    Time m_utilUpdated;
+
     /**
     * Holds the backoff parameters and is used to calculate the next
     * backoff time to use when the channel is busy and the net device
@@ -730,11 +1216,13 @@ protected:
         TxSentSucessCallback txSentSucess;
         TxDropCallback txDrop;
         RxDropCallback rxDrop;
+        RxSucessCallback rxSucess;
     };
     PktProcHook m_pktProcHook;
 
     bool m_enableArp;
     Ptr<DCPointForward> m_forward;
+    Ptr<DCPacketClassifier> m_classifier;
 
 #ifdef __DEBUG_POINT_DEVICE__
     static int m_count;
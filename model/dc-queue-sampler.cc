@@ -0,0 +1,394 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <sstream>
+#include "ns3/log.h"
+#include "ns3/nstime.h"
+#include "ns3/uinteger.h"
+#include "ns3/simulator.h"
+#include "ns3/queue.h"
+#include "dc-node.h"
+#include "dc-node-mapper.h"
+#include "dc-point-net-device.h"
+#include "dc-queue-sampler.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCQueueSampler");
+
+namespace ns3 {
+
+DCQueueHistogram::DCQueueHistogram ()
+    : m_precision (0),
+      m_total (0),
+      m_sum (0),
+      m_max (0)
+{
+}
+
+void
+DCQueueHistogram::SetPrecision (uint32_t precision)
+{
+    NS_ASSERT_MSG (precision >= 1 && precision < 32,
+                   "DCQueueHistogram::SetPrecision(): bad precision " << precision);
+    m_precision = precision;
+    uint32_t half = 1u << (precision - 1);
+    m_counts.assign ((1u << precision) + (32 - precision) * half, 0);
+    m_total = 0;
+    m_sum = 0;
+    m_max = 0;
+}
+
+void
+DCQueueHistogram::Clear (void)
+{
+    m_counts.assign (m_counts.size (), 0);
+    m_total = 0;
+    m_sum = 0;
+    m_max = 0;
+}
+
+uint32_t
+DCQueueHistogram::GetIndex (uint32_t value) const
+{
+    if (value < (1u << m_precision))
+        return value;
+    uint32_t msb = 31 - __builtin_clz (value);
+    uint32_t half = 1u << (m_precision - 1);
+    uint32_t shift = msb - m_precision + 1;
+    return (1u << m_precision) + (msb - m_precision) * half + ((value >> shift) - half);
+}
+
+uint32_t
+DCQueueHistogram::GetUpperBound (uint32_t index) const
+{
+    if (index < (1u << m_precision))
+        return index;
+    uint32_t half = 1u << (m_precision - 1);
+    uint32_t k = index - (1u << m_precision);
+    uint32_t shift = k / half + 1;
+    uint64_t sub = k % half + half;
+    uint64_t bound = ((sub + 1) << shift) - 1;
+    return bound > 0xffffffffULL ? 0xffffffffU : (uint32_t)bound;
+}
+
+void
+DCQueueHistogram::Add (uint32_t value, uint64_t weight)
+{
+    if (weight == 0) return;
+    m_counts[GetIndex (value)] += weight;
+    m_total += weight;
+    m_sum += (double)value * weight;
+    if (value > m_max) m_max = value;
+}
+
+uint64_t
+DCQueueHistogram::GetTotalWeight (void) const
+{
+    return m_total;
+}
+
+double
+DCQueueHistogram::GetMean (void) const
+{
+    return m_total ? m_sum / m_total : 0;
+}
+
+uint32_t
+DCQueueHistogram::GetMax (void) const
+{
+    return m_max;
+}
+
+uint32_t
+DCQueueHistogram::GetPercentile (double q) const
+{
+    if (m_total == 0) return 0;
+    double target = q * m_total;
+    uint64_t seen = 0;
+    for (uint32_t i = 0;i < m_counts.size ();i++)
+    {
+        seen += m_counts[i];
+        if (seen > 0 && seen >= target)
+        {
+            uint32_t bound = GetUpperBound (i);
+            return bound < m_max ? bound : m_max;
+        }
+    }
+    return m_max;
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCQueueSampler);
+
+TypeId
+DCQueueSampler::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCQueueSampler")
+        .SetParent<Object> ()
+        .AddConstructor<DCQueueSampler> ()
+        .AddAttribute ("Interval",
+                       "The time of a sample of the time series, its peak depth is kept.",
+                       TimeValue (MicroSeconds (100)),
+                       MakeTimeAccessor (&DCQueueSampler::m_interval),
+                       MakeTimeChecker ())
+        .AddAttribute ("SeriesLength",
+                       "The samples kept per port, the oldest are overwritten.",
+                       UintegerValue (1024),
+                       MakeUintegerAccessor (&DCQueueSampler::m_seriesLength),
+                       MakeUintegerChecker<uint32_t> (1))
+        .AddAttribute ("Precision",
+                       "The bits of a value kept by the histograms, the error of a "
+                       "percentile is at most 2^(1-Precision).",
+                       UintegerValue (5),
+                       MakeUintegerAccessor (&DCQueueSampler::m_precision),
+                       MakeUintegerChecker<uint32_t> (1, 16))
+    ;
+    return tid;
+}
+
+DCQueueSampler::DCQueueSampler ()
+    : m_seriesLength (1024),
+      m_precision (5)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCQueueSampler::~DCQueueSampler ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCQueueSampler::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_ports.clear ();
+    Object::DoDispose ();
+}
+
+bool
+DCQueueSampler::AddDevice (Ptr<NetDevice> nd)
+{
+    NS_LOG_FUNCTION (this << nd);
+    Ptr<DCCsmaNetDevice> device = nd->GetObject<DCCsmaNetDevice> ();
+    if (device == 0)
+    {
+        NS_LOG_INFO ("DCQueueSampler::AddDevice(): Device " << nd << " not of type ns3::DCCsmaNetDevice");
+        return false;
+    }
+    Ptr<Queue> queue = device->GetQueue ();
+    if (queue == 0)
+    {
+        NS_LOG_INFO ("DCQueueSampler::AddDevice(): Device " << nd << " has no queue");
+        return false;
+    }
+
+    NS_ASSERT_MSG (m_interval.GetTimeStep () > 0, "DCQueueSampler::AddDevice(): Interval must be positive!");
+    m_ports.push_back (Port ());
+    Port &port = m_ports.back ();
+    port.device = nd;
+    port.bytes = queue->GetNBytes ();
+    port.packets = queue->GetNPackets ();
+    port.drops = 0;
+    port.last = Simulator::Now ().GetTimeStep ();
+    port.bytesHist.SetPrecision (m_precision);
+    port.packetsHist.SetPrecision (m_precision);
+    port.slot = -1;
+    port.peakBytes = 0;
+    port.peakPackets = 0;
+    port.series.resize (m_seriesLength);
+    port.nSamples = 0;
+
+    Ptr<DCQueueSamplerProbe> probe = CreateObject<DCQueueSamplerProbe> (this, m_ports.size () - 1);
+    queue->TraceConnectWithoutContext ("Enqueue", MakeCallback (&DCQueueSamplerProbe::Enqueue, probe));
+    queue->TraceConnectWithoutContext ("Dequeue", MakeCallback (&DCQueueSamplerProbe::Dequeue, probe));
+    queue->TraceConnectWithoutContext ("Drop", MakeCallback (&DCQueueSamplerProbe::Drop, probe));
+    return true;
+}
+
+uint32_t
+DCQueueSampler::GetNPorts (void) const
+{
+    return m_ports.size ();
+}
+
+const DCQueueHistogram&
+DCQueueSampler::GetBytesHistogram (uint32_t port) const
+{
+    return m_ports[port].bytesHist;
+}
+
+const DCQueueHistogram&
+DCQueueSampler::GetPacketsHistogram (uint32_t port) const
+{
+    return m_ports[port].packetsHist;
+}
+
+void
+DCQueueSampler::Account (Port &port, int64_t now)
+{
+    if (now <= port.last) return;
+    port.bytesHist.Add (port.bytes, now - port.last);
+    port.packetsHist.Add (port.packets, now - port.last);
+    port.last = now;
+}
+
+void
+DCQueueSampler::Change (Port &port, int32_t bytes, int32_t packets)
+{
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    Account (port, now);
+
+    int64_t slot = now / m_interval.GetTimeStep ();
+    if (slot != port.slot)
+    {
+        if (port.slot >= 0)
+        {
+            Sample &s = port.series[port.nSamples % port.series.size ()];
+            s.time = port.slot * m_interval.GetTimeStep ();
+            s.bytes = port.peakBytes;
+            s.packets = port.peakPackets;
+            port.nSamples++;
+        }
+        // the depth held from the last interval
+        port.slot = slot;
+        port.peakBytes = port.bytes;
+        port.peakPackets = port.packets;
+    }
+
+    // a drop of a packet the queue did not hold must not go below zero
+    port.bytes = (int64_t)port.bytes + bytes < 0 ? 0 : port.bytes + bytes;
+    port.packets = (int64_t)port.packets + packets < 0 ? 0 : port.packets + packets;
+    if (port.bytes > port.peakBytes) port.peakBytes = port.bytes;
+    if (port.packets > port.peakPackets) port.peakPackets = port.packets;
+}
+
+void
+DCQueueSampler::NotifyEnqueue (uint32_t port, Ptr<const Packet> p)
+{
+    Change (m_ports[port], p->GetSize (), 1);
+}
+
+void
+DCQueueSampler::NotifyDequeue (uint32_t port, Ptr<const Packet> p)
+{
+    Change (m_ports[port], -(int32_t)p->GetSize (), -1);
+}
+
+void
+DCQueueSampler::NotifyDrop (uint32_t port, Ptr<const Packet> p)
+{
+    // the Enqueue trace is fired before the queue decides to drop
+    m_ports[port].drops++;
+    Change (m_ports[port], -(int32_t)p->GetSize (), -1);
+}
+
+void
+DCQueueSampler::Update (void)
+{
+    int64_t now = Simulator::Now ().GetTimeStep ();
+    for (uint32_t i = 0;i < m_ports.size ();i++)
+        Account (m_ports[i], now);
+}
+
+static std::string
+PortName (Ptr<NetDevice> nd)
+{
+    std::ostringstream name;
+    Ptr<Node> node = nd->GetNode ();
+    Ptr<DCNode> dcNode = DCNodeMapper::GetDCNode (node);
+    if (dcNode && !dcNode->GetName ().empty ())
+        name << dcNode->GetName ();
+    else
+        name << "node" << node->GetId ();
+    name << "/port" << nd->GetIfIndex ();
+    return name.str ();
+}
+
+void
+DCQueueSampler::SerializePorts (std::ostream &os)
+{
+    Update ();
+    os << "port,name,bytes_mean,bytes_p50,bytes_p99,bytes_p999,bytes_max,"
+       << "pkts_mean,pkts_p50,pkts_p99,pkts_p999,pkts_max,drops" << std::endl;
+    for (uint32_t i = 0;i < m_ports.size ();i++)
+    {
+        const Port &port = m_ports[i];
+        const DCQueueHistogram &b = port.bytesHist;
+        const DCQueueHistogram &n = port.packetsHist;
+        os << i << "," << PortName (port.device)
+           << "," << b.GetMean () << "," << b.GetPercentile (0.5) << "," << b.GetPercentile (0.99)
+           << "," << b.GetPercentile (0.999) << "," << b.GetMax ()
+           << "," << n.GetMean () << "," << n.GetPercentile (0.5) << "," << n.GetPercentile (0.99)
+           << "," << n.GetPercentile (0.999) << "," << n.GetMax ()
+           << "," << port.drops << std::endl;
+    }
+}
+
+void
+DCQueueSampler::SerializeSeries (std::ostream &os, uint32_t port)
+{
+    NS_ASSERT_MSG (port < m_ports.size (), "DCQueueSampler::SerializeSeries(): no port " << port);
+    Update ();
+    const Port &p = m_ports[port];
+    os << "time_us,bytes,pkts" << std::endl;
+    uint64_t size = p.series.size ();
+    uint64_t first = p.nSamples > size ? p.nSamples - size : 0;
+    for (uint64_t i = first;i < p.nSamples;i++)
+    {
+        const Sample &s = p.series[i % size];
+        os << Time (s.time).GetMicroSeconds () << "," << s.bytes << "," << s.packets << std::endl;
+    }
+    // the interval still open
+    if (p.slot >= 0)
+    {
+        os << Time (p.slot * m_interval.GetTimeStep ()).GetMicroSeconds ()
+           << "," << p.peakBytes << "," << p.peakPackets << std::endl;
+    }
+}
+
+NS_OBJECT_ENSURE_REGISTERED (DCQueueSamplerProbe);
+
+TypeId
+DCQueueSamplerProbe::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCQueueSamplerProbe")
+        .SetParent<Object> ()
+        .AddConstructor<DCQueueSamplerProbe> ()
+    ;
+    return tid;
+}
+
+DCQueueSamplerProbe::DCQueueSamplerProbe ()
+    : m_port (0)
+{
+}
+
+DCQueueSamplerProbe::DCQueueSamplerProbe (Ptr<DCQueueSampler> sampler, uint32_t port)
+    : m_sampler (sampler),
+      m_port (port)
+{
+}
+
+void
+DCQueueSamplerProbe::DoDispose (void)
+{
+    m_sampler = 0;
+    Object::DoDispose ();
+}
+
+void
+DCQueueSamplerProbe::Enqueue (Ptr<const Packet> p)
+{
+    m_sampler->NotifyEnqueue (m_port, p);
+}
+
+void
+DCQueueSamplerProbe::Dequeue (Ptr<const Packet> p)
+{
+    m_sampler->NotifyDequeue (m_port, p);
+}
+
+void
+DCQueueSamplerProbe::Drop (Ptr<const Packet> p)
+{
+    m_sampler->NotifyDrop (m_port, p);
+}
+
+} // namespace ns3
@@ -0,0 +1,172 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_QUEUE_SAMPLER_H__
+#define __DC_QUEUE_SAMPLER_H__
+
+#include <vector>
+#include <ostream>
+#include "ns3/object.h"
+#include "ns3/packet.h"
+#include "ns3/nstime.h"
+#include "ns3/net-device.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A log-linear histogram of fixed size, in the way of HdrHistogram.
+ *
+ * The values below 2^precision have a bucket each, above that every power
+ * of two is cut in 2^(precision-1) buckets, so the relative error of a
+ * value read back is at most 2^(1-precision). All of uint32_t fits in
+ * 2^precision + (32-precision) * 2^(precision-1) buckets.
+ */
+class DCQueueHistogram
+{
+public:
+    DCQueueHistogram ();
+
+    void SetPrecision (uint32_t precision);
+    void Add (uint32_t value, uint64_t weight);
+    void Clear (void);
+
+    uint64_t GetTotalWeight (void) const;
+    double GetMean (void) const;
+    uint32_t GetMax (void) const;
+    /**
+     * \return the highest value of the bucket holding quantile q, no more
+     * than the maximum
+     */
+    uint32_t GetPercentile (double q) const;
+
+private:
+    uint32_t GetIndex (uint32_t value) const;
+    uint32_t GetUpperBound (uint32_t index) const;
+
+    uint32_t m_precision;
+    std::vector<uint64_t> m_counts;
+    uint64_t m_total;
+    double m_sum;
+    uint32_t m_max;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief Sample the depth of the queues of DCCsmaNetDevices.
+ *
+ * The depth in bytes and in packets is followed from the Enqueue, Dequeue
+ * and Drop traces of the queue, nothing is scheduled. Every depth is
+ * counted in the histograms for the time it lasted, so the percentiles
+ * are fractions of the simulated time, not of the packets.
+ *
+ * The time series keeps the peak depth of every Interval in a ring of
+ * SeriesLength samples, the oldest are overwritten. An interval without
+ * any event is not written, the depth stayed the one of the last sample.
+ *
+ * The memory of a port is fixed when it is added.
+ */
+class DCQueueSampler : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCQueueSampler ();
+    virtual ~DCQueueSampler ();
+
+    /**
+     * \brief Connect to the traces of the queue of the device.
+     * \return false if the device is not a DCCsmaNetDevice
+     */
+    bool AddDevice (Ptr<NetDevice> nd);
+    uint32_t GetNPorts (void) const;
+
+    /**
+     * \brief Close the current period of every port at the current time.
+     * Called by the Serialize methods.
+     */
+    void Update (void);
+
+    const DCQueueHistogram& GetBytesHistogram (uint32_t port) const;
+    const DCQueueHistogram& GetPacketsHistogram (uint32_t port) const;
+
+    /**
+     * \brief Write one line per port, in CSV: the mean, median, 99th,
+     * 99.9th percentile and maximum of the depth in bytes and in packets,
+     * and the drops.
+     */
+    void SerializePorts (std::ostream &os);
+    /**
+     * \brief Write the time series of a port, in CSV, oldest first.
+     */
+    void SerializeSeries (std::ostream &os, uint32_t port);
+
+    // called by the probes
+    void NotifyEnqueue (uint32_t port, Ptr<const Packet> p);
+    void NotifyDequeue (uint32_t port, Ptr<const Packet> p);
+    void NotifyDrop (uint32_t port, Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    struct Sample
+    {
+        int64_t time;
+        uint32_t bytes;
+        uint32_t packets;
+    };
+
+    struct Port
+    {
+        Ptr<NetDevice> device;
+        uint32_t bytes;
+        uint32_t packets;
+        uint64_t drops;
+        int64_t last;           // time of the last change
+        DCQueueHistogram bytesHist;
+        DCQueueHistogram packetsHist;
+        int64_t slot;           // current interval
+        uint32_t peakBytes;
+        uint32_t peakPackets;
+        std::vector<Sample> series;
+        uint64_t nSamples;
+    };
+
+    void Account (Port &port, int64_t now);
+    void Change (Port &port, int32_t bytes, int32_t packets);
+
+    Time m_interval;
+    uint32_t m_seriesLength;
+    uint32_t m_precision;
+    std::vector<Port> m_ports;
+};
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The queue trace sinks of one port of a DCQueueSampler.
+ */
+class DCQueueSamplerProbe : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCQueueSamplerProbe ();
+    DCQueueSamplerProbe (Ptr<DCQueueSampler> sampler, uint32_t port);
+
+    void Enqueue (Ptr<const Packet> p);
+    void Dequeue (Ptr<const Packet> p);
+    void Drop (Ptr<const Packet> p);
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    Ptr<DCQueueSampler> m_sampler;
+    uint32_t m_port;
+};
+
+} // namespace ns3
+
+#endif /* __DC_QUEUE_SAMPLER_H__ */
@@ -0,0 +1,154 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include "ns3/log.h"
+#include "dc-rdma-header.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCRdmaHeader");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCRdmaHeader);
+
+TypeId
+DCRdmaHeader::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCRdmaHeader")
+        .SetParent<Header> ()
+        .AddConstructor<DCRdmaHeader> ()
+    ;
+    return tid;
+}
+
+TypeId
+DCRdmaHeader::GetInstanceTypeId (void) const
+{
+    return GetTypeId ();
+}
+
+DCRdmaHeader::DCRdmaHeader ()
+    : m_opcode (DATA),
+      m_flags (0),
+      m_destQpn (0),
+      m_psn (0)
+{
+}
+
+DCRdmaHeader::~DCRdmaHeader ()
+{
+}
+
+void
+DCRdmaHeader::SetOpcode (DCRdmaHeader::Opcode opcode)
+{
+    m_opcode = opcode;
+}
+
+DCRdmaHeader::Opcode
+DCRdmaHeader::GetOpcode (void) const
+{
+    return (Opcode)m_opcode;
+}
+
+void
+DCRdmaHeader::SetDestQpn (uint32_t qpn)
+{
+    m_destQpn = qpn;
+}
+
+uint32_t
+DCRdmaHeader::GetDestQpn (void) const
+{
+    return m_destQpn;
+}
+
+void
+DCRdmaHeader::SetPsn (uint32_t psn)
+{
+    m_psn = psn;
+}
+
+uint32_t
+DCRdmaHeader::GetPsn (void) const
+{
+    return m_psn;
+}
+
+void
+DCRdmaHeader::SetFlags (uint8_t flags)
+{
+    m_flags = flags;
+}
+
+uint8_t
+DCRdmaHeader::GetFlags (void) const
+{
+    return m_flags;
+}
+
+bool
+DCRdmaHeader::IsEct (void) const
+{
+    return (m_flags & FLAG_ECT) != 0;
+}
+
+bool
+DCRdmaHeader::IsCe (void) const
+{
+    return (m_flags & FLAG_CE) != 0;
+}
+
+bool
+DCRdmaHeader::IsAckReq (void) const
+{
+    return (m_flags & FLAG_ACKREQ) != 0;
+}
+
+bool
+DCRdmaHeader::MarkCe (void)
+{
+    if (!IsEct ()) return false;
+    m_flags |= FLAG_CE;
+    return true;
+}
+
+void
+DCRdmaHeader::Print (std::ostream &os) const
+{
+    const char *names[] = {"DATA", "ACK", "NAK", "CNP"};
+    os << (m_opcode < 4 ? names[m_opcode] : "UNKNOWN")
+       << " qpn=" << m_destQpn
+       << " psn=" << m_psn;
+    if (IsEct ()) os << " ect";
+    if (IsCe ()) os << " ce";
+    if (IsAckReq ()) os << " ackreq";
+}
+
+uint32_t
+DCRdmaHeader::GetSerializedSize (void) const
+{
+    return 12;
+}
+
+void
+DCRdmaHeader::Serialize (Buffer::Iterator start) const
+{
+    Buffer::Iterator i = start;
+    i.WriteU8 (m_opcode);
+    i.WriteU8 (m_flags);
+    i.WriteU16 (0);
+    i.WriteHtonU32 (m_destQpn);
+    i.WriteHtonU32 (m_psn);
+}
+
+uint32_t
+DCRdmaHeader::Deserialize (Buffer::Iterator start)
+{
+    Buffer::Iterator i = start;
+    m_opcode = i.ReadU8 ();
+    m_flags = i.ReadU8 ();
+    i.ReadU16 ();
+    m_destQpn = i.ReadNtohU32 ();
+    m_psn = i.ReadNtohU32 ();
+    return GetSerializedSize ();
+}
+
+} // namespace ns3
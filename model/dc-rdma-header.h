@@ -0,0 +1,79 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_RDMA_HEADER_H__
+#define __DC_RDMA_HEADER_H__
+
+#include "ns3/header.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A simplified RoCE base transport header.
+ *
+ * The header is carried directly after the ethernet header (ethertype
+ * PROT_NUMBER), so the rdma transport does not depend on an ip stack
+ * installed on the vm. It carries the opcode, the destination queue pair
+ * number, the packet sequence number and the ecn bits used by DCQCN.
+ */
+class DCRdmaHeader : public Header
+{
+public:
+    /**
+     * The ethertype of RoCE frames.
+     */
+    static const uint16_t PROT_NUMBER = 0x8915;
+
+    enum Opcode {
+        DATA = 0,       /**< Payload of a message */
+        ACK = 1,        /**< Cumulative acknowledgement, psn is the last received */
+        NAK = 2,        /**< Sequence error, psn is the expected one */
+        CNP = 3         /**< Congestion notification packet */
+    };
+
+    enum Flags {
+        FLAG_ECT = 0x01,    /**< Ecn capable transport */
+        FLAG_CE = 0x02,     /**< Congestion experienced */
+        FLAG_ACKREQ = 0x04  /**< Ask the receiver to acknowledge this packet */
+    };
+
+    static TypeId GetTypeId (void);
+    virtual TypeId GetInstanceTypeId (void) const;
+
+    DCRdmaHeader ();
+    virtual ~DCRdmaHeader ();
+
+    void SetOpcode (DCRdmaHeader::Opcode opcode);
+    DCRdmaHeader::Opcode GetOpcode (void) const;
+    void SetDestQpn (uint32_t qpn);
+    uint32_t GetDestQpn (void) const;
+    void SetPsn (uint32_t psn);
+    uint32_t GetPsn (void) const;
+
+    void SetFlags (uint8_t flags);
+    uint8_t GetFlags (void) const;
+    bool IsEct (void) const;
+    bool IsCe (void) const;
+    bool IsAckReq (void) const;
+
+    /**
+     * \brief Mark congestion experienced, only ect packets can be marked.
+     * \return true if the packet has been marked
+     */
+    bool MarkCe (void);
+
+    virtual void Print (std::ostream &os) const;
+    virtual uint32_t GetSerializedSize (void) const;
+    virtual void Serialize (Buffer::Iterator start) const;
+    virtual uint32_t Deserialize (Buffer::Iterator start);
+
+private:
+    uint8_t m_opcode;
+    uint8_t m_flags;
+    uint32_t m_destQpn;
+    uint32_t m_psn;
+};
+
+} // namespace ns3
+
+#endif /* __DC_RDMA_HEADER_H__ */
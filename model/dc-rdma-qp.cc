@@ -0,0 +1,475 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cmath>
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/simulator.h"
+#include "ns3/packet.h"
+#include "ns3/node.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/trace-source-accessor.h"
+#include "dc-point-net-device-base.h"
+#include "dc-point-channel-base.h"
+#include "dc-rdma-qp.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCRdmaQp");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCRdmaQp);
+
+TypeId
+DCRdmaQp::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCRdmaQp")
+        .SetParent<Application> ()
+        .AddConstructor<DCRdmaQp> ()
+        .AddAttribute ("Remote", "The mac address of the vm running the peer queue pair.",
+                       AddressValue (),
+                       MakeAddressAccessor (&DCRdmaQp::m_remote),
+                       MakeAddressChecker ())
+        .AddAttribute ("Qpn", "The number of this queue pair.",
+                       UintegerValue (1),
+                       MakeUintegerAccessor (&DCRdmaQp::m_qpn),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("RemoteQpn", "The number of the peer queue pair.",
+                       UintegerValue (1),
+                       MakeUintegerAccessor (&DCRdmaQp::m_remoteQpn),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("MessageSize", "Bytes of the message posted at start, 0 to only receive.",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCRdmaQp::m_msgSize),
+                       MakeUintegerChecker<uint64_t> ())
+        .AddAttribute ("PacketSize", "Payload bytes of a data packet.",
+                       UintegerValue (1000),
+                       MakeUintegerAccessor (&DCRdmaQp::m_pktSize),
+                       MakeUintegerChecker<uint32_t> (1,9000))
+        .AddAttribute ("AckInterval", "Request an ack every n data packets.",
+                       UintegerValue (16),
+                       MakeUintegerAccessor (&DCRdmaQp::m_ackInterval),
+                       MakeUintegerChecker<uint32_t> (1,0xffffffff))
+        .AddAttribute ("RetransmitTimeout", "Go back to the first unacknowledged packet after this time.",
+                       TimeValue (MilliSeconds (1)),
+                       MakeTimeAccessor (&DCRdmaQp::m_rto),
+                       MakeTimeChecker ())
+        .AddAttribute ("CnpInterval", "Minimum interval between two CNPs of the receiver.",
+                       TimeValue (MicroSeconds (50)),
+                       MakeTimeAccessor (&DCRdmaQp::m_cnpInterval),
+                       MakeTimeChecker ())
+        .AddAttribute ("LineRate", "The maximum sending rate, 0 to use the rate of the vm link.",
+                       DataRateValue (DataRate ((uint64_t)0)),
+                       MakeDataRateAccessor (&DCRdmaQp::m_lineRate),
+                       MakeDataRateChecker ())
+        .AddAttribute ("MinRate", "The minimum sending rate.",
+                       DataRateValue (DataRate ("10Mbps")),
+                       MakeDataRateAccessor (&DCRdmaQp::m_minRate),
+                       MakeDataRateChecker ())
+        .AddAttribute ("RateAI", "Rate step of the additive increase.",
+                       DataRateValue (DataRate ("40Mbps")),
+                       MakeDataRateAccessor (&DCRdmaQp::m_rateAi),
+                       MakeDataRateChecker ())
+        .AddAttribute ("RateHAI", "Rate step of the hyper increase.",
+                       DataRateValue (DataRate ("200Mbps")),
+                       MakeDataRateAccessor (&DCRdmaQp::m_rateHai),
+                       MakeDataRateChecker ())
+        .AddAttribute ("AlphaG", "Gain of the alpha estimation.",
+                       DoubleValue (1.0 / 256),
+                       MakeDoubleAccessor (&DCRdmaQp::m_g),
+                       MakeDoubleChecker<double> (0.0, 1.0))
+        .AddAttribute ("AlphaInterval", "Alpha decays once per interval without CNP.",
+                       TimeValue (MicroSeconds (55)),
+                       MakeTimeAccessor (&DCRdmaQp::SetAlphaInterval),
+                       MakeTimeChecker ())
+        .AddAttribute ("RateIncreaseInterval", "Period of the rate increase timer.",
+                       TimeValue (MicroSeconds (55)),
+                       MakeTimeAccessor (&DCRdmaQp::m_increaseInterval),
+                       MakeTimeChecker ())
+        .AddAttribute ("ByteCounter", "Bytes sent between two byte counter rate increases.",
+                       UintegerValue (10 * 1024 * 1024),
+                       MakeUintegerAccessor (&DCRdmaQp::m_byteCounter),
+                       MakeUintegerChecker<uint64_t> (1,0xffffffffffffffffULL))
+        .AddAttribute ("FastRecoveryTimes", "Number of fast recovery stages before additive increase.",
+                       UintegerValue (5),
+                       MakeUintegerAccessor (&DCRdmaQp::m_fastRecovery),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddTraceSource ("Tx", "A data packet is taken by the device, a send refused by a full queue does not fire it",
+                         MakeTraceSourceAccessor (&DCRdmaQp::m_txTrace))
+        .AddTraceSource ("Rx", "A data packet of this queue pair arrives, before the psn check, so "
+                         "out of order and duplicate packets fire it too",
+                         MakeTraceSourceAccessor (&DCRdmaQp::m_rxTrace))
+        .AddTraceSource ("Rate", "The current and target rate (bps) changed",
+                         MakeTraceSourceAccessor (&DCRdmaQp::m_rateTrace))
+        .AddTraceSource ("Complete", "A message (bytes) is acknowledged, with its completion time",
+                         MakeTraceSourceAccessor (&DCRdmaQp::m_completeTrace))
+    ;
+    return tid;
+}
+
+DCRdmaQp::DCRdmaQp ()
+    : m_sndNxt (0),
+      m_sndUna (0),
+      m_sndMax (0),
+      m_rcvNxt (0),
+      m_nakSent (false),
+      m_rc (0),
+      m_rt (0),
+      m_alpha (1.0),
+      m_timerStage (0),
+      m_byteStage (0),
+      m_bytesSinceIncrease (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+DCRdmaQp::~DCRdmaQp ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCRdmaQp::DoDispose (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_device = 0;
+    m_messages.clear ();
+    Application::DoDispose ();
+}
+
+void
+DCRdmaQp::SetAlphaInterval (Time interval)
+{
+    NS_LOG_FUNCTION (this << interval);
+    NS_ABORT_MSG_UNLESS (interval.IsStrictlyPositive (), "DCRdmaQp::SetAlphaInterval(): AlphaInterval must be positive");
+    m_alphaInterval = interval;
+}
+
+void
+DCRdmaQp::StartApplication (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+
+    for (uint32_t i = 0;i < m_node->GetNDevices ();i++)
+    {
+        m_device = DynamicCast<DCPointNetDeviceBase> (m_node->GetDevice (i));
+        if (m_device) break;
+    }
+    NS_ASSERT_MSG (m_device, "DCRdmaQp::StartApplication(): the node has no DCPointNetDeviceBase");
+
+    if (m_lineRate.GetBitRate () == 0)
+    {
+        Ptr<DCPointChannelBase> chnl = DynamicCast<DCPointChannelBase> (m_device->GetChannel ());
+        NS_ASSERT_MSG (chnl, "DCRdmaQp::StartApplication(): the device is not attached");
+        m_lineRate = chnl->GetDataRate ();
+    }
+    SetRate (m_lineRate.GetBitRate ());
+    m_rt = m_rc;
+    m_alphaUpdated = Simulator::Now ();
+
+    m_node->RegisterProtocolHandler (MakeCallback (&DCRdmaQp::Receive, this),
+                                     DCRdmaHeader::PROT_NUMBER, m_device);
+
+    if (m_msgSize > 0) PostSend (m_msgSize);
+    if (!m_sendEvent.IsRunning ()) SendNext ();
+}
+
+void
+DCRdmaQp::StopApplication (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_sendEvent.Cancel ();
+    m_rtoEvent.Cancel ();
+    m_increaseEvent.Cancel ();
+    m_node->UnregisterProtocolHandler (MakeCallback (&DCRdmaQp::Receive, this));
+}
+
+void
+DCRdmaQp::PostSend (uint64_t size)
+{
+    NS_LOG_FUNCTION (this << size);
+    if (size == 0) return;
+
+    Message msg;
+    uint64_t packets = (size + m_pktSize - 1) / m_pktSize;
+    msg.endPsn = m_sndMax + packets;
+    msg.lastSize = size - (packets - 1) * m_pktSize;
+    msg.size = size;
+    msg.posted = Simulator::Now ();
+    m_messages.push_back (msg);
+    m_sndMax = msg.endPsn;
+
+    if (m_device && !m_sendEvent.IsRunning ()) SendNext ();
+}
+
+DataRate
+DCRdmaQp::GetRate (void) const
+{
+    return DataRate (m_rc);
+}
+
+uint32_t
+DCRdmaQp::GetPayloadSize (uint32_t psn) const
+{
+    std::deque<Message>::const_iterator i;
+    for (i = m_messages.begin ();i != m_messages.end ();i++)
+    {
+        if (psn < i->endPsn)
+            return (psn + 1 == i->endPsn) ? i->lastSize : m_pktSize;
+    }
+    NS_ASSERT_MSG (false, "DCRdmaQp::GetPayloadSize(): psn " << psn << " is not posted");
+    return 0;
+}
+
+void
+DCRdmaQp::SendNext (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+
+    if (m_sndNxt >= m_sndMax) return;
+
+    uint32_t size = GetPayloadSize (m_sndNxt);
+    Ptr<Packet> packet = Create<Packet> (size);
+    DCRdmaHeader header;
+    uint8_t flags = DCRdmaHeader::FLAG_ECT;
+    if ((m_sndNxt + 1) % m_ackInterval == 0 || size != m_pktSize
+        || m_sndNxt + 1 == m_sndMax)
+    {
+        flags |= DCRdmaHeader::FLAG_ACKREQ;
+    }
+    header.SetOpcode (DCRdmaHeader::DATA);
+    header.SetFlags (flags);
+    header.SetDestQpn (m_remoteQpn);
+    header.SetPsn (m_sndNxt);
+    packet->AddHeader (header);
+    uint32_t bytes = packet->GetSize ();
+
+    //
+    // A full device queue is a local back pressure, not a loss. Keep the
+    // psn and try again after one packet time. The trace gets the packet
+    // as it was before the device added its headers, once it is taken.
+    //
+    Ptr<const Packet> traced = packet->Copy ();
+    if (m_device->Send (packet, m_remote, DCRdmaHeader::PROT_NUMBER))
+    {
+        m_txTrace (traced);
+        NS_LOG_LOGIC ("Sent psn " << m_sndNxt << " at rate " << m_rc);
+        m_sndNxt++;
+        if (!m_rtoEvent.IsRunning ())
+            m_rtoEvent = Simulator::Schedule (m_rto, &DCRdmaQp::RetransmitTimeout, this);
+
+        if (m_rc < m_lineRate.GetBitRate ())
+        {
+            m_bytesSinceIncrease += size;
+            if (m_bytesSinceIncrease >= m_byteCounter)
+            {
+                m_bytesSinceIncrease = 0;
+                m_byteStage++;
+                IncreaseRate ();
+            }
+        }
+    }
+
+    if (m_sndNxt < m_sndMax)
+    {
+        Time t = Seconds (DataRate (m_rc).CalculateTxTime (bytes));
+        m_sendEvent = Simulator::Schedule (t, &DCRdmaQp::SendNext, this);
+    }
+}
+
+void
+DCRdmaQp::Acknowledge (uint32_t psn)
+{
+    NS_LOG_FUNCTION (this << psn);
+
+    // psn is the first packet not yet received by the peer
+    if (psn <= m_sndUna) return;
+    m_sndUna = psn;
+    if (m_sndNxt < m_sndUna) m_sndNxt = m_sndUna;
+
+    while (!m_messages.empty () && m_messages.front ().endPsn <= m_sndUna)
+    {
+        Message &msg = m_messages.front ();
+        NS_LOG_LOGIC ("Message of " << msg.size << " bytes completed");
+        m_completeTrace (msg.size, Simulator::Now () - msg.posted);
+        m_messages.pop_front ();
+    }
+
+    m_rtoEvent.Cancel ();
+    if (m_sndUna < m_sndNxt)
+        m_rtoEvent = Simulator::Schedule (m_rto, &DCRdmaQp::RetransmitTimeout, this);
+}
+
+void
+DCRdmaQp::RetransmitTimeout (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    if (m_sndUna >= m_sndMax) return;
+    NS_LOG_LOGIC ("Retransmit timeout, go back to psn " << m_sndUna);
+    GoBack (m_sndUna);
+    m_rtoEvent = Simulator::Schedule (m_rto, &DCRdmaQp::RetransmitTimeout, this);
+}
+
+void
+DCRdmaQp::GoBack (uint32_t psn)
+{
+    NS_LOG_FUNCTION (this << psn);
+    m_sndNxt = psn;
+    if (!m_sendEvent.IsRunning ()) SendNext ();
+}
+
+void
+DCRdmaQp::Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                   const Address &from, const Address &to, NetDevice::PacketType packetType)
+{
+    NS_LOG_FUNCTION (this << packet);
+
+    DCRdmaHeader header;
+    packet->PeekHeader (header);
+    if (header.GetDestQpn () != m_qpn) return;
+
+    switch (header.GetOpcode ())
+    {
+    case DCRdmaHeader::DATA:
+        m_rxTrace (packet);
+        ReceiveData (header, packet->GetSize () - header.GetSerializedSize ());
+        break;
+    case DCRdmaHeader::ACK:
+        Acknowledge (header.GetPsn () + 1);
+        break;
+    case DCRdmaHeader::NAK:
+        NS_LOG_LOGIC ("NAK, go back to psn " << header.GetPsn ());
+        Acknowledge (header.GetPsn ());
+        GoBack (header.GetPsn ());
+        break;
+    case DCRdmaHeader::CNP:
+        ReceiveCnp ();
+        break;
+    default:
+        NS_LOG_WARN ("Unknown rdma opcode " << header.GetOpcode ());
+        break;
+    }
+}
+
+void
+DCRdmaQp::ReceiveData (const DCRdmaHeader &header, uint32_t size)
+{
+    NS_LOG_FUNCTION (this << size);
+
+    //
+    // Notification point: at most one CNP per interval for the marked
+    // packets of this queue pair.
+    //
+    if (header.IsCe () && Simulator::Now () >= m_nextCnp)
+    {
+        SendControl (DCRdmaHeader::CNP, header.GetPsn ());
+        m_nextCnp = Simulator::Now () + m_cnpInterval;
+    }
+
+    uint32_t psn = header.GetPsn ();
+    if (psn == m_rcvNxt)
+    {
+        m_rcvNxt++;
+        m_nakSent = false;
+        if (header.IsAckReq ()) SendControl (DCRdmaHeader::ACK, psn);
+    }
+    else if (psn > m_rcvNxt)
+    {
+        //
+        // Go-back-N: drop the packet, and tell the sender what we expect.
+        // Only one NAK is sent for a gap, the retransmit timer of the
+        // sender covers a lost NAK.
+        //
+        if (!m_nakSent)
+        {
+            SendControl (DCRdmaHeader::NAK, m_rcvNxt);
+            m_nakSent = true;
+        }
+    }
+    else if (header.IsAckReq ())
+    {
+        // duplicate, the previous ack may be lost
+        SendControl (DCRdmaHeader::ACK, m_rcvNxt - 1);
+    }
+}
+
+void
+DCRdmaQp::SendControl (DCRdmaHeader::Opcode opcode, uint32_t psn)
+{
+    NS_LOG_FUNCTION (this << opcode << psn);
+    Ptr<Packet> packet = Create<Packet> ();
+    DCRdmaHeader header;
+    header.SetOpcode (opcode);
+    header.SetDestQpn (m_remoteQpn);
+    header.SetPsn (psn);
+    packet->AddHeader (header);
+    m_device->Send (packet, m_remote, DCRdmaHeader::PROT_NUMBER);
+}
+
+void
+DCRdmaQp::ReceiveCnp (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+
+    //
+    // Alpha decays once per AlphaInterval without CNP, which is computed
+    // here instead of running a timer for every queue pair.
+    //
+    uint64_t periods = (Simulator::Now () - m_alphaUpdated).GetTimeStep () / m_alphaInterval.GetTimeStep ();
+    m_alpha *= std::pow (1 - m_g, (double)periods);
+    m_alpha = (1 - m_g) * m_alpha + m_g;
+    m_alphaUpdated = Simulator::Now ();
+
+    m_rt = m_rc;
+    uint64_t rate = (uint64_t)(m_rc * (1 - m_alpha / 2));
+    SetRate (std::max (rate, m_minRate.GetBitRate ()));
+    NS_LOG_LOGIC ("CNP, alpha " << m_alpha << " rate " << m_rc);
+
+    m_timerStage = 0;
+    m_byteStage = 0;
+    m_bytesSinceIncrease = 0;
+    m_increaseEvent.Cancel ();
+    m_increaseEvent = Simulator::Schedule (m_increaseInterval, &DCRdmaQp::RateIncreaseTimer, this);
+}
+
+void
+DCRdmaQp::RateIncreaseTimer (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    m_timerStage++;
+    IncreaseRate ();
+    if (m_rc < m_lineRate.GetBitRate ())
+        m_increaseEvent = Simulator::Schedule (m_increaseInterval, &DCRdmaQp::RateIncreaseTimer, this);
+}
+
+void
+DCRdmaQp::IncreaseRate (void)
+{
+    NS_LOG_FUNCTION (this << m_timerStage << m_byteStage);
+
+    if (std::max (m_timerStage, m_byteStage) < m_fastRecovery)
+    {
+        // fast recovery, only move towards the target rate
+    }
+    else if (std::min (m_timerStage, m_byteStage) > m_fastRecovery)
+    {
+        m_rt += m_rateHai.GetBitRate ();
+    }
+    else
+    {
+        m_rt += m_rateAi.GetBitRate ();
+    }
+    m_rt = std::min (m_rt, m_lineRate.GetBitRate ());
+
+    // (rt + rc) / 2 never reaches the target, so snap to it in the last step
+    uint64_t rate = (m_rt + m_rc) / 2;
+    if (m_rt - rate < m_rateAi.GetBitRate () / 2) rate = m_rt;
+    SetRate (rate);
+}
+
+void
+DCRdmaQp::SetRate (uint64_t rate)
+{
+    m_rc = std::min (rate, m_lineRate.GetBitRate ());
+    m_rateTrace (m_rc, m_rt);
+}
+
+} // namespace ns3
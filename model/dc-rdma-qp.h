@@ -0,0 +1,149 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_RDMA_QP_H__
+#define __DC_RDMA_QP_H__
+
+#include <deque>
+#include "ns3/application.h"
+#include "ns3/address.h"
+#include "ns3/mac48-address.h"
+#include "ns3/net-device.h"
+#include "ns3/data-rate.h"
+#include "ns3/nstime.h"
+#include "ns3/event-id.h"
+#include "ns3/traced-callback.h"
+#include "dc-rdma-header.h"
+
+namespace ns3 {
+
+class DCPointNetDeviceBase;
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief A RoCEv2 like reliable connected queue pair.
+ *
+ * The queue pair is installed on a vm (DCVm::AddApplication) and talks
+ * to its peer directly through the DCPointNetDeviceBase of the vm with
+ * the ethertype of DCRdmaHeader, so no socket or ip stack is involved
+ * and the per packet cost is a header and a few events.
+ *
+ * Reliability is go-back-N: the receiver only accepts the expected psn,
+ * sends a NAK once for a sequence gap and a cumulative ACK for every
+ * packet with the ACKREQ flag. The sender rewinds to the NAKed psn, or to
+ * the first unacknowledged psn when the retransmit timer expires.
+ *
+ * The sender is rate based and runs DCQCN: data packets are ect, switch
+ * queues (e.g. DCEcnQueue) mark them, the receiver turns marks into CNPs
+ * (at most one per CnpInterval), and the sender cuts its rate on CNP and
+ * recovers it by timer and byte counter through fast recovery, additive
+ * and hyper increase.
+ *
+ * A queue pair with MessageSize 0 only receives.
+ */
+class DCRdmaQp : public Application
+{
+public:
+    static TypeId GetTypeId (void);
+
+    DCRdmaQp ();
+    virtual ~DCRdmaQp ();
+
+    /**
+     * \brief Post a message of size bytes to the send queue.
+     *
+     * Messages are sent back to back in the order they are posted.
+     */
+    void PostSend (uint64_t size);
+
+    /**
+     * \return the current sending rate
+     */
+    DataRate GetRate (void) const;
+
+protected:
+    virtual void DoDispose (void);
+
+private:
+    void SetAlphaInterval (Time interval);
+
+    virtual void StartApplication (void);
+    virtual void StopApplication (void);
+
+    void Receive (Ptr<NetDevice> device, Ptr<const Packet> packet, uint16_t protocol,
+                  const Address &from, const Address &to, NetDevice::PacketType packetType);
+
+    // sender
+    void SendNext (void);
+    uint32_t GetPayloadSize (uint32_t psn) const;
+    void Acknowledge (uint32_t psn);
+    void RetransmitTimeout (void);
+    void GoBack (uint32_t psn);
+
+    // receiver
+    void ReceiveData (const DCRdmaHeader &header, uint32_t size);
+    void SendControl (DCRdmaHeader::Opcode opcode, uint32_t psn);
+
+    // DCQCN reaction point
+    void ReceiveCnp (void);
+    void RateIncreaseTimer (void);
+    void IncreaseRate (void);
+    void SetRate (uint64_t rate);
+
+    Ptr<DCPointNetDeviceBase> m_device;
+    Address m_remote;
+    uint32_t m_qpn;
+    uint32_t m_remoteQpn;
+    uint32_t m_pktSize;
+    uint32_t m_ackInterval;
+    Time m_rto;
+
+    // send state, psn counts packets from the start of the queue pair
+    struct Message
+    {
+        uint32_t endPsn;    // psn after the last packet of the message
+        uint32_t lastSize;  // payload of the last packet
+        uint64_t size;
+        Time posted;
+    };
+    std::deque<Message> m_messages;
+    uint64_t m_msgSize;
+    uint32_t m_sndNxt;
+    uint32_t m_sndUna;
+    uint32_t m_sndMax;
+    EventId m_sendEvent;
+    EventId m_rtoEvent;
+
+    // receive state
+    uint32_t m_rcvNxt;
+    bool m_nakSent;
+    Time m_nextCnp;
+    Time m_cnpInterval;
+
+    // DCQCN
+    DataRate m_lineRate;
+    DataRate m_minRate;
+    DataRate m_rateAi;
+    DataRate m_rateHai;
+    uint64_t m_rc;
+    uint64_t m_rt;
+    double m_alpha;
+    double m_g;
+    Time m_alphaInterval;
+    Time m_alphaUpdated;
+    Time m_increaseInterval;
+    uint64_t m_byteCounter;
+    uint32_t m_fastRecovery;
+    uint32_t m_timerStage;
+    uint32_t m_byteStage;
+    uint64_t m_bytesSinceIncrease;
+    EventId m_increaseEvent;
+
+    TracedCallback<Ptr<const Packet> > m_txTrace;
+    TracedCallback<Ptr<const Packet> > m_rxTrace;
+    TracedCallback<uint64_t, uint64_t> m_rateTrace;
+    TracedCallback<uint64_t, Time> m_completeTrace;
+};
+
+} // namespace ns3
+
+#endif /* __DC_RDMA_QP_H__ */
@@ -0,0 +1,222 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#include <cstdlib>
+#include "ns3/log.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/trace-source-accessor.h"
+#include "dc-switch-buffer.h"
+
+NS_LOG_COMPONENT_DEFINE ("DCSwitchBuffer");
+
+namespace ns3 {
+
+NS_OBJECT_ENSURE_REGISTERED (DCSwitchBuffer);
+
+TypeId
+DCSwitchBuffer::GetTypeId (void)
+{
+    static TypeId tid = TypeId ("ns3::DCSwitchBuffer")
+        .SetParent<Object> ()
+        .AddConstructor<DCSwitchBuffer> ()
+        .AddAttribute ("Size",
+                       "The bytes of packet memory of the switch.",
+                       UintegerValue (12 * 1024 * 1024),
+                       MakeUintegerAccessor (&DCSwitchBuffer::m_size),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("Reserved",
+                       "The bytes reserved for every (port, class) queue outside the shared pool.",
+                       UintegerValue (0),
+                       MakeUintegerAccessor (&DCSwitchBuffer::m_reserved),
+                       MakeUintegerChecker<uint32_t> ())
+        .AddAttribute ("Alpha",
+                       "The dynamic threshold factor of all classes.",
+                       DoubleValue (1.0),
+                       MakeDoubleAccessor (&DCSwitchBuffer::SetAlpha),
+                       MakeDoubleChecker<double> (0.0))
+        .AddAttribute ("ClassAlpha",
+                       "Comma separated dynamic threshold factors of classes 0, 1, ..., "
+                       "unlisted classes keep Alpha.",
+                       StringValue (""),
+                       MakeStringAccessor (&DCSwitchBuffer::SetClassAlpha),
+                       MakeStringChecker ())
+        .AddAttribute ("PortAlpha",
+                       "The dynamic threshold factor of a whole port, 0 means no port limit.",
+                       DoubleValue (0.0),
+                       MakeDoubleAccessor (&DCSwitchBuffer::m_portAlpha),
+                       MakeDoubleChecker<double> (0.0))
+        .AddTraceSource ("Occupancy",
+                         "The bytes of a (port, class) queue and of the buffer have changed",
+                         MakeTraceSourceAccessor (&DCSwitchBuffer::m_occupancyTrace))
+        .AddTraceSource ("Drop",
+                         "A packet has been refused by the dynamic threshold",
+                         MakeTraceSourceAccessor (&DCSwitchBuffer::m_dropTrace))
+    ;
+    return tid;
+}
+
+DCSwitchBuffer::DCSwitchBuffer ()
+    : m_size (0),
+      m_reserved (0),
+      m_reservedTotal (0),
+      m_portAlpha (0),
+      m_used (0),
+      m_sharedUsed (0)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    for (uint32_t i = 0;i < MAX_CLASSES;i++)
+        m_alpha[i] = 1.0;
+}
+
+DCSwitchBuffer::~DCSwitchBuffer ()
+{
+    NS_LOG_FUNCTION_NOARGS ();
+}
+
+void
+DCSwitchBuffer::SetAlpha (double alpha)
+{
+    NS_LOG_FUNCTION (alpha);
+    for (uint32_t i = 0;i < MAX_CLASSES;i++)
+        m_alpha[i] = alpha;
+}
+
+void
+DCSwitchBuffer::SetClassAlpha (std::string alpha)
+{
+    NS_LOG_FUNCTION (alpha);
+    std::string::size_type begin = 0;
+    for (uint32_t i = 0;i < MAX_CLASSES && begin < alpha.size ();i++)
+    {
+        std::string::size_type end = alpha.find (',', begin);
+        if (end == std::string::npos) end = alpha.size ();
+        double a = std::atof (alpha.substr (begin, end - begin).c_str ());
+        NS_ASSERT_MSG (a >= 0, "DCSwitchBuffer::SetClassAlpha(): bad alpha in " << alpha);
+        m_alpha[i] = a;
+        begin = end + 1;
+    }
+}
+
+uint32_t
+DCSwitchBuffer::AddPort (uint32_t nClasses)
+{
+    NS_LOG_FUNCTION (this << nClasses);
+    NS_ASSERT_MSG (nClasses > 0 && nClasses <= MAX_CLASSES,
+                   "DCSwitchBuffer::AddPort(): invalid number of classes " << nClasses);
+
+    Port p;
+    p.nClasses = nClasses;
+    p.bytes = 0;
+    p.shared = 0;
+    for (uint32_t i = 0;i < MAX_CLASSES;i++)
+        p.cls[i] = 0;
+    m_ports.push_back (p);
+    m_reservedTotal += nClasses * m_reserved;
+    if (m_reservedTotal > m_size)
+    {
+        NS_LOG_WARN ("DCSwitchBuffer::AddPort(): reserved bytes exceed the buffer size, no shared pool left.");
+    }
+    return m_ports.size () - 1;
+}
+
+uint32_t
+DCSwitchBuffer::SharedOf (uint32_t bytes) const
+{
+    return bytes > m_reserved ? bytes - m_reserved : 0;
+}
+
+uint32_t
+DCSwitchBuffer::GetSharedSize (void) const
+{
+    return m_size > m_reservedTotal ? m_size - m_reservedTotal : 0;
+}
+
+bool
+DCSwitchBuffer::Admit (uint32_t port, uint32_t cls, uint32_t bytes)
+{
+    NS_LOG_FUNCTION (this << port << cls << bytes);
+    NS_ASSERT (port < m_ports.size () && cls < m_ports[port].nClasses);
+
+    Port &p = m_ports[port];
+    uint32_t q = p.cls[cls];
+    uint32_t extra = SharedOf (q + bytes) - SharedOf (q);
+    if (extra > 0)
+    {
+        uint32_t shared = GetSharedSize ();
+        uint32_t free = shared > m_sharedUsed ? shared - m_sharedUsed : 0;
+        bool admit = extra <= free && SharedOf (q) + extra <= m_alpha[cls] * free;
+        if (admit && m_portAlpha > 0)
+            admit = p.shared + extra <= m_portAlpha * free;
+        if (!admit)
+        {
+            NS_LOG_LOGIC ("Refused " << bytes << " bytes of port " << port << " class " << cls
+                          << ", queue " << q << " free " << free);
+            m_dropTrace (port, cls, bytes);
+            return false;
+        }
+    }
+
+    p.cls[cls] += bytes;
+    p.bytes += bytes;
+    p.shared += extra;
+    m_sharedUsed += extra;
+    m_used += bytes;
+    m_occupancyTrace (port, cls, p.cls[cls], m_used);
+    return true;
+}
+
+void
+DCSwitchBuffer::Release (uint32_t port, uint32_t cls, uint32_t bytes)
+{
+    NS_LOG_FUNCTION (this << port << cls << bytes);
+    NS_ASSERT (port < m_ports.size () && cls < m_ports[port].nClasses);
+
+    Port &p = m_ports[port];
+    uint32_t q = p.cls[cls];
+    NS_ASSERT_MSG (q >= bytes, "DCSwitchBuffer::Release(): release more than admitted!");
+    uint32_t less = SharedOf (q) - SharedOf (q - bytes);
+
+    p.cls[cls] -= bytes;
+    p.bytes -= bytes;
+    p.shared -= less;
+    m_sharedUsed -= less;
+    m_used -= bytes;
+    m_occupancyTrace (port, cls, p.cls[cls], m_used);
+}
+
+uint32_t
+DCSwitchBuffer::GetNPorts (void) const
+{
+    return m_ports.size ();
+}
+
+uint32_t
+DCSwitchBuffer::GetUsed (void) const
+{
+    return m_used;
+}
+
+uint32_t
+DCSwitchBuffer::GetPortBytes (uint32_t port) const
+{
+    NS_ASSERT (port < m_ports.size ());
+    return m_ports[port].bytes;
+}
+
+uint32_t
+DCSwitchBuffer::GetBytes (uint32_t port, uint32_t cls) const
+{
+    NS_ASSERT (port < m_ports.size () && cls < MAX_CLASSES);
+    return m_ports[port].cls[cls];
+}
+
+uint32_t
+DCSwitchBuffer::GetThreshold (uint32_t cls) const
+{
+    NS_ASSERT (cls < MAX_CLASSES);
+    uint32_t shared = GetSharedSize ();
+    uint32_t free = shared > m_sharedUsed ? shared - m_sharedUsed : 0;
+    return (uint32_t)(m_alpha[cls] * free);
+}
+
+} // namespace ns3
@@ -0,0 +1,102 @@
+/* -*- Mode:C++; c-file-style:"gnu"; indent-tabs-mode:nil; -*- */
+#ifndef __DC_SWITCH_BUFFER_H__
+#define __DC_SWITCH_BUFFER_H__
+
+#include <vector>
+#include <string>
+#include "ns3/object.h"
+#include "ns3/traced-callback.h"
+
+namespace ns3 {
+
+/**
+ * \ingroup datacenter
+ *
+ * \brief The packet memory of a switch shared by all its port queues.
+ *
+ * Every (port, class) queue first uses its Reserved bytes, the rest of
+ * the memory is a shared pool. A queue may take bytes from the pool as
+ * long as its shared occupancy stays below alpha times the free pool
+ * (dynamic threshold), where alpha is given per class. With PortAlpha
+ * set the shared occupancy of the whole port is limited the same way.
+ *
+ * Port queues join the buffer with AddPort, see
+ * DCMultiClassQueue::SetSharedBuffer and the SharedBuffer attribute of
+ * DCSwitch.
+ */
+class DCSwitchBuffer : public Object
+{
+public:
+    static TypeId GetTypeId (void);
+
+    static const uint32_t MAX_CLASSES = 8;
+
+    DCSwitchBuffer ();
+    virtual ~DCSwitchBuffer ();
+
+    /**
+     * \brief Add a port queue with nClasses classes.
+     * \return the port index used by Admit and Release
+     */
+    uint32_t AddPort (uint32_t nClasses);
+
+    /**
+     * \brief Try to take bytes for a packet arriving at (port, cls).
+     * \return false if the packet must be dropped
+     */
+    bool Admit (uint32_t port, uint32_t cls, uint32_t bytes);
+
+    /**
+     * \brief Give back the bytes of a packet leaving (port, cls).
+     */
+    void Release (uint32_t port, uint32_t cls, uint32_t bytes);
+
+    void SetClassAlpha (std::string alpha);
+    void SetAlpha (double alpha);
+
+    uint32_t GetNPorts (void) const;
+    /**
+     * \return the bytes used in the whole buffer
+     */
+    uint32_t GetUsed (void) const;
+    uint32_t GetPortBytes (uint32_t port) const;
+    uint32_t GetBytes (uint32_t port, uint32_t cls) const;
+    /**
+     * \return the current dynamic threshold of the shared bytes of a class
+     */
+    uint32_t GetThreshold (uint32_t cls) const;
+
+private:
+    uint32_t SharedOf (uint32_t bytes) const;
+    uint32_t GetSharedSize (void) const;
+
+    struct Port
+    {
+        uint32_t nClasses;
+        uint32_t bytes;
+        uint32_t shared;
+        uint32_t cls[MAX_CLASSES];
+    };
+
+    std::vector<Port> m_ports;
+    uint32_t m_size;
+    uint32_t m_reserved;
+    uint32_t m_reservedTotal;
+    double m_alpha[MAX_CLASSES];
+    double m_portAlpha;
+    uint32_t m_used;
+    uint32_t m_sharedUsed;
+
+    /**
+     * port, class, bytes in the queue, bytes in the buffer
+     */
+    TracedCallback<uint32_t, uint32_t, uint32_t, uint32_t> m_occupancyTrace;
+    /**
+     * port, class, bytes of the dropped packet
+     */
+    TracedCallback<uint32_t, uint32_t, uint32_t> m_dropTrace;
+};
+
+} // namespace ns3
+
+#endif /* __DC_SWITCH_BUFFER_H__ */
@@ -7,6 +7,7 @@
 #include "dc-point-net-device-base.h"
 #include "dc-bridge-net-device-base.h"
 #include "dc-point-net-device.h"
+#include "dc-multi-class-queue.h"
 #include "dc-switch.h"
 
 NS_LOG_COMPONENT_DEFINE ("DCSwitch");
@@ -51,6 +52,11 @@ DCSwitch::GetTypeId (void)
             PointerValue (),
             MakePointerAccessor (&DCSwitch::m_portAddressAllocater),
             MakePointerChecker<DCAddressAllocater> ())
+        .AddAttribute ("SharedBuffer","The packet memory shared by the port queues.",
+            PointerValue (),
+            MakePointerAccessor (&DCSwitch::GetSharedBuffer,
+                &DCSwitch::SetSharedBuffer),
+            MakePointerChecker<DCSwitchBuffer> ())
     ;
     return tid;
 }
@@ -103,6 +109,37 @@ DCSwitch::SetPortAddressAllocater (Ptr<DCAddressAllocater> allocater)
     m_portAddressAllocater = allocater;
 }
 
+void
+DCSwitch::SetSharedBuffer (Ptr<DCSwitchBuffer> buffer)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    NS_ASSERT_MSG (m_lastIf < 0 || !buffer,
+            "DCSwitch::SetSharedBuffer(): Buffer must be set before ports are added!");
+    m_buffer = buffer;
+}
+
+Ptr<DCSwitchBuffer>
+DCSwitch::GetSharedBuffer (void) const
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    return m_buffer;
+}
+
+Ptr<Queue>
+DCSwitch::CreatePortQueue (void)
+{
+    NS_LOG_FUNCTION_NOARGS ();
+    Ptr<Queue> que = m_portDevQueFactory.Create<Queue>();
+    if (m_buffer)
+    {
+        Ptr<DCMultiClassQueue> mq = DynamicCast<DCMultiClassQueue>(que);
+        NS_ASSERT_MSG (mq, "DCSwitch::CreatePortQueue(): The type of port queue must be "
+                "DCMultiClassQueue to use a shared buffer!");
+        mq->SetSharedBuffer(m_buffer);
+    }
+    return que;
+}
+
 bool
 DCSwitch::AddUpNode(Ptr<DCNode> upNode, Ptr<DCPointChannelBase> chnl)
 {
@@ -118,7 +155,7 @@ DCSwitch::AddUpNode(Ptr<DCNode> upNode, Ptr<DCPointChannelBase> chnl)
 
     // create a port device and config
     Ptr<DCPointNetDeviceBase> dev = m_portDevFactory.Create<DCPointNetDeviceBase>();
-    Ptr<Queue> que = m_portDevQueFactory.Create<Queue>();
+    Ptr<Queue> que = CreatePortQueue();
     dev->SetQueue(que);
     dev->Attach(chnl);
     if (m_portAddressAllocater) dev->SetAddress(m_portAddressAllocater->Allocate());
@@ -150,7 +187,7 @@ DCSwitch::AddDownNode(Ptr<DCNode> downNode, Ptr<DCPointChannelBase> chnl)
 
     // create a port device and config
     Ptr<DCPointNetDeviceBase> dev = m_portDevFactory.Create<DCPointNetDeviceBase>();
-    Ptr<Queue> que = m_portDevQueFactory.Create<Queue>();
+    Ptr<Queue> que = CreatePortQueue();
     dev->SetQueue(que);
     dev->Attach(chnl);
     if (m_portAddressAllocater) dev->SetAddress(m_portAddressAllocater->Allocate());
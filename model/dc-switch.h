@@ -9,6 +9,7 @@
 #include "dc-node.h"
 #include "dc-bridge-net-device-base.h"
 #include "dc-address-allocater.h"
+#include "dc-switch-buffer.h"
 
 namespace ns3 {
 
@@ -36,6 +37,15 @@ public:
     virtual void SetBridgeAddress (Address address);
     virtual void SetPortAddressAllocater (Ptr<DCAddressAllocater> allocater);
 
+    /**
+     * \brief Share one packet memory among the port queues of this switch.
+     *
+     * Must be set before ports are added. The port queues must be
+     * DCMultiClassQueue.
+     */
+    virtual void SetSharedBuffer (Ptr<DCSwitchBuffer> buffer);
+    virtual Ptr<DCSwitchBuffer> GetSharedBuffer (void) const;
+
     // interfaces of DCNode
     virtual bool AddUpNode(Ptr<DCNode> upNode, Ptr<DCPointChannelBase> chnl);
     virtual bool AddDownNode(Ptr<DCNode> downNode, Ptr<DCPointChannelBase> chnl);
@@ -49,12 +59,15 @@ public:
     virtual Ptr<Node> GetOriginalNode (void) const;  
 
 protected:
+    virtual Ptr<Queue> CreatePortQueue (void);
+
     Ptr<Node> m_node;
     Ptr<DCBridgeNetDeviceBase> m_bridge;
     Address m_bridgeAddress;
     ObjectFactory m_portDevFactory;
     ObjectFactory m_portDevQueFactory;
     Ptr<DCAddressAllocater> m_portAddressAllocater;
+    Ptr<DCSwitchBuffer> m_buffer;
     std::vector<Ptr<DCNode> > m_upNodes;
     std::vector<Ptr<DCNode> > m_downNodes;
     int32_t m_lastIf;
@@ -148,12 +148,27 @@ DCTenantListPriv::GetDCTenant (uint32_t n)
  */
 namespace ns3 {
 
+uint32_t DCTenantList::m_generation = 1;
+
 uint32_t
 DCTenantList::Add (Ptr<DCTenant> node)
 {
+    m_generation++;
     return DCTenantListPriv::Get ()->Add (node);
 }
 
+void
+DCTenantList::NotifyMembershipChange (void)
+{
+    m_generation++;
+}
+
+uint32_t
+DCTenantList::GetGeneration (void)
+{
+    return m_generation;
+}
+
 DCTenantList::Iterator 
 DCTenantList::Begin (void)
 {
@@ -53,6 +53,19 @@ public:
   static uint32_t GetNDCTenants (void);
 
   static Ptr<DCTenant> GetDCTenant(Ptr<DCVm> vm);
+
+  /**
+   * Called when a vm joins or leaves a tenant, DCTenant::AddVm does it.
+   */
+  static void NotifyMembershipChange (void);
+  /**
+   * \returns a number changed by every new tenant and every membership
+   *          change, so a cache of the tenant of a vm knows it is stale.
+   */
+  static uint32_t GetGeneration (void);
+
+private:
+  static uint32_t m_generation;
 };
 
 } // namespace ns3
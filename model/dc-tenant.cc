@@ -3,6 +3,7 @@
 #include "ns3/ipv4-address-generator.h"
 #include "dc-node-list.h"
 #include "dc-point-net-device-base.h"
+#include "dc-point-forward.h"
 #include "dc-tenant-list.h"
 #include "dc-tenant.h"
 
@@ -171,11 +172,13 @@ DCIPv4Tenant::AddVm (Ptr<DCVm> vm)
     ipv4->AddAddress(interface, ipv4Addr);
     ipv4->SetMetric(interface, 1);
     ipv4->SetUp(interface);
+    DCPointStaticForward::Invalidate();
 
     // store information
     vm->SetPrivateAddress(address);
     m_addressMap[Address(address)] = vm;
     m_vms.push_back(vm);
+    DCTenantList::NotifyMembershipChange();
 
     return address;
 }